@@ -2,20 +2,79 @@
 
 #include "Rsap/EditorManager.h"
 
-#include <ranges>
 #include "Rsap/EditorWorld.h"
 #include "Rsap/NavMesh/Debugger.h"
+#include "Rsap/NavMesh/Updater.h"
+#include "Rsap/Math/Morton.h"
+#include "Rsap/Math/Voxelizer.h"
 #include "Engine/World.h"
+#include "Async/TaskGraphInterfaces.h"
+#include "Framework/Notifications/NotificationManager.h"
+#include "HAL/PlatformTime.h"
+#include "Misc/Paths.h"
+#include "Widgets/Notifications/SNotificationList.h"
 #include "Voxelization/Voxelization.h"
 
 
+namespace
+{
+	// Whether both layers have the same nodes in the same order, where IsSameNode compares their contents.
+	template<typename LayerType, typename Func>
+	bool HaveSameNodes(const LayerType& Layer, const LayerType& OtherLayer, Func IsSameNode)
+	{
+		if(Layer.size() != OtherLayer.size()) return false;
+		auto OtherIterator = OtherLayer.begin();
+		for (const auto& [NodeMC, Node] : Layer)
+		{
+			const auto [OtherNodeMC, OtherNode] = *OtherIterator;
+			if(NodeMC != OtherNodeMC || !IsSameNode(Node, OtherNode)) return false;
+			++OtherIterator;
+		}
+		return true;
+	}
+
+	// Whether both octrees have the same nodes, with the same children and leafs. The relations are only compared if requested, because they are not set until a navmesh resolves them.
+	bool IsSameOctree(const THighResSparseOctree<FRsapNode>& Octree, const THighResSparseOctree<FRsapNode>& Other, const bool bCompareRelations)
+	{
+		const auto IsSameNode = [bCompareRelations](const FRsapNode& Node, const FRsapNode& OtherNode)
+		{
+			if(Node.Children != OtherNode.Children) return false;
+			if(!bCompareRelations) return true;
+			for (const rsap_direction Direction : Direction::List)
+			{
+				if(Node.Relations.GetFromDirection(Direction) != OtherNode.Relations.GetFromDirection(Direction)) return false;
+			}
+			return true;
+		};
+
+		for (layer_idx LayerIdx = 0; LayerIdx < Octree.Layers.size(); ++LayerIdx)
+		{
+			if(!HaveSameNodes(*Octree.Layers[LayerIdx], *Other.Layers[LayerIdx], IsSameNode)) return false;
+		}
+		return HaveSameNodes(*Octree.LeafNodes, *Other.LeafNodes, [](const FRsapLeaf& Leaf, const FRsapLeaf& OtherLeaf) { return Leaf.Leafs == OtherLeaf.Leafs; });
+	}
+
+	// Whether both navmeshes have the same nodes, with the same children and relations.
+	bool IsSameNavMesh(const FRsapNavmesh& NavMesh, const FRsapNavmesh& Other)
+	{
+		if(NavMesh.Chunks.size() != Other.Chunks.size()) return false;
+		for (const auto& [ChunkMC, Chunk] : NavMesh.Chunks)
+		{
+			const auto Iterator = Other.Chunks.find(ChunkMC);
+			if(Iterator == Other.Chunks.end()) return false;
+			if(!IsSameOctree(*Chunk.Octrees[Node::State::Static], *Iterator->second.Octrees[Node::State::Static], true)) return false;
+		}
+		return true;
+	}
+}
+
+
 void URsapEditorManager::Initialize(FSubsystemCollectionBase& Collection)
 {
 	Super::Initialize(Collection);
 
-	Debugger = new FRsapDebugger(NavMesh);
-	
-	//FRsapUpdater::GetInstance();
+	Debugger = new FRsapDebugger(GetNavMesh());
+	Updater = MakeUnique<FRsapNavmeshUpdater>(GetNavMesh());
 
 	FRsapEditorWorld& EditorWorld = FRsapEditorWorld::GetInstance();
 
@@ -26,8 +85,9 @@ void URsapEditorManager::Initialize(FSubsystemCollectionBase& Collection)
 	EditorWorld.OnCollisionComponentChanged.BindUObject(this, &ThisClass::OnCollisionComponentChanged);
 
 	FWorldDelegates::OnWorldPostActorTick.AddUObject(this, &ThisClass::OnWorldPostActorTick);
+	FWorldDelegates::OnWorldCleanup.AddUObject(this, &ThisClass::OnWorldCleanup);
 
-	//FRsapUpdater::OnUpdateComplete.AddUObject(this, &ThisClass::OnNavMeshUpdated);
+	Updater->OnUpdateComplete.AddUObject(this, &ThisClass::OnNavMeshUpdated);
 }
 
 void URsapEditorManager::Deinitialize()
@@ -40,15 +100,25 @@ void URsapEditorManager::Deinitialize()
 
 	EditorWorld.OnCollisionComponentChanged.Unbind();
 
-	// FRsapUpdater::OnUpdateComplete.RemoveAll(this);
-
+	CancelRegeneration();
+	Updater.Reset(); // Stops the thread.
 	delete Debugger;
-	NavMesh.Clear();
+	GetNavMesh().Clear();
 	
 	Super::Deinitialize();
 }
 
 void URsapEditorManager::Regenerate(const UWorld* World)
+{
+	StartRegeneration(false);
+}
+
+void URsapEditorManager::RegenerateAroundCamera(const UWorld* World)
+{
+	StartRegeneration(true);
+}
+
+void URsapEditorManager::StartRegeneration(const bool bAroundCamera, const std::vector<chunk_morton>& ChunkMCs)
 {
 	const FRsapEditorWorld& RsapWorld = FRsapEditorWorld::GetInstance();
 	
@@ -58,43 +128,130 @@ void URsapEditorManager::Regenerate(const UWorld* World)
 		return;
 	}
 
-	NavMesh.Generate(&RsapWorld);
+	// Restarts the regeneration that is in progress, since the world may have changed since it started.
+	CancelRegeneration();
 
-	if(RsapWorld.MarkDirty()) UE_LOG(LogRsap, Log, TEXT("Regeneration complete. The sound-navigation-mesh will be cached when you save the map."))
+	// Only the given chunks are regenerated within the current navmesh, which is done outward from the camera as well.
+	bRegeneratingAroundCamera = bAroundCamera || !ChunkMCs.empty();
+
+	// The updates are published after the regeneration, into the navmesh that is in use by then.
+	Updater->Pause();
+
+	if(bRegeneratingAroundCamera)
+	{
+		// Generated into the current navmesh, which is cleared, or only has the given chunks erased, and then filled in outward from the camera.
+		GenerationJob = ChunkMCs.empty() ? MakeUnique<FRsapGenerationJob>(GetNavMesh(), &RsapWorld) : MakeUnique<FRsapGenerationJob>(GetNavMesh(), &RsapWorld, ChunkMCs);
+		FVector CameraLocation = FVector::ZeroVector;
+		FRotator CameraRotation;
+		RsapWorld.GetCameraView(CameraLocation, CameraRotation);
+		GenerationJob->SetFocus(CameraLocation);
+		Debugger->Redraw();
+	}
+	else
+	{
+		// Generated into the pending navmesh, so that the current one can still be used until the new one is complete.
+		GenerationJob = MakeUnique<FRsapGenerationJob>(GetPendingNavMesh(), &RsapWorld);
+	}
+	GenerationTickerHandle = FTSTicker::GetCoreTicker().AddTicker(FTickerDelegate::CreateUObject(this, &ThisClass::TickRegeneration));
+
+	FNotificationInfo NotificationInfo(FText::FromString(TEXT("Regenerating the sound-navigation-mesh")));
+	NotificationInfo.bFireAndForget = false;
+	NotificationInfo.bUseThrobber = true;
+	NotificationInfo.ButtonDetails.Add(FNotificationButtonInfo(
+		FText::FromString(TEXT("Cancel")),
+		FText::FromString(bRegeneratingAroundCamera ? TEXT("Stops the regeneration, and keeps the chunks that are generated so far.") : TEXT("Stops the regeneration, and keeps the current sound-navigation-mesh.")),
+		FSimpleDelegate::CreateUObject(this, &ThisClass::CancelRegeneration),
+		SNotificationItem::CS_Pending
+	));
+	GenerationNotification = FSlateNotificationManager::Get().AddNotification(NotificationInfo);
+	if(GenerationNotification) GenerationNotification->SetCompletionState(SNotificationItem::CS_Pending);
+}
+
+void URsapEditorManager::CancelRegeneration()
+{
+	if(!GenerationJob) return;
+	FTSTicker::GetCoreTicker().RemoveTicker(GenerationTickerHandle);
+	EndRegeneration(false);
+	UE_LOG(LogRsap, Log, TEXT("Regeneration cancelled."))
+}
+
+bool URsapEditorManager::TickRegeneration(const float DeltaTime)
+{
+	const uint32 CompletedBatchCount = GenerationJob->GetCompletedBatchCount();
+	if(bRegeneratingAroundCamera)
+	{
+		FVector CameraLocation;
+		FRotator CameraRotation;
+		if(FRsapEditorWorld::GetInstance().GetCameraView(CameraLocation, CameraRotation)) GenerationJob->SetFocus(CameraLocation);
+	}
+
+	if(!GenerationJob->Tick(GenerationBudgetMs / 1000.0))
+	{
+		// Show the chunks that have been completed around the camera.
+		if(bRegeneratingAroundCamera && GenerationJob->GetCompletedBatchCount() != CompletedBatchCount) Debugger->Redraw();
+
+		if(GenerationNotification)
+		{
+			GenerationNotification->SetText(FText::FromString(FString::Printf(TEXT("Regenerating the sound-navigation-mesh: %s ( %i%% )"),
+				GenerationJob->GetPhaseName(), FMath::RoundToInt(GenerationJob->GetProgress() * 100.f))));
+		}
+		return true;
+	}
+
+	// Swap in the new navmesh, and free the old one. Generating around the camera is done in the current navmesh.
+	if(!bRegeneratingAroundCamera) NavMeshIdx ^= 1;
+	Debugger->SetNavmesh(GetNavMesh());
+	EndRegeneration(true);
+
+	if(FRsapEditorWorld::GetInstance().MarkDirty()) UE_LOG(LogRsap, Log, TEXT("Regeneration complete. The sound-navigation-mesh will be cached when you save the map."))
+	return false;
+}
+
+// Destroys the job, and clears whichever navmesh is not in use.
+void URsapEditorManager::EndRegeneration(const bool bSuccess)
+{
+	GenerationJob.Reset();
+	GenerationTickerHandle.Reset();
+	GetPendingNavMesh().Clear();
+	Updater->SetNavmesh(GetNavMesh());
+	Updater->Resume();
+
+	if(!GenerationNotification) return;
+	GenerationNotification->SetText(FText::FromString(bSuccess ? TEXT("Regenerated the sound-navigation-mesh") : TEXT("Cancelled regenerating the sound-navigation-mesh")));
+	GenerationNotification->SetCompletionState(bSuccess ? SNotificationItem::CS_Success : SNotificationItem::CS_Fail);
+	GenerationNotification->ExpireAndFadeout();
+	GenerationNotification.Reset();
 }
 
 void URsapEditorManager::OnMapOpened(const IRsapWorld* RsapWorld)
 {
+	CancelRegeneration();
+	Updater->Stop();
 	Debugger->Stop();
 	
-	// switch (const auto [Result, MismatchedActors] = NavMesh.Load(RsapWorld); Result) {
-	// 	case ERsapNavmeshLoadResult::Success: break;
-	// 	case ERsapNavmeshLoadResult::NotFound:
-	// 		NavMesh.Generate(RsapWorld);
-	// 		if(RsapWorld->MarkDirty()) UE_LOG(LogRsap, Log, TEXT("Generation complete. The sound-navigation-mesh will be cached when you save the map."))
-	// 		break;
-	// 	case ERsapNavmeshLoadResult::MisMatch:
-	// 		// NavMesh.Regenerate(RsapWorld, MismatchedActors);
-	// 		// if(RsapWorld->MarkDirty()) UE_LOG(LogRsap, Log, TEXT("Regenerated out-of-sync areas. The sound-navigation-mesh will be cached when you save the map."))
-	// 		break;
-	// }
+	switch (const auto [Result, MismatchedChunkMCs] = GetNavMesh().Load(RsapWorld); Result) {
+		case ERsapNavmeshLoadResult::Success: break;
+		case ERsapNavmeshLoadResult::NotFound:
+			StartRegeneration(false);
+			break;
+		case ERsapNavmeshLoadResult::MisMatch:
+			// Only the out-of-sync chunks are regenerated, which is time-sliced as well because it could be most of the navmesh.
+			UE_LOG(LogRsap, Log, TEXT("Regenerating %llu out-of-sync chunks."), static_cast<uint64>(MismatchedChunkMCs.size()))
+			StartRegeneration(false, MismatchedChunkMCs);
+			break;
+	}
 
 	Debugger->Start();
+	Updater->Start(RsapWorld);
+}
 
-	// Start the updater/debugger. todo: stop before closing map.
-	// FRsapUpdater::GetInstance().Start(World, NavMesh);
-	
-	// Backup code to wait for update complete ( for PIE start during update scenario ):
-	// NavMeshUpdater->StageData(Data);
-	// auto OnNavMeshUpdatedHandlePtr = MakeShared<FDelegateHandle>();
-	// *OnNavMeshUpdatedHandlePtr = FRsapUpdater::OnUpdateComplete.AddLambda([OnNavMeshUpdatedHandlePtr, &World = EditorWorld]()
-	// {
-	// 	FRsapUpdater::OnUpdateComplete.Remove(*OnNavMeshUpdatedHandlePtr);
-	// 	if(World->GetOuter()->MarkPackageDirty())
-	// 	{
-	// 		UE_LOG(LogRsap, Log, TEXT("Regeneration complete. The sound-navigation-mesh will be cached when you save the map."))
-	// 	}
-	// });
+// The map is closed, so stop using its world until the next map is opened.
+void URsapEditorManager::OnWorldCleanup(UWorld* World, bool bSessionEnded, bool bCleanupResources)
+{
+	if(World != FRsapEditorWorld::GetInstance().GetWorld()) return;
+	CancelRegeneration();
+	Updater->Stop();
+	Debugger->Stop();
 }
 
 void URsapEditorManager::PreMapSaved()
@@ -104,12 +261,21 @@ void URsapEditorManager::PreMapSaved()
 
 void URsapEditorManager::PostMapSaved(const bool bSuccess)
 {
-	// if(bSuccess) NavMesh.Save(); // todo: check if this also runs if a different level is saved from the one that is opened?
+	if(!bSuccess) return;
+
+	// A navmesh that is still being generated or updated is incomplete, so it is cached on the next save after it has completed.
+	if(GenerationJob || Updater->IsUpdating())
+	{
+		UE_LOG(LogRsap, Warning, TEXT("The sound-navigation-mesh is still being generated or updated, and will be cached on the next save."))
+		return;
+	}
+	GetNavMesh().Save(&FRsapEditorWorld::GetInstance()); // todo: check if this also runs if a different level is saved from the one that is opened?
 }
 
 void URsapEditorManager::OnCollisionComponentChanged(const FRsapCollisionComponentChangedResult& ChangedResult)
 {
 	UE_LOG(LogRsap, Warning, TEXT("RsapEditorManager::OnCollisionComponentChanged"))
+	Updater->StageComponent(ChangedResult);
 	switch (ChangedResult.Type)
 	{
 		case ERsapCollisionComponentChangedType::Added:		UE_LOG(LogRsap, Warning, TEXT("Added")); break;
@@ -120,13 +286,22 @@ void URsapEditorManager::OnCollisionComponentChanged(const FRsapCollisionCompone
 	}
 
 	if(ChangedResult.Type == ERsapCollisionComponentChangedType::Deleted) return;
-	UStaticMeshComponent* SM = Cast<UStaticMeshComponent>(ChangedResult.Component->GetPrimitive());
+	UStaticMeshComponent* SM = Cast<UStaticMeshComponent>(ChangedResult.GetComponent()->GetPrimitive());
 	if(!SM || !SM->GetStaticMesh()) return;
 	ComponentChangedResults.Add(SM);
 }
 
 void URsapEditorManager::OnWorldPostActorTick(UWorld* World, ELevelTick TickType, float DeltaSeconds)
 {
+	// The updates near the camera are prioritized.
+	Updater->PublishBudgetMs = UpdateBudgetMs;
+	Updater->ImmediateRadius = UpdateImmediateRadius;
+	Updater->SettleDelayMs = UpdateSettleDelayMs;
+	Updater->MaxSettleDelayMs = UpdateMaxSettleDelayMs;
+	FVector CameraLocation;
+	FRotator CameraRotation;
+	if(FRsapEditorWorld::GetInstance().GetCameraView(CameraLocation, CameraRotation)) Updater->SetFocus(CameraLocation);
+
 	if (ComponentChangedResults.IsEmpty()) return;
 	FVoxelizationInterface::Dispatch(FVoxelizationDispatchParams(MoveTemp(ComponentChangedResults)), [this](const TArray<FUintVector3>& Vertices)
 	{
@@ -152,13 +327,43 @@ FVector Transform(const FVector& Location, const FTransform& ActorTransform)
 	return ActorTransform.GetLocation() + RotatedPosition;
 }
 
-void URsapEditorManager::OnNavMeshUpdated() const {}
+void URsapEditorManager::OnNavMeshUpdated() const
+{
+	Debugger->Redraw();
+	if(FRsapEditorWorld::GetInstance().MarkDirty()) UE_LOG(LogRsap, Log, TEXT("The sound-navigation-mesh has been updated, and will be cached when you save the map."))
+}
 
 
 
 void URsapEditorManager::ProfileGeneration() const
 {
-	
+	const FRsapEditorWorld& RsapWorld = FRsapEditorWorld::GetInstance();
+	if(!RsapWorld.GetWorld())
+	{
+		UE_LOG(LogRsap, Warning, TEXT("Profile-Generation: cannot generate the sound-navigation-mesh without an active world."));
+		return;
+	}
+
+	// Generated into separate navmeshes, so the one used by the editor stays untouched.
+	const auto Measure = [&](FRsapNavmesh& OutNavMesh, const ERsapNodeOrder NodeOrder) -> int64
+	{
+		const auto StartTime = std::chrono::high_resolution_clock::now();
+		OutNavMesh.Generate(&RsapWorld, NodeOrder);
+		const auto EndTime = std::chrono::high_resolution_clock::now();
+		return std::chrono::duration_cast<std::chrono::microseconds>(EndTime - StartTime).count();
+	};
+
+	FRsapNavmesh AxisNavMesh;
+	FRsapNavmesh MortonNavMesh;
+	const int64 AxisTime = Measure(AxisNavMesh, ERsapNodeOrder::Axis);
+	const int64 MortonTime = Measure(MortonNavMesh, ERsapNodeOrder::Morton);
+	UE_LOG(LogRsap, Warning, TEXT("Profile-Generation: axis-order took '%lld' micro-seconds, morton-order took '%lld' micro-seconds ( %.2fx )."),
+		AxisTime, MortonTime, MortonTime ? static_cast<double>(AxisTime) / MortonTime : 0.0)
+
+	// Both orders should result in the exact same nodes.
+	const bool bIdentical = IsSameNavMesh(AxisNavMesh, MortonNavMesh);
+	if(bIdentical) UE_LOG(LogRsap, Warning, TEXT("Profile-Generation: both orders generated the same %llu chunks."), static_cast<uint64>(AxisNavMesh.Chunks.size()))
+	else UE_LOG(LogRsap, Error, TEXT("Profile-Generation: the orders generated different nodes!"))
 }
 
 void URsapEditorManager::ProfileIteration() const
@@ -171,14 +376,14 @@ void URsapEditorManager::ProfileIteration() const
 	bool bNodesOrdered = true;
 	for (int i = 0; i < 50000; ++i)
 	{
-		for(const auto& [ChunkMC, Chunk] : NavMesh.Chunks)
+		for(const auto& [ChunkMC, Chunk] : GetNavMesh().Chunks)
 		{
 			if(LastChunkMC && ChunkMC < LastChunkMC) bChunksOrdered = false;
 			LastChunkMC = ChunkMC;
 			for (const auto& LayerPtr : Chunk.Octrees[0]->Layers)
 			{
 				node_morton LastNodeMC = 0;
-				for (const auto& NodeMC : *LayerPtr | std::views::keys)
+				for (const auto& [NodeMC, Node] : *LayerPtr)
 				{
 					if(LastNodeMC && NodeMC < LastNodeMC) bNodesOrdered = false;
 					LastNodeMC = NodeMC;
@@ -196,3 +401,517 @@ void URsapEditorManager::ProfileIteration() const
 	UE_LOG(LogRsap, Warning, TEXT("'%lld' milli-seconds"), std::chrono::duration_cast<std::chrono::milliseconds>(EndTime - StartTime).count());
 	UE_LOG(LogRsap, Warning, TEXT("'%lld' micro-seconds"), std::chrono::duration_cast<std::chrono::microseconds>(EndTime - StartTime).count());
 }
+
+void URsapEditorManager::ProfileMemory() const
+{
+	const FRsapMemoryReport Report = GetNavMesh().GetMemoryReport();
+	Report.Log(TEXT("Navmesh"));
+
+	const FString FilePath = FPaths::ProfilingDir() / TEXT("Rsap") / TEXT("NavmeshMemory.csv");
+	if(Report.SaveCSV(FilePath)) UE_LOG(LogRsap, Log, TEXT("Memory report saved to '%s'"), *FilePath)
+}
+
+void URsapEditorManager::ProfileMorton() const
+{
+	static constexpr int32 Count = 1 << 20;
+	static constexpr int32 Iterations = 32;
+
+	// Random coordinates within the range of nodes and chunks.
+	std::vector<FUintVector3> Coordinates(Count);
+	FRandomStream Random(12345);
+	for (FUintVector3& Coordinate : Coordinates) Coordinate = FUintVector3(Random.RandHelper(1 << 21), Random.RandHelper(1 << 21), Random.RandHelper(1 << 21));
+
+	// Runs the callback over all coordinates, and returns the nano-seconds per call.
+	const auto Measure = [&](auto&& Callback) -> double
+	{
+		const auto StartTime = std::chrono::high_resolution_clock::now();
+		for (int32 i = 0; i < Iterations; ++i) for (const FUintVector3& Coordinate : Coordinates) Callback(Coordinate);
+		const auto EndTime = std::chrono::high_resolution_clock::now();
+		return std::chrono::duration<double, std::nano>(EndTime - StartTime).count() / (static_cast<double>(Count) * Iterations);
+	};
+
+	uint64 Checksum = 0; // Prevents the calls from being optimized away.
+	const double NodeEncodeLUT = Measure([&](const FUintVector3& C){ Checksum += libmorton::morton3D_32_encode(C.X & 1023, C.Y & 1023, C.Z & 1023); });
+	const double NodeDecodeLUT = Measure([&](const FUintVector3& C){ uint_fast16_t X, Y, Z; libmorton::morton3D_32_decode(C.X, X, Y, Z); Checksum += X + Y + Z; });
+	const double ChunkEncodeLUT = Measure([&](const FUintVector3& C){ Checksum += libmorton::morton3D_64_encode(C.X, C.Y, C.Z); });
+	const double ChunkDecodeLUT = Measure([&](const FUintVector3& C){ uint_fast32_t X, Y, Z; libmorton::morton3D_64_decode(static_cast<uint64>(C.X) << 32 | C.Y, X, Y, Z); Checksum += X + Y + Z; });
+	
+	UE_LOG(LogRsap, Warning, TEXT("Profile-Morton: lookup-tables take %.2f / %.2f ns for node encode / decode, and %.2f / %.2f ns for chunk encode / decode."), NodeEncodeLUT, NodeDecodeLUT, ChunkEncodeLUT, ChunkDecodeLUT)
+
+	if(!FMortonUtils::bUseBMI2)
+	{
+		UE_LOG(LogRsap, Warning, TEXT("Profile-Morton: this CPU has no fast BMI2 instructions, so the lookup-tables are used. Checksum: %llu"), Checksum)
+		return;
+	}
+
+	const double NodeEncodeBMI2 = Measure([&](const FUintVector3& C){ Checksum += FMortonUtils::BMI2::EncodeNode(C.X & 1023, C.Y & 1023, C.Z & 1023); });
+	const double NodeDecodeBMI2 = Measure([&](const FUintVector3& C){ uint32 X, Y, Z; FMortonUtils::BMI2::DecodeNode(C.X, X, Y, Z); Checksum += X + Y + Z; });
+	const double ChunkEncodeBMI2 = Measure([&](const FUintVector3& C){ Checksum += FMortonUtils::BMI2::EncodeChunk(C.X, C.Y, C.Z); });
+	const double ChunkDecodeBMI2 = Measure([&](const FUintVector3& C){ uint64 X, Y, Z; FMortonUtils::BMI2::DecodeChunk(static_cast<uint64>(C.X) << 32 | C.Y, X, Y, Z); Checksum += X + Y + Z; });
+	
+	UE_LOG(LogRsap, Warning, TEXT("Profile-Morton: BMI2 takes %.2f / %.2f ns for node encode / decode, and %.2f / %.2f ns for chunk encode / decode."), NodeEncodeBMI2, NodeDecodeBMI2, ChunkEncodeBMI2, ChunkDecodeBMI2)
+	UE_LOG(LogRsap, Warning, TEXT("Profile-Morton: speedup of %.2fx / %.2fx for nodes, and %.2fx / %.2fx for chunks. Checksum: %llu"),
+		NodeEncodeLUT / NodeEncodeBMI2, NodeDecodeLUT / NodeDecodeBMI2, ChunkEncodeLUT / ChunkEncodeBMI2, ChunkDecodeLUT / ChunkDecodeBMI2, Checksum)
+
+	// Both should give the exact same results.
+	int32 Mismatches = 0;
+	for (const FUintVector3& C : Coordinates)
+	{
+		if(FMortonUtils::BMI2::EncodeNode(C.X & 1023, C.Y & 1023, C.Z & 1023) != libmorton::morton3D_32_encode(C.X & 1023, C.Y & 1023, C.Z & 1023)) ++Mismatches;
+		if(FMortonUtils::BMI2::EncodeChunk(C.X, C.Y, C.Z) != libmorton::morton3D_64_encode(C.X, C.Y, C.Z)) ++Mismatches;
+
+		uint32 NodeX, NodeY, NodeZ;
+		uint_fast16_t ExpectedNodeX, ExpectedNodeY, ExpectedNodeZ;
+		FMortonUtils::BMI2::DecodeNode(C.X, NodeX, NodeY, NodeZ);
+		libmorton::morton3D_32_decode(C.X, ExpectedNodeX, ExpectedNodeY, ExpectedNodeZ);
+		if(NodeX != ExpectedNodeX || NodeY != ExpectedNodeY || NodeZ != ExpectedNodeZ) ++Mismatches;
+
+		const uint64 ChunkMC = static_cast<uint64>(C.X) << 32 | C.Y;
+		uint64 X, Y, Z;
+		uint_fast32_t ExpectedX, ExpectedY, ExpectedZ;
+		FMortonUtils::BMI2::DecodeChunk(ChunkMC, X, Y, Z);
+		libmorton::morton3D_64_decode(ChunkMC, ExpectedX, ExpectedY, ExpectedZ);
+		if(X != ExpectedX || Y != ExpectedY || Z != ExpectedZ) ++Mismatches;
+	}
+	if(Mismatches) UE_LOG(LogRsap, Error, TEXT("Profile-Morton: %i results differ between BMI2 and the lookup-tables!"), Mismatches)
+	else UE_LOG(LogRsap, Warning, TEXT("Profile-Morton: BMI2 results are identical to the lookup-tables."))
+}
+
+void URsapEditorManager::ProfileRangeQuery() const
+{
+	static constexpr int32 BoxesPerChunk = 16;
+	static constexpr layer_idx DeepestLayer = 7; // The lookups visit every node-location, which is too slow for the deeper layers.
+
+	// Random boxes within every chunk.
+	std::vector<std::pair<const FRsapChunk*, FRsapBounds>> Queries;
+	FRandomStream Random(12345);
+	for(const auto& [ChunkMC, Chunk] : GetNavMesh().Chunks)
+	{
+		const FRsapVector32 ChunkLocation = FRsapVector32::FromChunkMorton(ChunkMC);
+		for (int32 i = 0; i < BoxesPerChunk; ++i)
+		{
+			const FRsapVector32 Min = ChunkLocation + FRsapVector32(Random.RandHelper(Chunk::Size), Random.RandHelper(Chunk::Size), Random.RandHelper(Chunk::Size));
+			const FRsapVector32 Max = Min + FRsapVector32(Random.RandHelper(Chunk::Size), Random.RandHelper(Chunk::Size), Random.RandHelper(Chunk::Size));
+			const FRsapBounds Bounds = FRsapBounds(Min, Max + 1).Clamp(FRsapBounds::FromChunkMorton(ChunkMC));
+			Queries.emplace_back(&Chunk, Bounds);
+		}
+	}
+
+	uint64 LookupCount = 0;
+	const auto LookupStartTime = std::chrono::high_resolution_clock::now();
+	for (const auto& [Chunk, Bounds] : Queries)
+	{
+		for (layer_idx LayerIdx = 0; LayerIdx <= DeepestLayer; ++LayerIdx)
+		{
+			Bounds.ForEachNode(LayerIdx, [&](const node_morton NodeMC, const FRsapVector32&)
+			{
+				FRsapNode FoundNode;
+				if(Chunk->FindNode(FoundNode, NodeMC, LayerIdx, Node::State::Static)) ++LookupCount;
+			});
+		}
+	}
+	const auto LookupEndTime = std::chrono::high_resolution_clock::now();
+
+	uint64 RangeCount = 0;
+	const auto RangeStartTime = std::chrono::high_resolution_clock::now();
+	for (const auto& [Chunk, Bounds] : Queries)
+	{
+		for (layer_idx LayerIdx = 0; LayerIdx <= DeepestLayer; ++LayerIdx)
+		{
+			Chunk->ForEachNodeInBounds(Bounds, LayerIdx, Node::State::Static, [&](const node_morton, const FRsapNode&)
+			{
+				++RangeCount;
+			});
+		}
+	}
+	const auto RangeEndTime = std::chrono::high_resolution_clock::now();
+
+	const int64 LookupTime = std::chrono::duration_cast<std::chrono::microseconds>(LookupEndTime - LookupStartTime).count();
+	const int64 RangeTime = std::chrono::duration_cast<std::chrono::microseconds>(RangeEndTime - RangeStartTime).count();
+	UE_LOG(LogRsap, Warning, TEXT("Profile-Range-Query: %llu boxes, lookups took '%lld' micro-seconds, morton-ranges took '%lld' micro-seconds ( %.2fx )."),
+		static_cast<uint64>(Queries.size()), LookupTime, RangeTime, RangeTime ? static_cast<double>(LookupTime) / RangeTime : 0.0)
+
+	if(LookupCount != RangeCount) UE_LOG(LogRsap, Error, TEXT("Profile-Range-Query: lookups found %llu nodes, but morton-ranges found %llu!"), LookupCount, RangeCount)
+	else UE_LOG(LogRsap, Warning, TEXT("Profile-Range-Query: both found %llu nodes."), LookupCount)
+}
+
+void URsapEditorManager::ProfileOverlap() const
+{
+	static constexpr layer_idx ExtraLayers = 2; // Also compares the nodes of a few layers below the optimal one, which are the ones tested while rasterizing.
+
+	const FRsapEditorWorld& RsapWorld = FRsapEditorWorld::GetInstance();
+	if(!RsapWorld.GetWorld())
+	{
+		UE_LOG(LogRsap, Warning, TEXT("Profile-Overlap: cannot query the geometry without an active world."));
+		return;
+	}
+
+	// Every node around the components that have triangles, tested with the same collision as the rasterizer would.
+	// The optimal layer and the nodes within the AABB use the complex-collision, the nodes that intersect the border of the AABB use the simple-collision.
+	struct FQuery
+	{
+		const FRsapCollisionComponent* Component;
+		FRsapVector32 NodeLocation;
+		layer_idx LayerIdx;
+		bool bComplex;
+	};
+	std::vector<FQuery> Queries;
+	const FRsapCollisionComponentRegistry& ComponentRegistry = FRsapCollisionComponentRegistry::Get();
+	for (const auto& RsapActor : RsapWorld.GetActors() | std::views::values)
+	{
+		for (const FRsapCollisionComponentHandle ComponentHandle : RsapActor->GetCollisionComponents())
+		{
+			const FRsapCollisionComponent* Component = ComponentRegistry.Find(ComponentHandle);
+			if(!Component || !Component->GetTriangleBVH()) continue;
+
+			const FRsapBounds& Bounds = Component->GetBoundaries();
+			const layer_idx OptimalLayer = Bounds.GetOptimalRasterizationLayer();
+			const layer_idx DeepestLayer = FMath::Min<layer_idx>(OptimalLayer + ExtraLayers, Layer::NodeDepth);
+			Bounds.ForEachChunk([&](const chunk_morton, const FRsapVector32&, const FRsapBounds& Intersection)
+			{
+				for (layer_idx LayerIdx = OptimalLayer; LayerIdx <= DeepestLayer; ++LayerIdx)
+				{
+					Intersection.ForEachNode(LayerIdx, [&](const node_morton, const FRsapVector32& NodeLocation)
+					{
+						const EAABBOverlapResult AABBOverlap = LayerIdx == OptimalLayer ? EAABBOverlapResult::Contained : FRsapNode::HasAABBIntersection(Bounds, NodeLocation, LayerIdx);
+						if(AABBOverlap != EAABBOverlapResult::NoOverlap) Queries.push_back({Component, NodeLocation, LayerIdx, AABBOverlap == EAABBOverlapResult::Contained});
+					});
+				}
+			});
+		}
+	}
+	FRsapOverlap::InitCollisionBoxes();
+
+	// The physics-queries lock the scene once per component, the same as the generation does.
+	std::vector<bool> PhysicsResults(Queries.size());
+	const auto PhysicsStartTime = std::chrono::high_resolution_clock::now();
+	for (size_t Begin = 0, End; Begin < Queries.size(); Begin = End)
+	{
+		const FRsapCollisionComponent* Component = Queries[Begin].Component;
+		for (End = Begin + 1; End < Queries.size() && Queries[End].Component == Component; ++End) {}
+		FPhysicsCommand::ExecuteRead(Component->GetPrimitive()->BodyInstance.ActorHandle, [&](const FPhysicsActorHandle&)
+		{
+			for (size_t Idx = Begin; Idx < End; ++Idx)
+			{
+				PhysicsResults[Idx] = FRsapOverlap::Component(Component->GetPrimitive(), Queries[Idx].NodeLocation, Queries[Idx].LayerIdx, Queries[Idx].bComplex);
+			}
+		});
+	}
+	const auto PhysicsEndTime = std::chrono::high_resolution_clock::now();
+
+	// The same overlap-test as the rasterizer, which only locks the scene for the components that still need it for their simple tests.
+	std::vector<bool> TriangleResults(Queries.size());
+	const auto TriangleStartTime = std::chrono::high_resolution_clock::now();
+	for (size_t Begin = 0, End; Begin < Queries.size(); Begin = End)
+	{
+		const FRsapCollisionComponent* Component = Queries[Begin].Component;
+		for (End = Begin + 1; End < Queries.size() && Queries[End].Component == Component; ++End) {}
+		const auto Test = [&]
+		{
+			for (size_t Idx = Begin; Idx < End; ++Idx)
+			{
+				TriangleResults[Idx] = FRsapNode::HasComponentOverlap(*Component, Queries[Idx].NodeLocation, Queries[Idx].LayerIdx, Queries[Idx].bComplex);
+			}
+		};
+		if(!Component->NeedsPhysicsScene()) Test();
+		else FPhysicsCommand::ExecuteRead(Component->GetPrimitive()->BodyInstance.ActorHandle, [&](const FPhysicsActorHandle&){ Test(); });
+	}
+	const auto TriangleEndTime = std::chrono::high_resolution_clock::now();
+
+	const int64 PhysicsTime = std::chrono::duration_cast<std::chrono::microseconds>(PhysicsEndTime - PhysicsStartTime).count();
+	const int64 TriangleTime = std::chrono::duration_cast<std::chrono::microseconds>(TriangleEndTime - TriangleStartTime).count();
+	UE_LOG(LogRsap, Warning, TEXT("Profile-Overlap: %llu nodes, physics took '%lld' micro-seconds, triangles took '%lld' micro-seconds ( %.2fx )."),
+		static_cast<uint64>(Queries.size()), PhysicsTime, TriangleTime, TriangleTime ? static_cast<double>(PhysicsTime) / TriangleTime : 0.0)
+
+	// Indexed by bComplex.
+	uint64 Counts[2] = {}, Overlapping = 0, Mismatches[2] = {};
+	for (size_t Idx = 0; Idx < Queries.size(); ++Idx)
+	{
+		++Counts[Queries[Idx].bComplex];
+		Overlapping += PhysicsResults[Idx];
+		Mismatches[Queries[Idx].bComplex] += PhysicsResults[Idx] != TriangleResults[Idx];
+	}
+	if(Mismatches[0] || Mismatches[1]) UE_LOG(LogRsap, Error, TEXT("Profile-Overlap: %llu of the %llu simple, and %llu of the %llu complex nodes have a different result than the physics-queries!"), Mismatches[0], Counts[0], Mismatches[1], Counts[1])
+	else UE_LOG(LogRsap, Warning, TEXT("Profile-Overlap: results are identical to the physics-queries for %llu simple and %llu complex nodes, %llu nodes are overlapping."), Counts[0], Counts[1], Overlapping)
+}
+
+void URsapEditorManager::ProfileVoxelization() const
+{
+	static constexpr size_t MaxLeafNodes = 100000; // Keeps the per-leaf queries from taking minutes on very large meshes.
+
+	const FRsapEditorWorld& RsapWorld = FRsapEditorWorld::GetInstance();
+	if(!RsapWorld.GetWorld())
+	{
+		UE_LOG(LogRsap, Warning, TEXT("Profile-Voxelization: cannot query the geometry without an active world."));
+		return;
+	}
+
+	// Every leaf-node around the components that have triangles.
+	struct FQuery
+	{
+		const FRsapCollisionComponent* Component;
+		FRsapVector32 NodeLocation;
+	};
+	std::vector<FQuery> Queries;
+	const FRsapCollisionComponentRegistry& ComponentRegistry = FRsapCollisionComponentRegistry::Get();
+	for (const auto& RsapActor : RsapWorld.GetActors() | std::views::values)
+	{
+		for (const FRsapCollisionComponentHandle ComponentHandle : RsapActor->GetCollisionComponents())
+		{
+			const FRsapCollisionComponent* Component = ComponentRegistry.Find(ComponentHandle);
+			if(!Component || !Component->GetTriangleBVH()) continue;
+
+			Component->GetBoundaries().ForEachChunk([&](const chunk_morton, const FRsapVector32&, const FRsapBounds& Intersection)
+			{
+				Intersection.ForEachNode(Layer::NodeDepth, [&](const node_morton, const FRsapVector32& NodeLocation)
+				{
+					if(Queries.size() < MaxLeafNodes) Queries.push_back({Component, NodeLocation});
+				});
+			});
+		}
+	}
+	FRsapOverlap::InitCollisionBoxes();
+
+	// An overlap-query per group of 8 leafs, and per leaf within the overlapping groups, which is what FRsapNavmesh::RasterizeLeaf did for every mesh.
+	const auto QueryLeafs = [](const FRsapVector32& NodeLocation, const auto& HasOverlap)
+	{
+		uint64 Leafs = 0;
+		for (child_idx LeafGroupIdx = 0; LeafGroupIdx < 8; ++LeafGroupIdx)
+		{
+			const FRsapVector32 GroupLocation = FRsapNode::GetChildLocation(NodeLocation, Layer::GroupedLeaf, LeafGroupIdx);
+			if(!HasOverlap(GroupLocation, Layer::GroupedLeaf)) continue;
+
+			uint8 GroupedLeafs = 0;
+			for (child_idx LeafIdx = 0; LeafIdx < 8; ++LeafIdx)
+			{
+				if(HasOverlap(FRsapNode::GetChildLocation(GroupLocation, Layer::Leaf, LeafIdx), Layer::Leaf)) GroupedLeafs |= Node::Children::Masks[LeafIdx];
+			}
+			Leafs |= static_cast<uint64>(GroupedLeafs) << Leaf::Children::MasksShift[LeafGroupIdx];
+		}
+		return Leafs;
+	};
+
+	// The physics-queries lock the scene once per component, the same as the generation does.
+	std::vector<uint64> PhysicsResults(Queries.size());
+	const auto PhysicsStartTime = std::chrono::high_resolution_clock::now();
+	for (size_t Begin = 0, End; Begin < Queries.size(); Begin = End)
+	{
+		const FRsapCollisionComponent* Component = Queries[Begin].Component;
+		for (End = Begin + 1; End < Queries.size() && Queries[End].Component == Component; ++End) {}
+		FPhysicsCommand::ExecuteRead(Component->GetPrimitive()->BodyInstance.ActorHandle, [&](const FPhysicsActorHandle&)
+		{
+			for (size_t Idx = Begin; Idx < End; ++Idx)
+			{
+				PhysicsResults[Idx] = QueryLeafs(Queries[Idx].NodeLocation, [&](const FRsapVector32& NodeLocation, const layer_idx LayerIdx)
+				{
+					return FRsapOverlap::Component(Component->GetPrimitive(), NodeLocation, LayerIdx, true);
+				});
+			}
+		});
+	}
+	const auto PhysicsEndTime = std::chrono::high_resolution_clock::now();
+
+	std::vector<uint64> TriangleResults(Queries.size());
+	const auto TriangleStartTime = std::chrono::high_resolution_clock::now();
+	for (size_t Idx = 0; Idx < Queries.size(); ++Idx)
+	{
+		const FRsapCollisionComponent* Component = Queries[Idx].Component;
+		TriangleResults[Idx] = QueryLeafs(Queries[Idx].NodeLocation, [&](const FRsapVector32& NodeLocation, const layer_idx LayerIdx)
+		{
+			return FRsapOverlap::Triangles(*Component->GetTriangleBVH(), Component->GetTransform(), NodeLocation, LayerIdx);
+		});
+	}
+	const auto TriangleEndTime = std::chrono::high_resolution_clock::now();
+
+	std::vector<uint64> VoxelizerResults(Queries.size());
+	const auto VoxelizerStartTime = std::chrono::high_resolution_clock::now();
+	for (size_t Idx = 0; Idx < Queries.size(); ++Idx)
+	{
+		const FRsapCollisionComponent* Component = Queries[Idx].Component;
+		VoxelizerResults[Idx] = FRsapVoxelizer::LeafNode(*Component->GetTriangleBVH(), Component->GetTransform(), Queries[Idx].NodeLocation);
+	}
+	const auto VoxelizerEndTime = std::chrono::high_resolution_clock::now();
+
+	const int64 PhysicsTime = std::chrono::duration_cast<std::chrono::microseconds>(PhysicsEndTime - PhysicsStartTime).count();
+	const int64 TriangleTime = std::chrono::duration_cast<std::chrono::microseconds>(TriangleEndTime - TriangleStartTime).count();
+	const int64 VoxelizerTime = std::chrono::duration_cast<std::chrono::microseconds>(VoxelizerEndTime - VoxelizerStartTime).count();
+	UE_LOG(LogRsap, Warning, TEXT("Profile-Voxelization: %llu leaf-nodes, per-leaf physics took '%lld' micro-seconds, per-leaf triangles took '%lld' micro-seconds, voxelizer took '%lld' micro-seconds ( %.2fx / %.2fx )."),
+		static_cast<uint64>(Queries.size()), PhysicsTime, TriangleTime, VoxelizerTime,
+		VoxelizerTime ? static_cast<double>(PhysicsTime) / VoxelizerTime : 0.0, VoxelizerTime ? static_cast<double>(TriangleTime) / VoxelizerTime : 0.0)
+
+	// The voxelizer is conservative, so it may set a leaf that only touches a triangle within its epsilon, but it should never miss one.
+	uint64 Occluded = 0, Missing = 0, Extra = 0;
+	for (size_t Idx = 0; Idx < Queries.size(); ++Idx)
+	{
+		Occluded += FMath::CountBits(PhysicsResults[Idx]);
+		Missing += FMath::CountBits(PhysicsResults[Idx] & ~VoxelizerResults[Idx]);
+		Extra += FMath::CountBits(VoxelizerResults[Idx] & ~PhysicsResults[Idx]);
+	}
+	if(Missing) UE_LOG(LogRsap, Error, TEXT("Profile-Voxelization: the voxelizer missed %llu of the %llu occluded leafs!"), Missing, Occluded)
+	else UE_LOG(LogRsap, Warning, TEXT("Profile-Voxelization: no leafs are missed, %llu leafs are occluded, %llu extra leafs are touching a triangle."), Occluded, Extra)
+}
+
+void URsapEditorManager::ProfileOctreeBuild() const
+{
+	static constexpr uint32 LeafNodeCount = 1000000;
+	static constexpr node_morton RegionMask = (1 << 21) - 1; // 128 leaf-nodes on each axis, so that the leaf-nodes share their parents.
+
+	// Random leaf-nodes in a random order, with duplicates.
+	FRandomStream Random(LeafNodeCount);
+	std::vector<std::pair<node_morton, uint64>> LeafNodes(LeafNodeCount);
+	for (auto& [NodeMC, Leafs] : LeafNodes)
+	{
+		NodeMC = static_cast<node_morton>(Random.GetUnsignedInt()) & RegionMask;
+		Leafs = static_cast<uint64>(Random.GetUnsignedInt()) << 32 | Random.GetUnsignedInt();
+	}
+
+	// Top-down: init each leaf-node, and walk up its parents until one already exists.
+	FRsapChunk TopDownChunk;
+	const auto TopDownStartTime = std::chrono::high_resolution_clock::now();
+	for (const auto& [NodeMC, Leafs] : LeafNodes)
+	{
+		bool bWasInserted;
+		TopDownChunk.TryInitLeafNode(bWasInserted, NodeMC, Node::State::Static).Leafs |= Leafs;
+
+		node_morton ChildNodeMC = NodeMC;
+		for (layer_idx LayerIdx = Layer::NodeDepth; bWasInserted && LayerIdx > 0; --LayerIdx)
+		{
+			const node_morton ParentNodeMC = FMortonUtils::Node::GetParent(ChildNodeMC, LayerIdx-1);
+			TopDownChunk.TryInitNode(bWasInserted, ParentNodeMC, LayerIdx-1, Node::State::Static).SetChildActive(FMortonUtils::Node::GetChildIndex(ChildNodeMC, LayerIdx));
+			ChildNodeMC = ParentNodeMC;
+		}
+	}
+	const auto TopDownEndTime = std::chrono::high_resolution_clock::now();
+
+	// Bottom-up, including adding the nodes to the builder.
+	FRsapChunk BottomUpChunk;
+	FRsapOctreeBuilder Builder;
+	const auto BottomUpStartTime = std::chrono::high_resolution_clock::now();
+	for (const auto& [NodeMC, Leafs] : LeafNodes) Builder.AddLeafNode(NodeMC, Leafs);
+	Builder.Build(*BottomUpChunk.Octrees[Node::State::Static]);
+	const auto BottomUpEndTime = std::chrono::high_resolution_clock::now();
+
+	const int64 TopDownTime = std::chrono::duration_cast<std::chrono::microseconds>(TopDownEndTime - TopDownStartTime).count();
+	const int64 BottomUpTime = std::chrono::duration_cast<std::chrono::microseconds>(BottomUpEndTime - BottomUpStartTime).count();
+	UE_LOG(LogRsap, Warning, TEXT("Profile-Octree-Build: %u leaf-nodes, top-down took '%lld' micro-seconds, bottom-up took '%lld' micro-seconds ( %.2fx )."),
+		LeafNodeCount, TopDownTime, BottomUpTime, BottomUpTime ? static_cast<double>(TopDownTime) / BottomUpTime : 0.0)
+
+	// Both should have the same nodes, with the same children and leafs.
+	const auto& TopDownOctree = *TopDownChunk.Octrees[Node::State::Static];
+	const bool bIdentical = IsSameOctree(TopDownOctree, *BottomUpChunk.Octrees[Node::State::Static], false);
+	size_t NodeCount = TopDownOctree.LeafNodes->size();
+	for (const auto& Layer : TopDownOctree.Layers) NodeCount += Layer->size();
+
+	if(bIdentical) UE_LOG(LogRsap, Warning, TEXT("Profile-Octree-Build: both octrees have the same %llu nodes."), static_cast<uint64>(NodeCount))
+	else UE_LOG(LogRsap, Error, TEXT("Profile-Octree-Build: the octrees have different nodes!"))
+}
+
+void URsapEditorManager::ProfileGenerationScaling() const
+{
+	const FRsapEditorWorld& RsapWorld = FRsapEditorWorld::GetInstance();
+	if(!RsapWorld.GetWorld())
+	{
+		UE_LOG(LogRsap, Warning, TEXT("Profile-Generation-Scaling: cannot generate the sound-navigation-mesh without an active world."));
+		return;
+	}
+
+	const auto Measure = [&](FRsapNavmesh& OutNavMesh, const int32 ThreadCount) -> int64
+	{
+		const auto StartTime = std::chrono::high_resolution_clock::now();
+		OutNavMesh.Generate(&RsapWorld, ERsapNodeOrder::Morton, ThreadCount);
+		const auto EndTime = std::chrono::high_resolution_clock::now();
+		return std::chrono::duration_cast<std::chrono::microseconds>(EndTime - StartTime).count();
+	};
+
+	// Generated into separate navmeshes, so the one used by the editor stays untouched.
+	FRsapNavmesh SingleThreadedNavMesh;
+	const int64 SingleThreadedTime = Measure(SingleThreadedNavMesh, 1);
+	UE_LOG(LogRsap, Warning, TEXT("Profile-Generation-Scaling: 1 thread took '%lld' micro-seconds for %llu chunks."), SingleThreadedTime, static_cast<uint64>(SingleThreadedNavMesh.Chunks.size()))
+
+	// Doubles the threads each step, and always ends with every worker-thread.
+	const int32 MaxThreadCount = FTaskGraphInterface::Get().GetNumWorkerThreads() + 1;
+	std::vector<int32> ThreadCounts;
+	for (int32 ThreadCount = 2; ThreadCount < MaxThreadCount; ThreadCount *= 2) ThreadCounts.push_back(ThreadCount);
+	if(MaxThreadCount > 1) ThreadCounts.push_back(MaxThreadCount);
+
+	for (const int32 ThreadCount : ThreadCounts)
+	{
+		FRsapNavmesh NavMesh;
+		const int64 Time = Measure(NavMesh, ThreadCount);
+		const bool bIdentical = IsSameNavMesh(SingleThreadedNavMesh, NavMesh);
+		UE_LOG(LogRsap, Warning, TEXT("Profile-Generation-Scaling: %i threads took '%lld' micro-seconds ( %.2fx )."),
+			ThreadCount, Time, Time ? static_cast<double>(SingleThreadedTime) / Time : 0.0)
+		if(!bIdentical) UE_LOG(LogRsap, Error, TEXT("Profile-Generation-Scaling: %i threads generated a different navmesh than a single thread!"), ThreadCount)
+	}
+}
+
+void URsapEditorManager::ProfileTimeSlicedGeneration() const
+{
+	const FRsapEditorWorld& RsapWorld = FRsapEditorWorld::GetInstance();
+	if(!RsapWorld.GetWorld())
+	{
+		UE_LOG(LogRsap, Warning, TEXT("Profile-Time-Sliced-Generation: cannot generate the sound-navigation-mesh without an active world."));
+		return;
+	}
+
+	// Generated into separate navmeshes, so the one used by the editor stays untouched.
+	FRsapNavmesh BlockingNavMesh;
+	BlockingNavMesh.Generate(&RsapWorld);
+
+	static constexpr double BudgetSeconds = 0.001;
+	FRsapNavmesh SlicedNavMesh;
+	FRsapGenerationJob Job(SlicedNavMesh, &RsapWorld);
+	int32 SliceCount = 0;
+	double LongestSlice = 0;
+	bool bComplete = false;
+	while(!bComplete)
+	{
+		const double StartTime = FPlatformTime::Seconds();
+		bComplete = Job.Tick(BudgetSeconds);
+		LongestSlice = FMath::Max(LongestSlice, FPlatformTime::Seconds() - StartTime);
+		++SliceCount;
+	}
+
+	UE_LOG(LogRsap, Warning, TEXT("Profile-Time-Sliced-Generation: took %i slices of '%.3f' milli-seconds, where the longest took '%.3f' milli-seconds."),
+		SliceCount, BudgetSeconds * 1000.0, LongestSlice * 1000.0)
+	if(IsSameNavMesh(BlockingNavMesh, SlicedNavMesh)) UE_LOG(LogRsap, Warning, TEXT("Profile-Time-Sliced-Generation: generated the same %llu chunks as generating at once."), static_cast<uint64>(SlicedNavMesh.Chunks.size()))
+	else UE_LOG(LogRsap, Error, TEXT("Profile-Time-Sliced-Generation: generated a different navmesh than generating at once!"))
+}
+
+void URsapEditorManager::ProfileStreamingGeneration() const
+{
+	const FRsapEditorWorld& RsapWorld = FRsapEditorWorld::GetInstance();
+	if(!RsapWorld.GetWorld())
+	{
+		UE_LOG(LogRsap, Warning, TEXT("Profile-Streaming-Generation: cannot generate the sound-navigation-mesh without an active world."));
+		return;
+	}
+
+	FVector CameraLocation = FVector::ZeroVector;
+	FRotator CameraRotation;
+	RsapWorld.GetCameraView(CameraLocation, CameraRotation);
+
+	// Generated into separate navmeshes, so the one used by the editor stays untouched.
+	FRsapNavmesh BlockingNavMesh;
+	const double BlockingStartTime = FPlatformTime::Seconds();
+	BlockingNavMesh.Generate(&RsapWorld);
+	const double BlockingTime = FPlatformTime::Seconds() - BlockingStartTime;
+
+	FRsapNavmesh StreamedNavMesh;
+	const double StreamingStartTime = FPlatformTime::Seconds();
+	FRsapGenerationJob Job(StreamedNavMesh, &RsapWorld);
+	Job.SetFocus(CameraLocation);
+	double FirstBatchTime = 0;
+	while(!Job.Tick(0.01))
+	{
+		if(!FirstBatchTime && Job.GetCompletedBatchCount()) FirstBatchTime = FPlatformTime::Seconds() - StreamingStartTime;
+	}
+	const double StreamingTime = FPlatformTime::Seconds() - StreamingStartTime;
+	if(!FirstBatchTime) FirstBatchTime = StreamingTime;
+
+	UE_LOG(LogRsap, Warning, TEXT("Profile-Streaming-Generation: the chunks around the camera were usable after '%.3f' milli-seconds, instead of '%.3f' milli-seconds for the whole navmesh."),
+		FirstBatchTime * 1000.0, BlockingTime * 1000.0)
+	UE_LOG(LogRsap, Warning, TEXT("Profile-Streaming-Generation: the whole navmesh took '%.3f' milli-seconds in %u batches."), StreamingTime * 1000.0, Job.GetCompletedBatchCount())
+	if(IsSameNavMesh(BlockingNavMesh, StreamedNavMesh)) UE_LOG(LogRsap, Warning, TEXT("Profile-Streaming-Generation: generated the same %llu chunks as generating at once."), static_cast<uint64>(StreamedNavMesh.Chunks.size()))
+	else UE_LOG(LogRsap, Error, TEXT("Profile-Streaming-Generation: generated a different navmesh than generating at once!"))
+}
@@ -1,9 +1,14 @@
 ﻿// Copyright Melvin Brink 2023. All Rights Reserved.
 
 #include "Rsap/EditorWorld.h"
+#include "EditorViewportClient.h"
 #include "LevelEditor.h"
+#include "Camera/PlayerCameraManager.h"
+#include "Engine/StaticMesh.h"
 #include "Engine/StaticMeshActor.h"
 #include "Kismet/GameplayStatics.h"
+#include "PhysicsEngine/BodySetup.h"
+#include "Rsap/Math/TriangleBVH.h"
 #include "Rsap/NavMesh/Types/Actor.h"
 #include "UObject/ObjectSaveContext.h"
 
@@ -112,7 +117,7 @@ void FRsapEditorWorld::HandleActorSelectionChanged(const TArray<UObject*>& Objec
 		const auto RsapActor = Iterator->second;
 		for (const auto& Component : RsapActor->GetCollisionComponents())
 		{
-			OnCollisionComponentChanged.Execute(FRsapCollisionComponentChangedResult(ERsapCollisionComponentChangedType::Deleted, Component));
+			OnCollisionComponentChanged.Execute(FRsapCollisionComponentChangedResult(ERsapCollisionComponentChangedType::Deleted, Component, PrevActorKey));
 		}
 		
 		RsapActors.erase(Iterator);
@@ -125,6 +130,15 @@ void FRsapEditorWorld::HandleActorSelectionChanged(const TArray<UObject*>& Objec
  */
 void FRsapEditorWorld::HandleObjectPropertyChanged(UObject* Object, FPropertyChangedEvent& PropertyChangedEvent)
 {
+	// A static-mesh is changed when it is re-imported, or when its collision is edited, which could also happen on its body-setup.
+	const UStaticMesh* StaticMesh = Cast<UStaticMesh>(Object);
+	if(const UBodySetup* BodySetup = Cast<UBodySetup>(Object)) StaticMesh = Cast<UStaticMesh>(BodySetup->GetOuter());
+	if(StaticMesh)
+	{
+		HandleStaticMeshChanged(StaticMesh);
+		return;
+	}
+	
 	const AActor* Actor = Cast<AActor>(Object);
 	if(!Actor) return;
 	
@@ -144,6 +158,22 @@ void FRsapEditorWorld::HandleObjectPropertyChanged(UObject* Object, FPropertyCha
 	}
 }
 
+/**
+ * Rebuilds the triangles of the mesh for the components that use it.
+ * Their BVH now differs from the one that is cached, so they are detected as changed, see FRsapCollisionComponent::DetectAndSyncChanges.
+ */
+void FRsapEditorWorld::HandleStaticMeshChanged(const UStaticMesh* StaticMesh)
+{
+	FRsapTriangleBVH::Invalidate(StaticMesh);
+	for (const auto& RsapActor : RsapActors | std::views::values)
+	{
+		for (const FRsapCollisionComponentChangedResult& Result : RsapActor->DetectAndSyncChanges())
+		{
+			OnCollisionComponentChanged.Execute(Result);
+		}
+	}
+}
+
 /**
  * Will cache the actor if it has any collision-components.
  * Broadcasts OnCollisionComponentChanged for each collision-component.
@@ -160,8 +190,39 @@ void FRsapEditorWorld::CacheActor(const actor_key ActorKey, const AActor* Actor)
 	// Call the event for each collision-component on the actor. This could be done in bulk, but this is easier.
 	for (const auto& Component : RsapActor->GetCollisionComponents())
 	{
-		OnCollisionComponentChanged.Execute(FRsapCollisionComponentChangedResult(ERsapCollisionComponentChangedType::Added, Component));
+		OnCollisionComponentChanged.Execute(FRsapCollisionComponentChangedResult(ERsapCollisionComponentChangedType::Added, Component, ActorKey));
+	}
+}
+
+bool FRsapEditorWorld::GetCameraView(FVector& OutLocation, FRotator& OutRotation) const
+{
+	const UWorld* EditorWorld = GEditor->GetEditorWorldContext().World();
+	if(!EditorWorld) return false;
+	
+	if(EditorWorld->WorldType == EWorldType::Editor)
+	{
+		// Get editor-world camera
+		const FViewport* ActiveViewport = GEditor->GetActiveViewport();
+		if(!ActiveViewport) return false;
+	
+		const FEditorViewportClient* EditorViewClient = static_cast<FEditorViewportClient*>(ActiveViewport->GetClient());
+		if(!EditorViewClient) return false;
+	
+		OutLocation = EditorViewClient->GetViewLocation();
+		OutRotation = EditorViewClient->GetViewRotation();
+		return true;
 	}
+
+	// PIE
+	const APlayerController* PlayerController = EditorWorld->GetFirstPlayerController();
+	if(!PlayerController) return false;
+		
+	const APlayerCameraManager* CameraManager = PlayerController->PlayerCameraManager;
+	if(!CameraManager) return false;
+
+	OutLocation = CameraManager->GetCameraLocation();
+	OutRotation = CameraManager->GetCameraRotation();
+	return true;
 }
 
 void FRsapEditorWorld::HandleOnCameraMoved(const FVector& CameraLocation, const FRotator& CameraRotation, ELevelViewportType LevelViewportType, int32 RandomInt)
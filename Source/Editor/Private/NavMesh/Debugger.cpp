@@ -39,30 +39,7 @@ void FRsapDebugger::Draw()
 	
 	FVector CameraLocation;
 	FRotator CameraRotation;
-	
-	if(World->WorldType == EWorldType::Editor)
-	{
-		// Get editor-world camera
-		const FViewport* ActiveViewport = GEditor->GetActiveViewport();
-		if(!ActiveViewport) return;
-	
-		const FEditorViewportClient* EditorViewClient = static_cast<FEditorViewportClient*>(ActiveViewport->GetClient());
-		if(!EditorViewClient) return;
-	
-		CameraLocation = EditorViewClient->GetViewLocation();
-		CameraRotation = EditorViewClient->GetViewRotation();
-	}
-	else // PIE
-	{
-		const APlayerController* PlayerController = World->GetFirstPlayerController();
-		if(!PlayerController) return;
-		
-		const APlayerCameraManager* CameraManager = PlayerController->PlayerCameraManager;
-		if(!CameraManager) return;
-
-		CameraLocation = CameraManager->GetCameraLocation();
-		CameraRotation = CameraManager->GetCameraRotation();
-	}
+	if(!FRsapEditorWorld::GetInstance().GetCameraView(CameraLocation, CameraRotation)) return;
 	
 	Draw(CameraLocation, CameraRotation);
 }
@@ -90,9 +67,13 @@ void FRsapDebugger::Draw(const FVector& CameraLocation, const FRotator& CameraRo
 	{
 		for (ChunkLocation.Y = RenderBoundaries.Min.Y; ChunkLocation.Y <= RenderBoundaries.Max.Y; ChunkLocation.Y+= Chunk::Size)
 		{
+			// The next chunk on the X-axis is the neighbour of the previous one, which only has to be looked up when there was no previous chunk.
+			const FRsapChunk* PreviousChunk = nullptr;
 			for (ChunkLocation.X = RenderBoundaries.Min.X; ChunkLocation.X <= RenderBoundaries.Max.X; ChunkLocation.X += Chunk::Size)
 			{
-				if(const FRsapChunk* Chunk = Navmesh.FindChunk(CurrentChunkMC); Chunk)
+				const FRsapChunk* Chunk = PreviousChunk ? PreviousChunk->GetNeighbour(Direction::Positive::X) : Navmesh->FindChunk(CurrentChunkMC);
+				PreviousChunk = Chunk;
+				if(Chunk)
 				{
 					if(bDrawChunks)
 					{
@@ -100,7 +81,7 @@ void FRsapDebugger::Draw(const FVector& CameraLocation, const FRotator& CameraRo
 						DrawDebugBox(World, *ChunkGlobalCenterLocation, FVector(Node::HalveSizes[0]), FColor::Black, true, -1, 11, 5);
 					}
 					
-					DrawNodes(World, *Chunk, CurrentChunkMC, ChunkLocation, 0, 0, CameraLocation);
+					DrawNodes(World, Chunk->GetLinearOctree(), CurrentChunkMC, ChunkLocation, CameraLocation);
 				}
 
 				if(ChunkLocation.X == RenderBoundaries.Max.X)
@@ -132,13 +113,11 @@ void FRsapDebugger::DrawNode(const UWorld* World, const FRsapVector32& NodeCente
 	DrawDebugBox(World, *NodeCenter, FVector(Node::HalveSizes[LayerIdx]), LayerColors[LayerIdx], true, -1, 0, Thickness[LayerIdx]);
 }
 
-void FRsapDebugger::DrawLeafNode(const UWorld* World, const FRsapChunk& Chunk, const FRsapVector32 ChunkLocation, const node_morton NodeMC, const FVector& CameraLocation)
+void FRsapDebugger::DrawLeafNode(const UWorld* World, const FRsapLeaf& LeafNode, const FRsapVector32 ChunkLocation, const node_morton NodeMC, const FVector& CameraLocation)
 {
 	const FRsapVector32 NodeLocation = FRsapVector32::FromNodeMorton(NodeMC, ChunkLocation);
 	if(!InDistance(CameraLocation, NodeLocation + Node::HalveSizes[Layer::NodeDepth], Layer::NodeDepth)) return;
 	DrawNode(World, NodeLocation + Node::HalveSizes[Layer::NodeDepth], Layer::NodeDepth);
-	
-	const FRsapLeaf LeafNode = Chunk.GetLeafNode(NodeMC, 0);
 
 	// Separate the 64 leafs into groups of 8 to simulate octree behavior.
 	for(child_idx LeafGroupIdx = 0; LeafGroupIdx < 8; ++LeafGroupIdx)
@@ -169,32 +148,31 @@ void FRsapDebugger::DrawLeafNode(const UWorld* World, const FRsapChunk& Chunk, c
 	}
 }
 
-void FRsapDebugger::DrawNodes(const UWorld* World, const FRsapChunk& Chunk, const chunk_morton ChunkMC, const FRsapVector32 ChunkLocation, const node_morton NodeMC, const layer_idx LayerIdx, const FVector& CameraLocation)
+// Traverses the linear-octree of the chunk, which finds the children of each node without any map lookups.
+void FRsapDebugger::DrawNodes(const UWorld* World, const FRsapLinearOctree& Octree, const chunk_morton ChunkMC, const FRsapVector32 ChunkLocation, const FVector& CameraLocation)
 {
-	const FRsapNode& Node = Chunk.GetNode(NodeMC, LayerIdx, 0);
-	const FRsapVector32 NodeLocation = FRsapVector32::FromNodeMorton(NodeMC, ChunkLocation);
-	const FRsapVector32 NodeCenter = NodeLocation + Node::HalveSizes[LayerIdx];
-
-	const auto Draw = [&]()
+	Octree.Traverse([&](const FRsapLinearNode& Node, const uint32 NodeIdx, const node_morton NodeMC, const layer_idx LayerIdx)
 	{
-		DrawNode(World, NodeCenter, LayerIdx);
-		if(bDrawNodeInfo && World->IsPlayInEditor()) DrawNodeInfo(World, NodeMC, NodeCenter, LayerIdx);
-		if(bDrawRelations) DrawNodeRelations(World, ChunkMC, ChunkLocation, Node, NodeMC, NodeCenter, LayerIdx);
-	};
+		const FRsapVector32 NodeCenter = FRsapVector32::FromNodeMorton(NodeMC, ChunkLocation) + Node::HalveSizes[LayerIdx];
+		if(!InDistance(CameraLocation, NodeCenter, LayerIdx)) return false;
 
-	if(!InDistance(CameraLocation, NodeCenter, LayerIdx)) return;
-	if(!bDrawSpecificLayer) Draw();
-	else if(LayerIdx == DrawLayerIdx)
-	{
-		Draw();
-		return;
-	}
+		if(!bDrawSpecificLayer || LayerIdx == DrawLayerIdx)
+		{
+			DrawNode(World, NodeCenter, LayerIdx);
+			if(bDrawNodeInfo && World->IsPlayInEditor()) DrawNodeInfo(World, NodeMC, NodeCenter, LayerIdx);
+			if(bDrawRelations) DrawNodeRelations(World, ChunkMC, ChunkLocation, *Node.OctreeNode, NodeMC, NodeCenter, LayerIdx);
+			if(bDrawSpecificLayer) return false;
+		}
 
-	const layer_idx ChildLayerIdx = LayerIdx+1;
-	Node.ForEachChild(NodeMC, LayerIdx, [&](const node_morton ChildMC)
-	{
-		if(ChildLayerIdx < Layer::NodeDepth) DrawNodes(World, Chunk, ChunkMC, ChunkLocation, ChildMC, ChildLayerIdx, CameraLocation);
-		else DrawLeafNode(World, Chunk, ChunkLocation, ChildMC, CameraLocation);
+		// The traversal stops at the last layer, whose children are in the leaf-array.
+		if(LayerIdx == Layer::NodeDepth-1)
+		{
+			Octree.ForEachChild(NodeIdx, NodeMC, LayerIdx, [&](const uint32 LeafIdx, const node_morton LeafMC, child_idx)
+			{
+				DrawLeafNode(World, *Octree.Leafs[LeafIdx], ChunkLocation, LeafMC, CameraLocation);
+			});
+		}
+		return true;
 	});
 }
 
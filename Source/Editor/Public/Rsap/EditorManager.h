@@ -4,10 +4,13 @@
 
 #include "Rsap/Math/Bounds.h"
 #include "Rsap/NavMesh/Navmesh.h"
+#include "Rsap/NavMesh/Processing/GenerationJob.h"
+#include "Containers/Ticker.h"
 #include "EditorManager.generated.h"
 
-class FRsapUpdater;
+class FRsapNavmeshUpdater;
 class FRsapDebugger;
+class SNotificationItem;
 
 
 
@@ -15,6 +18,7 @@ class FRsapDebugger;
  * Handles everything related to the navmesh within the editor.
  *
  * - <b>(re)generates</b> the navmesh when it doesnt exist yet, or when the level's geometry is unsynced with what is serialized.
+ *   This is spread over multiple frames into a second navmesh, which replaces the current one when it is complete.
  * - <b>Updates</b> the navmesh when the geometry within a level changes, either from adding/deleting objects or changing their transform.
  * - <b>Serializes</b> the navmesh when the user saves the level.
  * - <b>Unloads/loads</b> the navmesh when changing levels.
@@ -32,9 +36,53 @@ public:
 	UFUNCTION(BlueprintCallable, Category="Rsap | Navigation Mesh")
 	void Regenerate(const UWorld* World);
 
+	// Regenerates the chunks nearest to the camera first, which are usable while the rest is being generated.
+	UFUNCTION(BlueprintCallable, Category="Rsap | Navigation Mesh")
+	void RegenerateAroundCamera(const UWorld* World);
+
+	// Stops the regeneration that is in progress, which keeps the current navmesh.
+	UFUNCTION(BlueprintCallable, Category="Rsap | Navigation Mesh")
+	void CancelRegeneration();
+
+	// Time the regeneration may take each frame, in milli-seconds.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Rsap | Navigation Mesh", meta=(ClampMin=1))
+	float GenerationBudgetMs = 8.f;
+
+	// Time the updates may take each frame, in milli-seconds. The chunks near the camera are updated regardless.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Rsap | Navigation Mesh", meta=(ClampMin=0))
+	float UpdateBudgetMs = 2.f;
+
+	// Distance from the camera, within which the chunks are updated on the frame they are ready, regardless of the budget.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Rsap | Navigation Mesh", meta=(ClampMin=0))
+	float UpdateImmediateRadius = Chunk::Size;
+
+	// Time an actor has to stop moving before the navmesh is updated, in milli-seconds. So dragging an actor around only updates where it ends up.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Rsap | Navigation Mesh", meta=(ClampMin=0))
+	float UpdateSettleDelayMs = 100.f;
+
+	// Time after which an actor that keeps moving updates the navmesh anyway, in milli-seconds.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Rsap | Navigation Mesh", meta=(ClampMin=0))
+	float UpdateMaxSettleDelayMs = 500.f;
+
 private:
-	FRsapNavmesh NavMesh;
+	FRsapNavmesh NavMeshes[2]; // The current navmesh, and the one that is being regenerated.
+	uint8 NavMeshIdx = 0;
 	FRsapDebugger* Debugger;
+	TUniquePtr<FRsapNavmeshUpdater> Updater;
+
+	TUniquePtr<FRsapGenerationJob> GenerationJob;
+	FTSTicker::FDelegateHandle GenerationTickerHandle;
+	TSharedPtr<SNotificationItem> GenerationNotification;
+	bool bRegeneratingAroundCamera = false;
+
+	FRsapNavmesh& GetNavMesh() { return NavMeshes[NavMeshIdx]; }
+	const FRsapNavmesh& GetNavMesh() const { return NavMeshes[NavMeshIdx]; }
+	FRsapNavmesh& GetPendingNavMesh() { return NavMeshes[NavMeshIdx ^ 1]; }
+
+	// Regenerates the whole navmesh, or only the given chunks.
+	void StartRegeneration(bool bAroundCamera, const std::vector<chunk_morton>& ChunkMCs = {});
+	bool TickRegeneration(float DeltaTime);
+	void EndRegeneration(bool bSuccess);
 	TArray<TObjectPtr<UStaticMeshComponent>> ComponentChangedResults;
 
 	void OnMapOpened(const IRsapWorld* RsapWorld);
@@ -43,6 +91,7 @@ private:
 
 	void OnCollisionComponentChanged(const FRsapCollisionComponentChangedResult& ChangedResult);
 	void OnWorldPostActorTick(UWorld* World, ELevelTick TickType, float DeltaSeconds);
+	void OnWorldCleanup(UWorld* World, bool bSessionEnded, bool bCleanupResources);
 	void VoxelizationCallback(const TArray<FUintVector3>& Vertices);
 
 	void OnNavMeshUpdated() const;
@@ -50,6 +99,15 @@ private:
 public:
 	void ProfileGeneration() const;
 	void ProfileIteration() const;
+	void ProfileMemory() const;
+	void ProfileMorton() const;
+	void ProfileRangeQuery() const;
+	void ProfileOverlap() const;
+	void ProfileVoxelization() const;
+	void ProfileOctreeBuild() const;
+	void ProfileGenerationScaling() const;
+	void ProfileTimeSlicedGeneration() const;
+	void ProfileStreamingGeneration() const;
 
 	FRsapDebugger* GetDebugger() const { return Debugger; }
 };
\ No newline at end of file
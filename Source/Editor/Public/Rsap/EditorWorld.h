@@ -37,6 +37,9 @@ public:
 	FPreMapSaved	PreMapSaved;
 	FPostMapSaved	PostMapSaved;
 	FOnCameraMoved	OnCameraMoved;
+
+	// Gets the view of the active viewport in the editor-world, or of the player's camera during PIE.
+	bool GetCameraView(FVector& OutLocation, FRotator& OutRotation) const;
 	
 private:
 	std::vector<actor_key> SelectedActors;
@@ -47,6 +50,7 @@ private:
 	
 	FDelegateHandle ActorSelectionChangedHandle; void HandleActorSelectionChanged(const TArray<UObject*>& Objects, bool);
 	FDelegateHandle ObjectPropertyChangedHandle; void HandleObjectPropertyChanged(UObject* Object, FPropertyChangedEvent& PropertyChangedEvent);
+	void HandleStaticMeshChanged(const UStaticMesh* StaticMesh);
 	void CacheActor(const actor_key ActorKey, const AActor* Actor);
 
 	FDelegateHandle OnCameraMovedHandle; void HandleOnCameraMoved(const FVector& CameraLocation, const FRotator& CameraRotation, ELevelViewportType LevelViewportType, int32 RandomInt);
@@ -62,6 +62,12 @@ private:
 			FSlateIcon(),
 			FUIAction(FExecuteAction::CreateStatic(&FRsapMenu::OnRegenerateButtonClicked))
 		);
+		MenuBuilder.AddMenuEntry(
+			LOCTEXT("RsapRegenerateAroundCameraButton", "Regenerate around camera"),
+			LOCTEXT("RsapRegenerateAroundCameraTooltip", "Regenerates the Sound-Navigation-Mesh outward from the camera, which is usable around the camera while the rest is being generated."),
+			FSlateIcon(),
+			FUIAction(FExecuteAction::CreateStatic(&FRsapMenu::OnRegenerateAroundCameraButtonClicked))
+		);
 		MenuBuilder.EndSection();
 
 		// Debug section.
@@ -86,6 +92,12 @@ private:
 		URsapEditorManager* EditorManager = GEditor->GetEditorSubsystem<URsapEditorManager>();
 		EditorManager->Regenerate(GEditor->GetEditorWorldContext().World());
 	}
+
+	static void OnRegenerateAroundCameraButtonClicked()
+	{
+		URsapEditorManager* EditorManager = GEditor->GetEditorSubsystem<URsapEditorManager>();
+		EditorManager->RegenerateAroundCamera(GEditor->GetEditorWorldContext().World());
+	}
 };
 
 
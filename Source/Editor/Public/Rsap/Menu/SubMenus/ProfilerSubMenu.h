@@ -15,7 +15,7 @@ public:
 	{
 		MenuBuilder.AddMenuEntry(
 			LOCTEXT("RsapSubMenuProfileGeneration", "Generation"),
-			LOCTEXT("RsapSubMenuOption1Tooltip", "Profiles the generation of the navmesh."),
+			LOCTEXT("RsapSubMenuOption1Tooltip", "Profiles the generation of the navmesh, comparing the axis-order against the morton-order of the nodes."),
 			FSlateIcon(),
 			FUIAction(FExecuteAction::CreateStatic(&FProfilerSubMenu::OnProfileGenerationClicked))
 		);
@@ -26,6 +26,69 @@ public:
 			FSlateIcon(),
 			FUIAction(FExecuteAction::CreateStatic(&FProfilerSubMenu::OnProfileIterationClicked))
 		);
+
+		MenuBuilder.AddMenuEntry(
+			LOCTEXT("RsapSubMenuProfileMemory", "Memory"),
+			LOCTEXT("RsapSubMenuOption3Tooltip", "Logs the memory used by the navmesh per chunk, layer and container, and saves it as a CSV in the profiling directory."),
+			FSlateIcon(),
+			FUIAction(FExecuteAction::CreateStatic(&FProfilerSubMenu::OnProfileMemoryClicked))
+		);
+
+		MenuBuilder.AddMenuEntry(
+			LOCTEXT("RsapSubMenuProfileMorton", "Morton-codes"),
+			LOCTEXT("RsapSubMenuOption4Tooltip", "Compares encoding/decoding morton-codes using the lookup-tables against the BMI2 instructions."),
+			FSlateIcon(),
+			FUIAction(FExecuteAction::CreateStatic(&FProfilerSubMenu::OnProfileMortonClicked))
+		);
+
+		MenuBuilder.AddMenuEntry(
+			LOCTEXT("RsapSubMenuProfileRangeQuery", "Range-query"),
+			LOCTEXT("RsapSubMenuOption6Tooltip", "Compares finding the nodes within random boxes using a lookup per node-location against walking the morton-range of the box."),
+			FSlateIcon(),
+			FUIAction(FExecuteAction::CreateStatic(&FProfilerSubMenu::OnProfileRangeQueryClicked))
+		);
+
+		MenuBuilder.AddMenuEntry(
+			LOCTEXT("RsapSubMenuProfileOverlap", "Overlap"),
+			LOCTEXT("RsapSubMenuOption7Tooltip", "Compares the triangle-overlap of the nodes around each static-mesh against the physics-queries, and verifies the results are identical."),
+			FSlateIcon(),
+			FUIAction(FExecuteAction::CreateStatic(&FProfilerSubMenu::OnProfileOverlapClicked))
+		);
+
+		MenuBuilder.AddMenuEntry(
+			LOCTEXT("RsapSubMenuProfileVoxelization", "Leaf-voxelization"),
+			LOCTEXT("RsapSubMenuOption8Tooltip", "Compares voxelizing the triangles into the leaf-nodes around each static-mesh against an overlap-query per leaf, and verifies that no leaf is missed."),
+			FSlateIcon(),
+			FUIAction(FExecuteAction::CreateStatic(&FProfilerSubMenu::OnProfileVoxelizationClicked))
+		);
+
+		MenuBuilder.AddMenuEntry(
+			LOCTEXT("RsapSubMenuProfileOctreeBuild", "Octree-build"),
+			LOCTEXT("RsapSubMenuOption9Tooltip", "Compares building a chunk of a million leaf-nodes bottom-up from a sorted morton-stream against initializing every node and its parents, and verifies the octrees are identical."),
+			FSlateIcon(),
+			FUIAction(FExecuteAction::CreateStatic(&FProfilerSubMenu::OnProfileOctreeBuildClicked))
+		);
+
+		MenuBuilder.AddMenuEntry(
+			LOCTEXT("RsapSubMenuProfileGenerationScaling", "Generation-scaling"),
+			LOCTEXT("RsapSubMenuOption10Tooltip", "Generates the navmesh on an increasing amount of threads, and verifies every result is identical to the one generated on a single thread."),
+			FSlateIcon(),
+			FUIAction(FExecuteAction::CreateStatic(&FProfilerSubMenu::OnProfileGenerationScalingClicked))
+		);
+
+		MenuBuilder.AddMenuEntry(
+			LOCTEXT("RsapSubMenuProfileTimeSlicedGeneration", "Time-sliced generation"),
+			LOCTEXT("RsapSubMenuOption11Tooltip", "Generates the navmesh in slices of a single milli-second, and verifies the result is identical to the one generated at once."),
+			FSlateIcon(),
+			FUIAction(FExecuteAction::CreateStatic(&FProfilerSubMenu::OnProfileTimeSlicedGenerationClicked))
+		);
+
+		MenuBuilder.AddMenuEntry(
+			LOCTEXT("RsapSubMenuProfileStreamingGeneration", "Streaming generation"),
+			LOCTEXT("RsapSubMenuOption12Tooltip", "Generates the navmesh outward from the camera, measures how long it takes until the chunks around the camera are usable, and verifies the result is identical to the one generated at once."),
+			FSlateIcon(),
+			FUIAction(FExecuteAction::CreateStatic(&FProfilerSubMenu::OnProfileStreamingGenerationClicked))
+		);
 	}
 
 private:
@@ -40,6 +103,60 @@ private:
 		const URsapEditorManager* EditorManager = GEditor->GetEditorSubsystem<URsapEditorManager>();
 		EditorManager->ProfileIteration();
 	}
+
+	static void OnProfileMemoryClicked()
+	{
+		const URsapEditorManager* EditorManager = GEditor->GetEditorSubsystem<URsapEditorManager>();
+		EditorManager->ProfileMemory();
+	}
+
+	static void OnProfileMortonClicked()
+	{
+		const URsapEditorManager* EditorManager = GEditor->GetEditorSubsystem<URsapEditorManager>();
+		EditorManager->ProfileMorton();
+	}
+
+	static void OnProfileRangeQueryClicked()
+	{
+		const URsapEditorManager* EditorManager = GEditor->GetEditorSubsystem<URsapEditorManager>();
+		EditorManager->ProfileRangeQuery();
+	}
+
+	static void OnProfileOverlapClicked()
+	{
+		const URsapEditorManager* EditorManager = GEditor->GetEditorSubsystem<URsapEditorManager>();
+		EditorManager->ProfileOverlap();
+	}
+
+	static void OnProfileVoxelizationClicked()
+	{
+		const URsapEditorManager* EditorManager = GEditor->GetEditorSubsystem<URsapEditorManager>();
+		EditorManager->ProfileVoxelization();
+	}
+
+	static void OnProfileOctreeBuildClicked()
+	{
+		const URsapEditorManager* EditorManager = GEditor->GetEditorSubsystem<URsapEditorManager>();
+		EditorManager->ProfileOctreeBuild();
+	}
+
+	static void OnProfileGenerationScalingClicked()
+	{
+		const URsapEditorManager* EditorManager = GEditor->GetEditorSubsystem<URsapEditorManager>();
+		EditorManager->ProfileGenerationScaling();
+	}
+
+	static void OnProfileTimeSlicedGenerationClicked()
+	{
+		const URsapEditorManager* EditorManager = GEditor->GetEditorSubsystem<URsapEditorManager>();
+		EditorManager->ProfileTimeSlicedGeneration();
+	}
+
+	static void OnProfileStreamingGenerationClicked()
+	{
+		const URsapEditorManager* EditorManager = GEditor->GetEditorSubsystem<URsapEditorManager>();
+		EditorManager->ProfileStreamingGeneration();
+	}
 };
 
 
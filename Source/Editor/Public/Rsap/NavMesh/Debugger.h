@@ -5,16 +5,17 @@
 #include "Rsap/Definitions.h"
 #include "Rsap/EditorWorld.h"
 #include "Rsap/NavMesh/Navmesh.h"
+#include "Rsap/NavMesh/Types/LinearOctree.h"
 
 
 
 class FRsapDebugger
 {
-	FRsapNavmesh& Navmesh;
+	const FRsapNavmesh* Navmesh;
 	
 public:
-	explicit FRsapDebugger(FRsapNavmesh& InNavmesh)
-		: Navmesh(InNavmesh)
+	explicit FRsapDebugger(const FRsapNavmesh& InNavmesh)
+		: Navmesh(&InNavmesh)
 	{
 		//NavMeshUpdatedHandle = FRsapUpdater::OnUpdateComplete.AddStatic(&FRsapDebugger::OnNavMeshUpdated);
 		FRsapEditorWorld& RsapWorld = FRsapEditorWorld::GetInstance();
@@ -29,6 +30,12 @@ public:
 	}
 
 	void Start() { bRunning = true; }
+	void SetNavmesh(const FRsapNavmesh& InNavmesh)
+	{
+		Navmesh = &InNavmesh;
+		Draw();
+	}
+	void Redraw() { Draw(); }
 	void Stop()
 	{
 		bRunning = false;
@@ -40,8 +47,8 @@ private:
 	void Draw(const FVector& CameraLocation, const FRotator& CameraRotation);
 
 	void DrawNode(const UWorld* World, const FRsapVector32& NodeCenter, const layer_idx LayerIdx);
-	void DrawLeafNode(const UWorld* World, const FRsapChunk& Chunk, FRsapVector32 ChunkLocation, node_morton NodeMC, const FVector& CameraLocation);
-	void DrawNodes(const UWorld* World, const FRsapChunk& Chunk, const chunk_morton ChunkMC, const FRsapVector32 ChunkLocation, const node_morton NodeMC, const layer_idx LayerIdx, const FVector& CameraLocation);
+	void DrawLeafNode(const UWorld* World, const FRsapLeaf& LeafNode, FRsapVector32 ChunkLocation, node_morton NodeMC, const FVector& CameraLocation);
+	void DrawNodes(const UWorld* World, const FRsapLinearOctree& Octree, const chunk_morton ChunkMC, const FRsapVector32 ChunkLocation, const FVector& CameraLocation);
 	void DrawNodeInfo(const UWorld* World, const node_morton NodeMC, const FRsapVector32& NodeCenter, layer_idx LayerIdx);
 	void DrawNodeRelations(const UWorld* World, const chunk_morton ChunkMC, const FRsapVector32 ChunkLocation, const FRsapNode& Node, const node_morton NodeMC, const FRsapVector32& NodeCenter, const layer_idx LayerIdx);
 
@@ -0,0 +1,127 @@
+﻿// Copyright Melvin Brink 2023. All Rights Reserved.
+
+#include "Rsap/Math/Morton.h"
+
+#if PLATFORM_CPU_X86_FAMILY
+	#include <immintrin.h>
+	#if defined(_MSC_VER) && !defined(__clang__)
+		#include <intrin.h>
+		#define RSAP_TARGET_BMI2
+	#else
+		#include <cpuid.h>
+		#define RSAP_TARGET_BMI2 __attribute__((target("bmi2")))
+	#endif
+#endif
+
+// Covers the same bits as libmorton's lookup-tables, so that the results are bit-exact with them.
+namespace Rsap::Morton::BMI2
+{
+	static inline constexpr uint32 NodeMask_X = 0x49249249;
+	static inline constexpr uint32 NodeMask_Y = 0x92492492;
+	static inline constexpr uint32 NodeMask_Z = 0x24924924;
+	
+	static inline constexpr uint64 ChunkMask_X = 0x1249249249249249; // 21 bits per axis, bit 63 is unused.
+	static inline constexpr uint64 ChunkMask_Y = 0x2492492492492492;
+	static inline constexpr uint64 ChunkMask_Z = 0x4924924924924924;
+}
+
+
+
+bool FMortonUtils::bUseBMI2 = false;
+
+#if PLATFORM_CPU_X86_FAMILY
+// Returns true if the CPU has BMI2, and executes pdep/pext in hardware.
+// AMD's Zen 1 and 2 ( family 0x17 ) report BMI2, but run pdep/pext in microcode which is a lot slower than the lookup-tables.
+static bool HasFastBMI2()
+{
+	uint32 Registers[4] = {}; // EAX, EBX, ECX, EDX
+	const auto CpuId = [&Registers](const uint32 Leaf)
+	{
+#if defined(_MSC_VER) && !defined(__clang__)
+		__cpuidex(reinterpret_cast<int32*>(Registers), Leaf, 0);
+#else
+		__cpuid_count(Leaf, 0, Registers[0], Registers[1], Registers[2], Registers[3]);
+#endif
+	};
+
+	CpuId(0);
+	const uint32 MaxLeaf = Registers[0];
+	const bool bIsAMD = Registers[1] == 0x68747541 && Registers[3] == 0x69746E65 && Registers[2] == 0x444D4163; // "AuthenticAMD"
+	if(MaxLeaf < 7) return false;
+
+	CpuId(7);
+	const bool bHasBMI2 = (Registers[1] >> 8) & 1;
+	if(!bHasBMI2) return false;
+	if(!bIsAMD) return true;
+
+	CpuId(1);
+	const uint32 BaseFamily = (Registers[0] >> 8) & 0xF;
+	const uint32 Family = BaseFamily == 0xF ? BaseFamily + ((Registers[0] >> 20) & 0xFF) : BaseFamily;
+	return Family >= 0x19;
+}
+#else
+static bool HasFastBMI2() { return false; }
+#endif
+
+void FMortonUtils::InitializeDispatch()
+{
+	bUseBMI2 = HasFastBMI2();
+	UE_LOG(LogRsap, Log, TEXT("Morton-codes will be encoded using %s."), bUseBMI2 ? TEXT("BMI2 pdep/pext") : TEXT("lookup-tables"))
+}
+
+
+
+#if PLATFORM_CPU_X86_FAMILY
+RSAP_TARGET_BMI2 node_morton FMortonUtils::BMI2::EncodeNode(const uint32 X, const uint32 Y, const uint32 Z)
+{
+	using namespace Rsap::Morton::BMI2;
+	return _pdep_u32(X, NodeMask_X) | _pdep_u32(Y, NodeMask_Y) | _pdep_u32(Z, NodeMask_Z);
+}
+
+RSAP_TARGET_BMI2 void FMortonUtils::BMI2::DecodeNode(const node_morton MortonCode, uint32& OutX, uint32& OutY, uint32& OutZ)
+{
+	using namespace Rsap::Morton::BMI2;
+	OutX = _pext_u32(MortonCode, NodeMask_X);
+	OutY = _pext_u32(MortonCode, NodeMask_Y);
+	OutZ = _pext_u32(MortonCode, NodeMask_Z);
+}
+
+RSAP_TARGET_BMI2 chunk_morton FMortonUtils::BMI2::EncodeChunk(const uint64 X, const uint64 Y, const uint64 Z)
+{
+	using namespace Rsap::Morton::BMI2;
+	return _pdep_u64(X, ChunkMask_X) | _pdep_u64(Y, ChunkMask_Y) | _pdep_u64(Z, ChunkMask_Z);
+}
+
+RSAP_TARGET_BMI2 void FMortonUtils::BMI2::DecodeChunk(const chunk_morton MortonCode, uint64& OutX, uint64& OutY, uint64& OutZ)
+{
+	using namespace Rsap::Morton::BMI2;
+	OutX = _pext_u64(MortonCode, ChunkMask_X);
+	OutY = _pext_u64(MortonCode, ChunkMask_Y);
+	OutZ = _pext_u64(MortonCode, ChunkMask_Z);
+}
+#else
+// Never called because ::bUseBMI2 stays false, but falls back to the lookup-tables to be safe.
+node_morton FMortonUtils::BMI2::EncodeNode(const uint32 X, const uint32 Y, const uint32 Z)
+{
+	return libmorton::morton3D_32_encode(X, Y, Z);
+}
+
+void FMortonUtils::BMI2::DecodeNode(const node_morton MortonCode, uint32& OutX, uint32& OutY, uint32& OutZ)
+{
+	uint_fast16_t X, Y, Z;
+	libmorton::morton3D_32_decode(MortonCode, X, Y, Z);
+	OutX = X; OutY = Y; OutZ = Z;
+}
+
+chunk_morton FMortonUtils::BMI2::EncodeChunk(const uint64 X, const uint64 Y, const uint64 Z)
+{
+	return libmorton::morton3D_64_encode(X, Y, Z);
+}
+
+void FMortonUtils::BMI2::DecodeChunk(const chunk_morton MortonCode, uint64& OutX, uint64& OutY, uint64& OutZ)
+{
+	uint_fast32_t X, Y, Z;
+	libmorton::morton3D_64_decode(MortonCode, X, Y, Z);
+	OutX = X; OutY = Y; OutZ = Z;
+}
+#endif
@@ -0,0 +1,324 @@
+﻿// Copyright Melvin Brink 2023. All Rights Reserved.
+
+#include "Rsap/Math/TriangleBVH.h"
+#include "Components/InstancedStaticMeshComponent.h"
+#include "Components/StaticMeshComponent.h"
+#include "Engine/StaticMesh.h"
+#include "Interfaces/Interface_CollisionDataProvider.h"
+#include "PhysicsEngine/BodySetup.h"
+#include <algorithm>
+
+
+
+namespace
+{
+	struct FTriangleBVHCacheEntry
+	{
+		TWeakObjectPtr<const UStaticMesh> StaticMesh;
+		std::shared_ptr<const FRsapTriangleBVH> TriangleBVH; // Can be nullptr if the mesh has no usable triangles.
+	};
+
+	FCriticalSection TriangleBVHCacheLock;
+	Rsap::Map::flat_map<const UStaticMesh*, FTriangleBVHCacheEntry> TriangleBVHCache;
+
+	std::shared_ptr<const FRsapTriangleBVH> BuildFromStaticMesh(UStaticMesh* StaticMesh)
+	{
+		// The physics-engine uses the simple shapes for complex queries on these meshes, which are not triangles.
+		const UBodySetup* BodySetup = StaticMesh->GetBodySetup();
+		if(!BodySetup || BodySetup->GetCollisionTraceFlag() == CTF_UseSimpleAsComplex) return nullptr;
+
+		// The same triangles as the ones that are cooked for the complex-collision.
+		FTriMeshCollisionData CollisionData;
+		const bool bUseAllTriData = BodySetup->bMeshCollideAll;
+		if(!StaticMesh->ContainsPhysicsTriMeshData(bUseAllTriData) || !StaticMesh->GetPhysicsTriMeshData(&CollisionData, bUseAllTriData)) return nullptr;
+
+		std::vector<FRsapTriangleBVH::FTriangle> Triangles;
+		Triangles.reserve(CollisionData.Indices.Num());
+		for (const FTriIndices& Indices : CollisionData.Indices)
+		{
+			Triangles.push_back({CollisionData.Vertices[Indices.v0], CollisionData.Vertices[Indices.v1], CollisionData.Vertices[Indices.v2]});
+		}
+		return std::make_shared<const FRsapTriangleBVH>(std::move(Triangles), BodySetup->GetCollisionTraceFlag() == CTF_UseComplexAsSimple);
+	}
+}
+
+std::shared_ptr<const FRsapTriangleBVH> FRsapTriangleBVH::Find(const UPrimitiveComponent* Component)
+{
+	// Instanced meshes have a body per instance, which is not supported.
+	const UStaticMeshComponent* StaticMeshComponent = Cast<UStaticMeshComponent>(Component);
+	if(!StaticMeshComponent || StaticMeshComponent->IsA<UInstancedStaticMeshComponent>()) return nullptr;
+	UStaticMesh* StaticMesh = StaticMeshComponent->GetStaticMesh();
+	if(!StaticMesh) return nullptr;
+
+	// The weak-pointer is compared as well, because a new mesh could be allocated at the address of one that has been garbage-collected.
+	FScopeLock Lock(&TriangleBVHCacheLock);
+	FTriangleBVHCacheEntry& Entry = TriangleBVHCache[StaticMesh];
+	if(Entry.StaticMesh.Get() != StaticMesh)
+	{
+		Entry.StaticMesh = StaticMesh;
+		Entry.TriangleBVH = BuildFromStaticMesh(StaticMesh);
+	}
+	return Entry.TriangleBVH;
+}
+
+void FRsapTriangleBVH::Invalidate(const UStaticMesh* StaticMesh)
+{
+	// Components that still hold the previous BVH keep it alive until they are synced again.
+	FScopeLock Lock(&TriangleBVHCacheLock);
+	TriangleBVHCache.erase(StaticMesh);
+}
+
+FRsapTriangleBVH::FRsapTriangleBVH(std::vector<FTriangle> Triangles, const bool bIsSimpleCollision)
+	: bIsSimpleCollision(bIsSimpleCollision)
+{
+	std::erase_if(Triangles, [](const FTriangle& Triangle)
+	{
+		return ((Triangle[1] - Triangle[0]) ^ (Triangle[2] - Triangle[0])).SizeSquared() <= UE_SMALL_NUMBER;
+	});
+	
+	TriangleCount = static_cast<uint32>(Triangles.size());
+	if(!TriangleCount) return;
+
+	Nodes.reserve(TriangleCount / MaxTrianglesPerLeaf * 4 + 1);
+	Blocks.reserve(TriangleCount / 2 + 1);
+	Nodes.emplace_back();
+	BuildNode(0, Triangles, 0, TriangleCount);
+}
+
+void FRsapTriangleBVH::BuildNode(const uint32 NodeIdx, std::vector<FTriangle>& Triangles, const uint32 Begin, const uint32 End)
+{
+	FVector3f Min(TNumericLimits<float>::Max()), Max(TNumericLimits<float>::Lowest());
+	FVector3f CentroidMin(TNumericLimits<float>::Max()), CentroidMax(TNumericLimits<float>::Lowest());
+	for (uint32 TriangleIdx = Begin; TriangleIdx < End; ++TriangleIdx)
+	{
+		const FTriangle& Triangle = Triangles[TriangleIdx];
+		for (const FVector3f& Vertex : Triangle)
+		{
+			Min = Min.ComponentMin(Vertex);
+			Max = Max.ComponentMax(Vertex);
+		}
+		const FVector3f Centroid = Triangle[0] + Triangle[1] + Triangle[2];
+		CentroidMin = CentroidMin.ComponentMin(Centroid);
+		CentroidMax = CentroidMax.ComponentMax(Centroid);
+	}
+	Nodes[NodeIdx].Min = Min;
+	Nodes[NodeIdx].Max = Max;
+
+	const uint32 Count = End - Begin;
+	if(Count <= MaxTrianglesPerLeaf)
+	{
+		Nodes[NodeIdx].FirstIdx = static_cast<uint32>(Blocks.size());
+		Nodes[NodeIdx].BlockCount = (Count + 3) / 4;
+		for (uint32 BlockBegin = Begin; BlockBegin < End; BlockBegin += 4)
+		{
+			FTriangleBlock& Block = Blocks.emplace_back();
+			for (uint32 Lane = 0; Lane < 4; ++Lane)
+			{
+				const FTriangle& Triangle = Triangles[FMath::Min(BlockBegin + Lane, End - 1)];
+				for (int32 Vertex = 0; Vertex < 3; ++Vertex)
+				{
+					for (int32 Axis = 0; Axis < 3; ++Axis) Block.Vertices[Vertex][Axis][Lane] = Triangle[Vertex][Axis];
+				}
+			}
+		}
+		return;
+	}
+
+	// Split at the median of the centroids on the axis they are spread out the most.
+	const FVector3f CentroidExtent = CentroidMax - CentroidMin;
+	const int32 SplitAxis = CentroidExtent.X >= CentroidExtent.Y && CentroidExtent.X >= CentroidExtent.Z ? 0 : CentroidExtent.Y >= CentroidExtent.Z ? 1 : 2;
+	const uint32 Middle = Begin + Count / 2;
+	std::nth_element(Triangles.begin() + Begin, Triangles.begin() + Middle, Triangles.begin() + End, [SplitAxis](const FTriangle& A, const FTriangle& B)
+	{
+		return A[0][SplitAxis] + A[1][SplitAxis] + A[2][SplitAxis] < B[0][SplitAxis] + B[1][SplitAxis] + B[2][SplitAxis];
+	});
+
+	const uint32 ChildIdx = static_cast<uint32>(Nodes.size());
+	Nodes[NodeIdx].FirstIdx = ChildIdx;
+	Nodes.emplace_back();
+	Nodes.emplace_back();
+	BuildNode(ChildIdx, Triangles, Begin, Middle);
+	BuildNode(ChildIdx + 1, Triangles, Middle, End);
+}
+
+FRsapTriangleBVH::FBoxSpace FRsapTriangleBVH::GetBoxSpace(const FTransform& Transform, const FVector& BoxCenter, const FVector& BoxExtent, FVector3f& OutQueryMin, FVector3f& OutQueryMax)
+{
+	// Bounds of the box in mesh-space, to find the leaves that could overlap. Slightly enlarged so that touching triangles are not skipped due to rounding.
+	OutQueryMin = FVector3f(TNumericLimits<float>::Max());
+	OutQueryMax = FVector3f(TNumericLimits<float>::Lowest());
+	for (uint8 Corner = 0; Corner < 8; ++Corner)
+	{
+		const FVector Offset(Corner & 1 ? BoxExtent.X : -BoxExtent.X, Corner & 2 ? BoxExtent.Y : -BoxExtent.Y, Corner & 4 ? BoxExtent.Z : -BoxExtent.Z);
+		const FVector3f MeshCorner(Transform.InverseTransformPosition(BoxCenter + Offset));
+		OutQueryMin = OutQueryMin.ComponentMin(MeshCorner);
+		OutQueryMax = OutQueryMax.ComponentMax(MeshCorner);
+	}
+	OutQueryMin -= FVector3f(UE_KINDA_SMALL_NUMBER);
+	OutQueryMax += FVector3f(UE_KINDA_SMALL_NUMBER);
+
+	// The translation is made relative to the box before converting it to floats, to keep the precision in large worlds.
+	const FMatrix Matrix = Transform.ToMatrixWithScale();
+	const FVector Translation = Matrix.GetOrigin() - BoxCenter;
+	FBoxSpace BoxSpace;
+	for (int32 Axis = 0; Axis < 3; ++Axis)
+	{
+		for (int32 Column = 0; Column < 3; ++Column) BoxSpace.Matrix[Axis][Column] = static_cast<float>(Matrix.M[Column][Axis]);
+		BoxSpace.Matrix[Axis][3] = static_cast<float>(Translation[Axis]);
+		BoxSpace.Extent[Axis] = static_cast<float>(BoxExtent[Axis]);
+	}
+	return BoxSpace;
+}
+
+template<typename Func>
+bool FRsapTriangleBVH::ForEachBlock(const FVector3f& QueryMin, const FVector3f& QueryMax, Func Callback) const
+{
+	uint32 Stack[64];
+	uint32 StackSize = 0;
+	Stack[StackSize++] = 0;
+
+	while(StackSize)
+	{
+		const FNode& CurrentNode = Nodes[Stack[--StackSize]];
+		if(CurrentNode.Min.X > QueryMax.X || CurrentNode.Min.Y > QueryMax.Y || CurrentNode.Min.Z > QueryMax.Z ||
+		   CurrentNode.Max.X < QueryMin.X || CurrentNode.Max.Y < QueryMin.Y || CurrentNode.Max.Z < QueryMin.Z) continue;
+
+		if(CurrentNode.BlockCount)
+		{
+			for (uint32 BlockIdx = CurrentNode.FirstIdx; BlockIdx < CurrentNode.FirstIdx + CurrentNode.BlockCount; ++BlockIdx)
+			{
+				if(Callback(BlockIdx)) return true;
+			}
+			continue;
+		}
+
+		Stack[StackSize++] = CurrentNode.FirstIdx;
+		Stack[StackSize++] = CurrentNode.FirstIdx + 1;
+	}
+	return false;
+}
+
+bool FRsapTriangleBVH::Overlaps(const FTransform& Transform, const FVector& BoxCenter, const FVector& BoxExtent) const
+{
+	if(Nodes.empty()) return false;
+
+	FVector3f QueryMin, QueryMax;
+	const FBoxSpace BoxSpace = GetBoxSpace(Transform, BoxCenter, BoxExtent, QueryMin, QueryMax);
+	return ForEachBlock(QueryMin, QueryMax, [&](const uint32 BlockIdx)
+	{
+		return OverlapsBlock(Blocks[BlockIdx], BoxSpace) != 0;
+	});
+}
+
+void FRsapTriangleBVH::GetOverlappingTriangles(const FTransform& Transform, const FVector& BoxCenter, const FVector& BoxExtent, std::vector<FTriangle>& OutTriangles) const
+{
+	OutTriangles.clear();
+	if(Nodes.empty()) return;
+
+	FVector3f QueryMin, QueryMax;
+	const FBoxSpace BoxSpace = GetBoxSpace(Transform, BoxCenter, BoxExtent, QueryMin, QueryMax);
+	ForEachBlock(QueryMin, QueryMax, [&](const uint32 BlockIdx)
+	{
+		const FTriangleBlock& Block = Blocks[BlockIdx];
+		for (uint32 LaneMask = OverlapsBlock(Block, BoxSpace); LaneMask; LaneMask &= LaneMask - 1)
+		{
+			const uint32 Lane = FMath::CountTrailingZeros(LaneMask);
+
+			// The unused lanes of the last block repeat the triangle before it.
+			if(Lane && std::ranges::all_of(Block.Vertices, [Lane](const float (&Vertex)[3][4])
+			{
+				return Vertex[0][Lane] == Vertex[0][Lane - 1] && Vertex[1][Lane] == Vertex[1][Lane - 1] && Vertex[2][Lane] == Vertex[2][Lane - 1];
+			})) break;
+
+			FTriangle& Triangle = OutTriangles.emplace_back();
+			for (int32 Vertex = 0; Vertex < 3; ++Vertex)
+			{
+				for (int32 Axis = 0; Axis < 3; ++Axis)
+				{
+					const float* Row = BoxSpace.Matrix[Axis];
+					Triangle[Vertex][Axis] = Row[0] * Block.Vertices[Vertex][0][Lane] + Row[1] * Block.Vertices[Vertex][1][Lane] + Row[2] * Block.Vertices[Vertex][2][Lane] + Row[3];
+				}
+			}
+		}
+		return false;
+	});
+}
+
+/**
+ * Separating-axis-test of the box against the four triangles in the block, which is described in:
+ * "Fast 3D Triangle-Box Overlap Testing" by Tomas Akenine-Möller.
+ *
+ * The triangles are first transformed into the space of the box. Each lane is then tested against the 13 axes,
+ * and a triangle overlaps the box when none of these axes separate them.
+ */
+uint32 FRsapTriangleBVH::OverlapsBlock(const FTriangleBlock& Block, const FBoxSpace& BoxSpace)
+{
+	VectorRegister4Float V[3][3];
+	for (int32 Vertex = 0; Vertex < 3; ++Vertex)
+	{
+		const VectorRegister4Float X = VectorLoadAligned(Block.Vertices[Vertex][0]);
+		const VectorRegister4Float Y = VectorLoadAligned(Block.Vertices[Vertex][1]);
+		const VectorRegister4Float Z = VectorLoadAligned(Block.Vertices[Vertex][2]);
+		for (int32 Axis = 0; Axis < 3; ++Axis)
+		{
+			const float* Row = BoxSpace.Matrix[Axis];
+			VectorRegister4Float Result = VectorSetFloat1(Row[3]);
+			Result = VectorMultiplyAdd(X, VectorSetFloat1(Row[0]), Result);
+			Result = VectorMultiplyAdd(Y, VectorSetFloat1(Row[1]), Result);
+			V[Vertex][Axis] = VectorMultiplyAdd(Z, VectorSetFloat1(Row[2]), Result);
+		}
+	}
+	const VectorRegister4Float E[3] = { VectorSetFloat1(BoxSpace.Extent[0]), VectorSetFloat1(BoxSpace.Extent[1]), VectorSetFloat1(BoxSpace.Extent[2]) };
+
+	// A lane is separated when the projection of its triangle is outside the projected radius of the box on any of the axes.
+	VectorRegister4Float Separated = VectorZeroFloat();
+	const auto SeparateOnAxis = [&Separated](const VectorRegister4Float P0, const VectorRegister4Float P1, const VectorRegister4Float P2, const VectorRegister4Float Radius)
+	{
+		const VectorRegister4Float Min = VectorMin(VectorMin(P0, P1), P2);
+		const VectorRegister4Float Max = VectorMax(VectorMax(P0, P1), P2);
+		Separated = VectorBitwiseOr(Separated, VectorBitwiseOr(VectorCompareGT(Min, Radius), VectorCompareGT(VectorNegate(Radius), Max)));
+	};
+
+	// The face-normals of the box, which compares the bounds of the triangles against the box.
+	for (int32 Axis = 0; Axis < 3; ++Axis) SeparateOnAxis(V[0][Axis], V[1][Axis], V[2][Axis], E[Axis]);
+	if(VectorMaskBits(Separated) == 0b1111) return 0;
+
+	// The normal of the triangles.
+	VectorRegister4Float Edges[3][3];
+	for (int32 Axis = 0; Axis < 3; ++Axis)
+	{
+		Edges[0][Axis] = VectorSubtract(V[1][Axis], V[0][Axis]);
+		Edges[1][Axis] = VectorSubtract(V[2][Axis], V[1][Axis]);
+		Edges[2][Axis] = VectorSubtract(V[0][Axis], V[2][Axis]);
+	}
+	const VectorRegister4Float NormalX = VectorSubtract(VectorMultiply(Edges[0][1], Edges[1][2]), VectorMultiply(Edges[0][2], Edges[1][1]));
+	const VectorRegister4Float NormalY = VectorSubtract(VectorMultiply(Edges[0][2], Edges[1][0]), VectorMultiply(Edges[0][0], Edges[1][2]));
+	const VectorRegister4Float NormalZ = VectorSubtract(VectorMultiply(Edges[0][0], Edges[1][1]), VectorMultiply(Edges[0][1], Edges[1][0]));
+	const VectorRegister4Float Distance = VectorMultiplyAdd(NormalZ, V[0][2], VectorMultiplyAdd(NormalY, V[0][1], VectorMultiply(NormalX, V[0][0])));
+	const VectorRegister4Float NormalRadius = VectorMultiplyAdd(E[2], VectorAbs(NormalZ), VectorMultiplyAdd(E[1], VectorAbs(NormalY), VectorMultiply(E[0], VectorAbs(NormalX))));
+	Separated = VectorBitwiseOr(Separated, VectorCompareGT(VectorAbs(Distance), NormalRadius));
+	if(VectorMaskBits(Separated) == 0b1111) return 0;
+
+	// The cross-products of the edges with the axes of the box.
+	for (const VectorRegister4Float (&Edge)[3] : Edges)
+	{
+		const VectorRegister4Float AbsEdge[3] = { VectorAbs(Edge[0]), VectorAbs(Edge[1]), VectorAbs(Edge[2]) };
+		const auto Project = [&V](const VectorRegister4Float A, const int32 AxisA, const VectorRegister4Float B, const int32 AxisB, const int32 Vertex)
+		{
+			return VectorSubtract(VectorMultiply(A, V[Vertex][AxisA]), VectorMultiply(B, V[Vertex][AxisB]));
+		};
+
+		// X cross Edge = (0, -Edge.Z, Edge.Y)
+		SeparateOnAxis(Project(Edge[1], 2, Edge[2], 1, 0), Project(Edge[1], 2, Edge[2], 1, 1), Project(Edge[1], 2, Edge[2], 1, 2),
+			VectorMultiplyAdd(E[1], AbsEdge[2], VectorMultiply(E[2], AbsEdge[1])));
+
+		// Y cross Edge = (Edge.Z, 0, -Edge.X)
+		SeparateOnAxis(Project(Edge[2], 0, Edge[0], 2, 0), Project(Edge[2], 0, Edge[0], 2, 1), Project(Edge[2], 0, Edge[0], 2, 2),
+			VectorMultiplyAdd(E[0], AbsEdge[2], VectorMultiply(E[2], AbsEdge[0])));
+
+		// Z cross Edge = (-Edge.Y, Edge.X, 0)
+		SeparateOnAxis(Project(Edge[0], 1, Edge[1], 0, 0), Project(Edge[0], 1, Edge[1], 0, 1), Project(Edge[0], 1, Edge[1], 0, 2),
+			VectorMultiplyAdd(E[0], AbsEdge[1], VectorMultiply(E[1], AbsEdge[0])));
+	}
+
+	return ~VectorMaskBits(Separated) & 0b1111;
+}
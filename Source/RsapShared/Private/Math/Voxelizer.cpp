@@ -0,0 +1,153 @@
+﻿// Copyright Melvin Brink 2023. All Rights Reserved.
+
+#include "Rsap/Math/Voxelizer.h"
+
+
+
+namespace
+{
+	// Leafs are enlarged by this amount, in leaf-units, so that a triangle exactly on the border of a leaf is not missed due to rounding.
+	constexpr float Epsilon = 1e-4f;
+
+	// Spreads the 2-bit coordinate so that it can be interleaved with the other axis: 0b(b1)(b0) -> 0b(b1)00(b0).
+	constexpr uint32 Spread(const uint32 Coordinate)
+	{
+		return (Coordinate & 1) | (Coordinate & 2) << 2;
+	}
+
+	// Index of the leaf within FRsapLeaf::Leafs, which is the group-idx * 8 + the leaf-idx, and equal to the 6-bit morton-code of the leaf.
+	constexpr uint32 GetLeafIdx(const uint32 Coordinate, const int32 Axis)
+	{
+		return Spread(Coordinate) << Axis;
+	}
+
+	// Masks of the leafs in the range [Min, Max] on a single axis, with the other axis at zero. Indexed as [Axis][Min][Max].
+	constexpr auto MakeRangeMasks()
+	{
+		std::array<std::array<std::array<uint64, 4>, 4>, 3> Masks{};
+		for (int32 Axis = 0; Axis < 3; ++Axis)
+		{
+			for (uint32 Min = 0; Min < 4; ++Min)
+			{
+				for (uint32 Max = Min; Max < 4; ++Max)
+				{
+					for (uint32 Coordinate = Min; Coordinate <= Max; ++Coordinate) Masks[Axis][Min][Max] |= 1ull << GetLeafIdx(Coordinate, Axis);
+				}
+			}
+		}
+		return Masks;
+	}
+	constexpr auto RangeMasks = MakeRangeMasks();
+
+	// Convex polygon that results from clipping a triangle against the four planes of a column, which adds at most one vertex per plane.
+	struct FPolygon
+	{
+		FVector3f Vertices[7];
+		int32 Num = 0;
+	};
+
+	// Sutherland-Hodgman clipping against a single axis-aligned plane, keeping the part that is on the side of the sign.
+	void ClipPolygon(const FPolygon& Polygon, FPolygon& OutPolygon, const int32 Axis, const float Plane, const float Sign)
+	{
+		OutPolygon.Num = 0;
+		for (int32 Idx = 0; Idx < Polygon.Num; ++Idx)
+		{
+			const FVector3f& Current = Polygon.Vertices[Idx];
+			const FVector3f& Next = Polygon.Vertices[Idx + 1 == Polygon.Num ? 0 : Idx + 1];
+			const float CurrentDistance = (Current[Axis] - Plane) * Sign;
+			const float NextDistance = (Next[Axis] - Plane) * Sign;
+
+			if(CurrentDistance >= 0) OutPolygon.Vertices[OutPolygon.Num++] = Current;
+			if((CurrentDistance >= 0) != (NextDistance >= 0))
+			{
+				FVector3f& Intersection = OutPolygon.Vertices[OutPolygon.Num++];
+				Intersection = Current + (Next - Current) * (CurrentDistance / (CurrentDistance - NextDistance));
+				Intersection[Axis] = Plane; // Prevents the rounding from moving it outside the plane.
+			}
+		}
+	}
+
+	// Clips the polygon to the slab between the two planes on the axis. Returns false if nothing is left.
+	bool ClipToSlab(const FPolygon& Polygon, FPolygon& OutPolygon, const int32 Axis, const float Min, const float Max)
+	{
+		FPolygon Clipped;
+		ClipPolygon(Polygon, Clipped, Axis, Min, 1.f);
+		if(!Clipped.Num) return false;
+		ClipPolygon(Clipped, OutPolygon, Axis, Max, -1.f);
+		return OutPolygon.Num > 0;
+	}
+
+	FORCEINLINE uint32 ClampToLeaf(const float Value)
+	{
+		return static_cast<uint32>(FMath::Clamp(FMath::FloorToInt32(Value), 0, FRsapVoxelizer::LeafsPerAxis - 1));
+	}
+}
+
+uint64 FRsapVoxelizer::Triangle(const FRsapTriangleBVH::FTriangle& Triangle)
+{
+	FVector3f Min = Triangle[0].ComponentMin(Triangle[1]).ComponentMin(Triangle[2]);
+	FVector3f Max = Triangle[0].ComponentMax(Triangle[1]).ComponentMax(Triangle[2]);
+	Min -= FVector3f(Epsilon);
+	Max += FVector3f(Epsilon);
+	if(Max.X < 0 || Max.Y < 0 || Max.Z < 0 || Min.X > LeafsPerAxis || Min.Y > LeafsPerAxis || Min.Z > LeafsPerAxis) return 0;
+
+	// The major axis is the one the normal points towards the most, so that each column crosses as few leafs as possible.
+	const FVector3f Normal = ((Triangle[1] - Triangle[0]) ^ (Triangle[2] - Triangle[0])).GetAbs();
+	const int32 MajorAxis = Normal.X >= Normal.Y && Normal.X >= Normal.Z ? 0 : Normal.Y >= Normal.Z ? 1 : 2;
+	const int32 AxisU = (MajorAxis + 1) % 3;
+	const int32 AxisV = (MajorAxis + 2) % 3;
+
+	FPolygon TrianglePolygon;
+	TrianglePolygon.Vertices[0] = Triangle[0];
+	TrianglePolygon.Vertices[1] = Triangle[1];
+	TrianglePolygon.Vertices[2] = Triangle[2];
+	TrianglePolygon.Num = 3;
+
+	uint64 Leafs = 0;
+	for (uint32 U = ClampToLeaf(Min[AxisU]); U <= ClampToLeaf(Max[AxisU]); ++U)
+	{
+		FPolygon Row;
+		if(!ClipToSlab(TrianglePolygon, Row, AxisU, U - Epsilon, U + 1 + Epsilon)) continue;
+
+		for (uint32 V = ClampToLeaf(Min[AxisV]); V <= ClampToLeaf(Max[AxisV]); ++V)
+		{
+			FPolygon Column;
+			if(!ClipToSlab(Row, Column, AxisV, V - Epsilon, V + 1 + Epsilon)) continue;
+
+			// The range of the part of the triangle within this column, along the major axis.
+			float ColumnMin = Column.Vertices[0][MajorAxis], ColumnMax = ColumnMin;
+			for (int32 Idx = 1; Idx < Column.Num; ++Idx)
+			{
+				ColumnMin = FMath::Min(ColumnMin, Column.Vertices[Idx][MajorAxis]);
+				ColumnMax = FMath::Max(ColumnMax, Column.Vertices[Idx][MajorAxis]);
+			}
+			ColumnMin -= Epsilon;
+			ColumnMax += Epsilon;
+			if(ColumnMax < 0 || ColumnMin > LeafsPerAxis) continue;
+
+			// Shifting the mask of the range moves it to this column, because the bits of each axis are interleaved.
+			Leafs |= RangeMasks[MajorAxis][ClampToLeaf(ColumnMin)][ClampToLeaf(ColumnMax)] << (GetLeafIdx(U, AxisU) | GetLeafIdx(V, AxisV));
+		}
+	}
+	return Leafs;
+}
+
+uint64 FRsapVoxelizer::LeafNode(const FRsapTriangleBVH& TriangleBVH, const FTransform& Transform, const FRsapVector32& NodeLocation)
+{
+	// Reused between calls to prevent an allocation per leaf-node. Thread-local because generation could run on multiple threads.
+	thread_local std::vector<FRsapTriangleBVH::FTriangle> Triangles;
+
+	constexpr float HalveNodeSize = Node::HalveSizes[Layer::NodeDepth];
+	TriangleBVH.GetOverlappingTriangles(Transform, *(NodeLocation + Node::HalveSizes[Layer::NodeDepth]), FVector(HalveNodeSize), Triangles);
+
+	constexpr float LeafScale = 1.f / Node::Sizes[Layer::Leaf];
+	uint64 Leafs = 0;
+	for (FRsapTriangleBVH::FTriangle& Triangle : Triangles)
+	{
+		// Relative to the center, to relative to the negative corner in leaf-units.
+		for (FVector3f& Vertex : Triangle) Vertex = (Vertex + FVector3f(HalveNodeSize)) * LeafScale;
+		Leafs |= FRsapVoxelizer::Triangle(Triangle);
+		if(Leafs == ~0ull) break;
+	}
+	return Leafs;
+}
@@ -1,88 +1,368 @@
 ﻿// Copyright Melvin Brink 2023. All Rights Reserved.
 
-#include "Rsap/NavMesh/Navmesh.h"
+#include "Rsap/NavMesh/Processing/GenerationJob.h"
 #include "Rsap/World.h"
+#include "Async/TaskGraphInterfaces.h"
+#include "HAL/PlatformTime.h"
+#include "Tasks/Task.h"
+#include <algorithm>
+#include <atomic>
 #include <ranges>
+#include <unordered_set>
 
 
 
-// Generates the navmesh based on the world.
+namespace
+{
+	/**
+	 * Runs the callback for each index from the first up to the given amount, on the given amount of threads where the calling thread is one of them.
+	 * The indices are handed out one at a time, so that a thread that is done takes over the remaining work of the others.
+	 * A thread stops taking indices once the deadline has passed. Every index before the returned one has been processed.
+	 */
+	template<typename Func>
+	int32 ParallelForEachIndex(const int32 ThreadCount, const int32 FirstIdx, const int32 Num, const double Deadline, Func&& Callback)
+	{
+		std::atomic<int32> NextIdx = FirstIdx;
+		const auto Work = [&]
+		{
+			for (int32 Idx = NextIdx++; Idx < Num; Idx = NextIdx++)
+			{
+				Callback(Idx);
+				if(FPlatformTime::Seconds() >= Deadline) return;
+			}
+		};
+
+		TArray<UE::Tasks::FTask> Tasks;
+		for (int32 TaskIdx = 1; TaskIdx < FMath::Min(ThreadCount, Num - FirstIdx); ++TaskIdx) Tasks.Add(UE::Tasks::Launch(UE_SOURCE_LOCATION, Work));
+		Work();
+		UE::Tasks::Wait(Tasks);
+		return FMath::Min(NextIdx.load(), Num);
+	}
+}
+
 /**
  * Generates navmesh based on the world's geometry.
  * Fetches all the actor's components which are used for rasterization.
  * Will rasterize the octrees to a certain depth.
  */
-void FRsapNavmesh::Generate(const IRsapWorld* RsapWorld)
+void FRsapNavmesh::Generate(const IRsapWorld* RsapWorld, const ERsapNodeOrder NodeOrder, const int32 ThreadCount)
+{
+	if(!RsapWorld->GetWorld()) return;
+	FRsapGenerationJob(*this, RsapWorld, NodeOrder, ThreadCount).Tick();
+}
+
+void FRsapNavmesh::Regenerate(const IRsapWorld* RsapWorld, const std::vector<chunk_morton>& ChunkMCs, const ERsapNodeOrder NodeOrder, const int32 ThreadCount)
+{
+	if(!RsapWorld->GetWorld()) return;
+	FRsapGenerationJob(*this, RsapWorld, ChunkMCs, NodeOrder, ThreadCount).Tick();
+}
+
+void FRsapNavmesh::RegenerateActors(const IRsapWorld* RsapWorld, const std::vector<actor_key>& ActorKeys, const ERsapNodeOrder NodeOrder, const int32 ThreadCount)
 {
 	if(!RsapWorld->GetWorld()) return;
-	
+
+	std::unordered_set<chunk_morton> ChunkMCs;
+	const FRsapCollisionComponentRegistry& ComponentRegistry = FRsapCollisionComponentRegistry::Get();
+	for (const actor_key ActorKey : ActorKeys)
+	{
+		// The chunks it occluded, which is where it was when it was last rasterized.
+		if(const std::vector<chunk_morton>* ActorChunkMCs = FindActorChunks(ActorKey)) ChunkMCs.insert(ActorChunkMCs->begin(), ActorChunkMCs->end());
+
+		// The chunks it intersects now, which are none if it has been deleted.
+		const auto Iterator = RsapWorld->GetActors().find(ActorKey);
+		if(Iterator == RsapWorld->GetActors().end())
+		{
+			ActorHashes.erase(ActorKey);
+			continue;
+		}
+		for (const FRsapCollisionComponentHandle ComponentHandle : Iterator->second->GetCollisionComponents())
+		{
+			const FRsapCollisionComponent* CollisionComponent = ComponentRegistry.Find(ComponentHandle);
+			if(!CollisionComponent) continue;
+			CollisionComponent->GetBoundaries().ForEachChunk([&](const chunk_morton ChunkMC, const FRsapVector32&, const FRsapBounds&)
+			{
+				ChunkMCs.insert(ChunkMC);
+			});
+		}
+	}
+	Regenerate(RsapWorld, std::vector<chunk_morton>(ChunkMCs.begin(), ChunkMCs.end()), NodeOrder, ThreadCount);
+}
+
+FRsapGenerationJob::FRsapGenerationJob(FRsapNavmesh& InNavMesh, const IRsapWorld* RsapWorld, const ERsapNodeOrder InNodeOrder, const int32 InThreadCount)
+	: NavMesh(InNavMesh), NodeOrder(InNodeOrder), ThreadCount(InThreadCount > 0 ? InThreadCount : FTaskGraphInterface::Get().GetNumWorkerThreads() + 1)
+{
 	// Metadata->Chunks.Empty();
-	Chunks.clear();
-	UpdatedChunkMCs.clear();
-	DeletedChunkMCs.clear();
-
-	// Generate the navmesh using all the actors in the world.
-	HandleGenerate(RsapWorld->GetActors());
-
-	// Store all the morton-codes of the generated chunks in the metadata.
-	// for (const auto& ChunkMC : Chunks | std::views::keys)
-	// {
-	// 	Metadata->Chunks.Emplace(ChunkMC, FGuid::NewGuid());
-	// }
-	
-	// Metadata->Save(RsapWorld->GetWorld());
-	bRegenerated = true;
+	NavMesh.Clear();
+	NavMesh.UpdatedChunkMCs.clear();
+	NavMesh.DeletedChunkMCs.clear();
+
+	// Set before the job is complete, so that a cancelled job replaces the saved navmesh as well, instead of only its updated chunks.
+	NavMesh.bRegenerated = true;
+	GatherTasks(RsapWorld);
+}
+
+FRsapGenerationJob::FRsapGenerationJob(FRsapNavmesh& InNavMesh, const IRsapWorld* RsapWorld, const std::vector<chunk_morton>& ChunkMCs, const ERsapNodeOrder InNodeOrder, const int32 InThreadCount)
+	: NavMesh(InNavMesh), NodeOrder(InNodeOrder), ThreadCount(InThreadCount > 0 ? InThreadCount : FTaskGraphInterface::Get().GetNumWorkerThreads() + 1),
+	  RegeneratedChunkMCs(ChunkMCs.begin(), ChunkMCs.end())
+{
+	for (const chunk_morton ChunkMC : RegeneratedChunkMCs) NavMesh.EraseChunk(ChunkMC);
+	if(!RegeneratedChunkMCs.empty()) GatherTasks(RsapWorld);
+	else Phase = EPhase::Complete;
 }
 
-void FRsapNavmesh::HandleGenerate(const FRsapActorMap& ActorMap)
+void FRsapGenerationJob::GatherTasks(const IRsapWorld* RsapWorld)
 {
 	FRsapOverlap::InitCollisionBoxes();
 
-	for (const auto& RsapActor : ActorMap | std::views::values)
+	// Split the work of every component per chunk it intersects.
+	// Each chunk is rasterized by a single thread which owns its builder, so the threads never write to the same data.
+	Rsap::Map::flat_map<chunk_morton, size_t> ChunkTaskIndices;
+	const FRsapCollisionComponentRegistry& ComponentRegistry = FRsapCollisionComponentRegistry::Get();
+	for (const auto& RsapActor : RsapWorld->GetActors() | std::views::values)
 	{
-		std::unordered_set<chunk_morton> OccludedChunks;
-		for (const auto& CollisionComponent : RsapActor->GetCollisionComponents())
+		const actor_key ActorKey = RsapActor->GetActorKey();
+		uint32 ChunkCount = 0;
+		bool bIntersectsChunk = false;
+		for (const FRsapCollisionComponentHandle ComponentHandle : RsapActor->GetCollisionComponents())
 		{
-			// todo: maybe find thread-safer way to handle the collision component?
-			// todo: maybe different ExecuteRead overload that takes scene instead?
-			// todo: or use the component body ptr directly.
+			const FRsapCollisionComponent* CollisionComponent = ComponentRegistry.Find(ComponentHandle);
+			if(!CollisionComponent) continue;
 
-			FPhysicsCommand::ExecuteRead(CollisionComponent->GetPrimitive()->BodyInstance.ActorHandle, [&](const FPhysicsActorHandle& ActorHandle)
+			// todo: variable determining the minimum size a component needs to be for it to be used for rasterization?
+			CollisionComponent->GetBoundaries().ForEachChunk([&](const chunk_morton ChunkMC, const FRsapVector32&, const FRsapBounds& Intersection)
 			{
-				// todo: variable determining the minimum size a component needs to be for it to be used for rasterization?
-				IterateIntersectingNodes(*CollisionComponent, [&](FRsapChunk*& Chunk, const chunk_morton ChunkMC, const layer_idx LayerIdx, const node_morton NodeMC, const FRsapVector32& NodeLocation)
+				bIntersectsChunk = true;
+				if(!RegeneratedChunkMCs.empty() && !RegeneratedChunkMCs.contains(ChunkMC)) return;
+
+				const auto [Iterator, bInserted] = ChunkTaskIndices.try_emplace(ChunkMC, ChunkTasks.size());
+				if(bInserted) ChunkTasks.emplace_back().ChunkMC = ChunkMC;
+				FChunkTask& ChunkTask = ChunkTasks[Iterator->second];
+
+				// The parts of an actor are consecutive.
+				if(ChunkTask.Actors.empty() || ChunkTask.Actors.back() != ActorKey)
 				{
-					// Check if the component overlaps this voxel.
-					if(!FRsapNode::HasComponentOverlap(CollisionComponent->GetPrimitive(), NodeLocation, LayerIdx, true)) return;
-					if(!Chunk) Chunk = &InitChunk(ChunkMC);
-					
-					// The component is occluding at-least one voxel within this chunk, so add this chunk to the set.
-					OccludedChunks.emplace(ChunkMC);
-					
-					// Get/init the node, and also init/update any missing parent.
-					FRsapNode& Node = InitNode(*Chunk, ChunkMC, NodeMC, LayerIdx, 0, Direction::Negative::XYZ);
-					RasterizeNode(*Chunk, ChunkMC, Node, NodeMC, NodeLocation, LayerIdx, *CollisionComponent, false);
-					
-					// if(LayerIdx < Layer::NodeDepth)
-					// {
-					// 	FRsapNode& Node = InitNode(*Chunk, ChunkMC, NodeMC, LayerIdx, 0, Direction::Negative::XYZ);
-					// 	RasterizeNode(*Chunk, ChunkMC, Node, NodeMC, NodeLocation, LayerIdx, CollisionComponent, false);
-					// }
-					// else
-					// {
-					// 	FRsapLeaf& LeafNode = InitLeaf(*Chunk, ChunkMC, NodeMC, 0);
-					// 	RasterizeLeaf(LeafNode, NodeLocation, CollisionComponent, false);
-					// }
-				});
+					ChunkTask.Actors.push_back(ActorKey);
+					++ChunkCount;
+				}
+				ChunkTask.Parts.push_back({ComponentHandle, Intersection, ActorKey});
 			});
 		}
 
-		// Add this actor's key to each chunk it is occluding.
-		const actor_key ActorKey = RsapActor->GetActorKey();
-		for (auto ChunkMC : OccludedChunks)
+		// The navmesh is in-sync with this actor once all of its chunks are built, see BuildChunk, or right away if it does not intersect any chunk.
+		// An actor whose chunks are all outside of the regenerated ones keeps the hash it has.
+		if(ChunkCount) PendingActors.insert_or_assign(ActorKey, FPendingActor{RsapActor->GetCollisionHash(), ChunkCount});
+		else if(!bIntersectsChunk) NavMesh.ActorHashes.insert_or_assign(ActorKey, RsapActor->GetCollisionHash());
+	}
+}
+
+bool FRsapGenerationJob::Tick(const double BudgetSeconds)
+{
+	const double Deadline = FPlatformTime::Seconds() + BudgetSeconds;
+
+	// Processes the indices of the current phase, and returns true if all of them are done.
+	const auto Process = [&](const size_t Num, const bool bParallel, const auto& Callback)
+	{
+		const double PhaseDeadline = IsPublishing() ? std::numeric_limits<double>::infinity() : Deadline;
+		if(bParallel) NextIdx = ParallelForEachIndex(ThreadCount, NextIdx, static_cast<int32>(Num), PhaseDeadline, Callback);
+		else while(NextIdx < static_cast<int32>(Num))
 		{
-			FRsapChunk& Chunk = Chunks.find(ChunkMC)->second;
-			Chunk.UpdateActorEntry(ActorKey);
+			Callback(NextIdx++);
+			if(FPlatformTime::Seconds() >= PhaseDeadline) break;
 		}
+		return NextIdx == static_cast<int32>(Num);
+	};
+
+	while(Phase != EPhase::Complete)
+	{
+		// Picks the tasks of the batch before any of them is rasterized, so that it is up-to-date with the focus.
+		if(Phase == EPhase::Rasterize && NextIdx == 0) StartBatch();
+
+		bool bPhaseComplete = false;
+		switch (Phase)
+		{
+			case EPhase::Rasterize:
+				bPhaseComplete = Process(BatchEnd - BatchBegin, true, [&](const int32 TaskIdx){ RasterizeChunk(ChunkTasks[BatchBegin + TaskIdx]); });
+				break;
+			case EPhase::Build:
+				bPhaseComplete = Process(BatchEnd - BatchBegin, false, [&](const int32 TaskIdx){ BuildChunk(ChunkTasks[BatchBegin + TaskIdx]); });
+				break;
+			case EPhase::Relations:
+				// The relations within a chunk only touch the nodes of that chunk, so these are set in parallel.
+				bPhaseComplete = Process(Chunks.size(), true, [&](const int32 ChunkIdx){ NavMesh.SetChunkRelations(*Chunks[ChunkIdx].second, Chunks[ChunkIdx].first, false); });
+				break;
+			case EPhase::Stitch:
+				// The relations across the borders of the chunks, when every chunk has its relations within.
+				bPhaseComplete = Process(Chunks.size(), false, [&](const int32 ChunkIdx){ NavMesh.SetChunkRelations(*Chunks[ChunkIdx].second, Chunks[ChunkIdx].first, true); });
+				break;
+			default: break;
+		}
+
+		if(!bPhaseComplete) break;
+		NextPhase();
+		if(!IsPublishing() && FPlatformTime::Seconds() >= Deadline) break;
+	}
+	return IsComplete();
+}
+
+void FRsapGenerationJob::SetFocus(const FVector& Location)
+{
+	if(bHasFocus && FVector::DistSquared(Focus, Location) < FMath::Square(static_cast<double>(Chunk::Size))) return;
+	bHasFocus = true;
+	bFocusMoved = true;
+	Focus = Location;
+}
+
+float FRsapGenerationJob::GetProgress() const
+{
+	if(Phase == EPhase::Complete || ChunkTasks.empty()) return Phase == EPhase::Complete ? 1.f : 0.f;
+	const size_t Num = Phase == EPhase::Rasterize || Phase == EPhase::Build ? BatchEnd - BatchBegin : Chunks.size();
+	const float PhaseProgress = Num ? static_cast<float>(NextIdx) / Num : 1.f;
+	const float BatchProgress = (static_cast<uint8>(Phase) + PhaseProgress) / static_cast<uint8>(EPhase::Complete);
+	return (BatchBegin + BatchProgress * (BatchEnd - BatchBegin)) / ChunkTasks.size();
+}
+
+const TCHAR* FRsapGenerationJob::GetPhaseName() const
+{
+	switch (Phase)
+	{
+		case EPhase::Rasterize:	return TEXT("Rasterizing");
+		case EPhase::Build:		return TEXT("Building octrees");
+		case EPhase::Relations:	return TEXT("Setting relations");
+		case EPhase::Stitch:	return TEXT("Stitching chunks");
+		default:				return TEXT("Complete");
+	}
+}
+
+void FRsapGenerationJob::RasterizeChunk(FChunkTask& ChunkTask) const
+{
+	const FRsapCollisionComponentRegistry& ComponentRegistry = FRsapCollisionComponentRegistry::Get();
+	for (const FChunkPart& Part : ChunkTask.Parts)
+	{
+		// Skip the components that have been removed since the job has started.
+		const FRsapCollisionComponent* CollisionComponent = ComponentRegistry.Find(Part.Component);
+		if(!CollisionComponent) continue;
+
+		const bool bIsOccluding = FRsapNavmesh::RasterizeComponent(ChunkTask.Builder, *CollisionComponent, Part.Intersection, NodeOrder);
+
+		// The parts of an actor are consecutive.
+		if(bIsOccluding && (ChunkTask.OccludingActors.empty() || ChunkTask.OccludingActors.back() != Part.ActorKey))
+		{
+			ChunkTask.OccludingActors.push_back(Part.ActorKey);
+		}
+	}
+	ChunkTask.Parts = {};
+}
+
+// The chunks and their nodes are allocated from the arena, which is not thread-safe, so these are built on the calling thread.
+void FRsapGenerationJob::BuildChunk(FChunkTask& ChunkTask)
+{
+	if(!ChunkTask.OccludingActors.empty())
+	{
+		FRsapChunk& Chunk = NavMesh.InitChunk(ChunkTask.ChunkMC);
+		for (const actor_key ActorKey : ChunkTask.OccludingActors) NavMesh.AddActorEntry(Chunk, ChunkTask.ChunkMC, ActorKey, PendingActors.find(ActorKey)->second.CollisionHash);
+		ChunkTask.Builder.Build(*Chunk.Octrees[Node::State::Static]);
+		ChunkTask.Builder = FRsapOctreeBuilder(); // Frees its memory, which it otherwise keeps for a next octree.
+		Chunk.InvalidateLinearOctree();
+	}
+
+	// The navmesh is now in-sync with the actors that have no other chunks left to build.
+	for (const actor_key ActorKey : ChunkTask.Actors)
+	{
+		const auto Iterator = PendingActors.find(ActorKey);
+		if(--Iterator->second.RemainingChunkCount) continue;
+		NavMesh.ActorHashes.insert_or_assign(ActorKey, Iterator->second.CollisionHash);
+		PendingActors.erase(Iterator);
+	}
+	ChunkTask.Actors = {};
+}
+
+void FRsapGenerationJob::StartBatch()
+{
+	if(!bHasFocus)
+	{
+		BatchEnd = static_cast<int32>(ChunkTasks.size());
+		return;
+	}
+	BatchEnd = BatchBegin + FMath::Min(static_cast<int32>(ChunkTasks.size()) - BatchBegin, ThreadCount * BatchSizePerThread);
+	if(!bFocusMoved) return;
+	bFocusMoved = false;
+
+	// Orders the remaining tasks by the distance of their chunk to the focus.
+	const auto GetDistanceToFocus = [&](const FChunkTask& ChunkTask)
+	{
+		return FVector::DistSquared(Focus, *FRsapVector32::FromChunkMorton(ChunkTask.ChunkMC) + FVector(Chunk::Size / 2.0));
+	};
+	std::ranges::sort(ChunkTasks.begin() + BatchBegin, ChunkTasks.end(), {}, GetDistanceToFocus);
+}
+
+void FRsapGenerationJob::NextPhase()
+{
+	NextIdx = 0;
+
+	// Continue with the next batch when there are tasks left.
+	if(Phase == EPhase::Stitch)
+	{
+		++CompletedBatchCount;
+		Chunks.clear();
+		BatchBegin = BatchEnd;
+		if(BatchBegin < static_cast<int32>(ChunkTasks.size()))
+		{
+			Phase = EPhase::Rasterize;
+			return;
+		}
+	}
+	Phase = static_cast<EPhase>(static_cast<uint8>(Phase) + 1);
+
+	switch (Phase)
+	{
+		case EPhase::Relations:
+			// Every chunk of the batch exists at this point, so they won't move until the next batch.
+			for (int32 TaskIdx = BatchBegin; TaskIdx < BatchEnd; ++TaskIdx)
+			{
+				const chunk_morton ChunkMC = ChunkTasks[TaskIdx].ChunkMC;
+				if(const auto Iterator = NavMesh.Chunks.find(ChunkMC); Iterator != NavMesh.Chunks.end()) Chunks.emplace_back(ChunkMC, &Iterator->second);
+			}
+			break;
+		case EPhase::Stitch:
+			{
+				// The borders of the chunks from earlier batches have to be stitched again when a neighbour is added.
+				std::unordered_set<const FRsapChunk*> StitchedChunks;
+				for (const FRsapChunk* Chunk : Chunks | std::views::values) StitchedChunks.insert(Chunk);
+				for (size_t ChunkIdx = 0, BatchChunkCount = Chunks.size(); ChunkIdx < BatchChunkCount; ++ChunkIdx)
+				{
+					for (uint8 DirectionIdx = 0; DirectionIdx < std::size(Direction::List); ++DirectionIdx)
+					{
+						FRsapChunk* Neighbour = Chunks[ChunkIdx].second->Neighbours[DirectionIdx];
+						if(!Neighbour || !StitchedChunks.insert(Neighbour).second) continue;
+						Chunks.emplace_back(FMortonUtils::Chunk::GetNeighbour(Chunks[ChunkIdx].first, Direction::List[DirectionIdx]), Neighbour);
+					}
+				}
+			}
+			break;
+		case EPhase::Complete:
+			ChunkTasks = {};
+			Chunks = {};
+			if(RegeneratedChunkMCs.empty()) break;
+
+			for (const chunk_morton ChunkMC : RegeneratedChunkMCs)
+			{
+				if(NavMesh.FindChunk(ChunkMC))
+				{
+					NavMesh.DeletedChunkMCs.erase(ChunkMC);
+					NavMesh.UpdatedChunkMCs.insert(ChunkMC);
+					continue;
+				}
+
+				// The chunk is not occluded anymore, so the chunks around it now border an empty chunk.
+				NavMesh.UpdatedChunkMCs.erase(ChunkMC);
+				NavMesh.DeletedChunkMCs.insert(ChunkMC);
+				for (const rsap_direction Direction : Direction::List)
+				{
+					const chunk_morton NeighbourChunkMC = FMortonUtils::Chunk::GetNeighbour(ChunkMC, Direction);
+					if(const FRsapChunk* NeighbourChunk = NavMesh.FindChunk(NeighbourChunkMC)) NavMesh.SetChunkRelations(*NeighbourChunk, NeighbourChunkMC, true);
+				}
+			}
+			break;
+		default: break;
 	}
 }
\ No newline at end of file
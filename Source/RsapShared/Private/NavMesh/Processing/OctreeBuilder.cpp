@@ -0,0 +1,94 @@
+﻿// Copyright Melvin Brink 2023. All Rights Reserved.
+
+#include "Rsap/NavMesh/Processing/OctreeBuilder.h"
+#include "Rsap/Math/RadixSort.h"
+
+
+
+namespace
+{
+	// Adds the node to the end of a sorted layer, which is constant time for both the ordered and the sorted map.
+	template<typename MapType>
+	FORCEINLINE auto& Append(MapType& Map, const node_morton NodeMC)
+	{
+		if constexpr (requires { Map.try_emplace(Map.end(), NodeMC); }) return Map.try_emplace(Map.end(), NodeMC)->second;
+		else return Map.try_emplace(NodeMC).first->second;
+	}
+
+	template<typename MapType>
+	FORCEINLINE void Reserve(MapType& Map, const size_t Count)
+	{
+		if constexpr (requires { Map.reserve(Count); }) Map.reserve(Count);
+	}
+}
+
+void FRsapOctreeBuilder::Build(FOctree& Octree)
+{
+	for (const auto& Layer : Octree.Layers) Layer->clear();
+	Octree.LeafNodes->clear();
+	Parents.clear();
+
+	// Duplicate leaf-nodes are next to each other once sorted.
+	Rsap::Sort::RadixSort(LeafNodes, LeafScratch, [](const FLeafNode& LeafNode) { return LeafNode.NodeMC; });
+	Reserve(*Octree.LeafNodes, LeafNodes.size());
+	for (size_t Idx = 0; Idx < LeafNodes.size();)
+	{
+		const node_morton NodeMC = LeafNodes[Idx].NodeMC;
+		uint64 Leafs = 0;
+		for (; Idx < LeafNodes.size() && LeafNodes[Idx].NodeMC == NodeMC; ++Idx) Leafs |= LeafNodes[Idx].Leafs;
+
+		Append(*Octree.LeafNodes, NodeMC).Leafs = Leafs;
+		AddToParent(Parents, NodeMC, Layer::NodeDepth);
+	}
+	LeafNodes.clear();
+
+	for (int32 LayerIdx = DeepestLayerIdx; LayerIdx >= 0; --LayerIdx)
+	{
+		std::vector<node_morton>& Nodes = NodeLayers[LayerIdx];
+		Rsap::Sort::RadixSort(Nodes, NodeScratch);
+
+		// Merge the added nodes with the parents of the layer below, which are both sorted. A node can be in both.
+		FOctree::FLayer& Layer = *Octree.Layers[LayerIdx];
+		Layer.reserve(Nodes.size() + Parents.size());
+		NextParents.clear();
+
+		auto NodeIterator = Nodes.begin();
+		auto ParentIterator = Parents.begin();
+		while (NodeIterator != Nodes.end() || ParentIterator != Parents.end())
+		{
+			node_morton NodeMC;
+			uint8 Children = 0;
+			if(ParentIterator == Parents.end() || (NodeIterator != Nodes.end() && *NodeIterator < ParentIterator->NodeMC))
+			{
+				NodeMC = *NodeIterator;
+			}
+			else
+			{
+				NodeMC = ParentIterator->NodeMC;
+				Children = ParentIterator->Children;
+				++ParentIterator;
+			}
+			while (NodeIterator != Nodes.end() && *NodeIterator == NodeMC) ++NodeIterator;
+
+			Layer.try_emplace(NodeMC).first->second.Children = Children;
+			if(LayerIdx > 0) AddToParent(NextParents, NodeMC, LayerIdx);
+		}
+
+		Nodes.clear();
+		Parents.swap(NextParents);
+	}
+}
+
+void FRsapOctreeBuilder::Reset()
+{
+	for (std::vector<node_morton>& Nodes : NodeLayers) Nodes.clear();
+	LeafNodes.clear();
+}
+
+// The nodes are added in morton-order, so the children of a parent are always consecutive.
+void FRsapOctreeBuilder::AddToParent(std::vector<FParentNode>& OutParents, const node_morton NodeMC, const layer_idx LayerIdx)
+{
+	const node_morton ParentNodeMC = FMortonUtils::Node::GetParent(NodeMC, LayerIdx-1);
+	if(OutParents.empty() || OutParents.back().NodeMC != ParentNodeMC) OutParents.push_back({ParentNodeMC, 0});
+	OutParents.back().Children |= Node::Children::Masks[FMortonUtils::Node::GetChildIndex(NodeMC, LayerIdx)];
+}
@@ -2,6 +2,7 @@
 
 #include "Rsap/NavMesh/Navmesh.h"
 #include "Rsap/NavMesh/Processing/Shared.h"
+#include "Rsap/Math/Voxelizer.h"
 
 
 
@@ -71,7 +72,7 @@ void FRsapNavmesh::SetNodeRelation(const FRsapChunk& Chunk, const chunk_morton C
 	const FRsapChunk* NeighbourChunk;
 	if(FMortonUtils::Node::HasMovedIntoNewChunk(NodeMC, NeighbourMC, Relation))
 	{
-		NeighbourChunk = FindChunk(FMortonUtils::Chunk::GetNeighbour(ChunkMC, Relation));
+		NeighbourChunk = Chunk.GetNeighbour(Relation);
 		if(!NeighbourChunk)
 		{
 			// There is no chunk, so we can set the relation to 'empty'.
@@ -83,23 +84,31 @@ void FRsapNavmesh::SetNodeRelation(const FRsapChunk& Chunk, const chunk_morton C
 
 	// Set the relation by trying to find the neighbour in this direction, starting from the given layer-index.
 	// If none is found for the layer, then we get it's parent. If this parent equals the node's parent, then we set the relation to a special 'parent' index.
+	// The parents in another chunk are never the node's own parent, so the search continues up to the root of that chunk.
 	for(layer_idx NeighbourLayerIdx = LayerIdx; NeighbourLayerIdx < Layer::Total; --NeighbourLayerIdx)
 	{
-		if(FRsapNode NeighbourNode; NeighbourChunk->FindNode(NeighbourNode, NeighbourMC, NeighbourLayerIdx, 0))
+		if(FRsapNode* NeighbourNode = NeighbourChunk->FindNode(NeighbourMC, NeighbourLayerIdx, 0))
 		{
-			// Neighbour exists, so set the relations on the node, and the neighbour.
+			// Neighbour exists, so set the relation on the node.
+			// A neighbour in the same layer also has this node as its neighbour, so set the inverse relation on the neighbour itself.
 			Node.Relations.SetFromDirection(Relation, NeighbourLayerIdx);
-			NeighbourNode.Relations.SetFromDirectionInverse(Relation, NeighbourLayerIdx);
+			if(NeighbourLayerIdx == LayerIdx) NeighbourNode->Relations.SetFromDirectionInverse(Relation, LayerIdx);
 			// Also update the relations of the neighbour's children that are against the node.
 			// todo: extra flag argument that tells us if we want to update any children BELOW the node's LayerIdx.
 			// RecursiveSetChildRelations
 			break;
 		}
+		if(NeighbourLayerIdx == Layer::Root)
+		{
+			// The neighbouring chunk has no root.
+			Node.Relations.SetFromDirection(Relation, Layer::Empty);
+			break;
+		}
 
 		// Neighbour not found, so set the morton-code to it's parent, and try again if this is not the same parent as the node.
 		const layer_idx ParentLayerIdx = NeighbourLayerIdx-1;
 		NeighbourMC = FMortonUtils::Node::GetParent(NeighbourMC, ParentLayerIdx);
-		if(NeighbourMC != FMortonUtils::Node::GetParent(NodeMC, ParentLayerIdx)) continue;
+		if(NeighbourChunk != &Chunk || NeighbourMC != FMortonUtils::Node::GetParent(NodeMC, ParentLayerIdx)) continue;
 
 		// Same parent, so set the layer-index to the value indicating that this relation points to out parent.
 		Node.Relations.SetFromDirection(Relation, Layer::Parent);
@@ -116,10 +125,142 @@ void FRsapNavmesh::SetNodeRelations(const FRsapChunk& Chunk, const chunk_morton
 	}
 }
 
-// Re-rasterizes the node while skipping children that are not intersecting with the actor's boundaries.
-void FRsapNavmesh::RasterizeNode(FRsapChunk& Chunk, const chunk_morton ChunkMC, FRsapNode& Node, const node_morton NodeMC, const FRsapVector32& NodeLocation, const layer_idx LayerIdx, const FRsapCollisionComponent& CollisionComponent, const bool bIsAABBContained)
+/**
+ * Sets the relations of every node in the static octree of the chunk, used after the octree has been built by the FRsapOctreeBuilder.
+ * Either the relations within the chunk, which only touch this chunk, or the ones against the borders of the chunk which point into the neighbouring chunks.
+ * The relations within must be set on every chunk before the borders are set on any of them.
+ *
+ * Instead of searching the neighbour of every relation through the upper layers, the layers are swept top-down in morton-order,
+ * where each relation follows from the parent's relation in the same direction:
+ * - The neighbour is a sibling: it exists if the parent has this child, otherwise the relation points to the parent.
+ * - The parent's neighbour is not in the parent's layer: the node has the same relation as its parent, because the search would take the same path.
+ * - The parent's neighbour is in the parent's layer: the neighbour is either in this layer, or it is the parent's neighbour.
+ *
+ * Only the last case needs a lookup, which also sets the relation on the neighbour, so each face is only resolved once.
+ */
+void FRsapNavmesh::SetChunkRelations(const FRsapChunk& Chunk, const chunk_morton ChunkMC, const bool bChunkBorders)
+{
+	const auto& Layers = Chunk.Octrees[Node::State::Static]->Layers;
+	if(Layers[Layer::Root]->empty()) return;
+
+	// The root only has relations against the borders, which are to the roots of the neighbouring chunks.
+	if(bChunkBorders)
+	{
+		FRsapNode& RootNode = (*Layers[Layer::Root]->begin()).second;
+		for (uint8 DirectionIdx = 0; DirectionIdx < std::size(Direction::List); ++DirectionIdx)
+		{
+			RootNode.Relations.SetFromDirection(Direction::List[DirectionIdx], Chunk.Neighbours[DirectionIdx] ? Layer::Root : Layer::Empty);
+		}
+	}
+
+	for (layer_idx LayerIdx = 1; LayerIdx < Layers.size(); ++LayerIdx)
+	{
+		const layer_idx ParentLayerIdx = LayerIdx-1;
+		auto& Layer = *Layers[LayerIdx];
+
+		// The relations of this layer are only written while sweeping this layer. Positive relations are also written to the neighbour,
+		// which comes later in morton-order, so it knows its neighbour exists when its own relation is still unset.
+		if(!bChunkBorders) for (const auto& [NodeMC, Node] : Layer) Node.Relations = FRsapRelations();
+
+		// The parents are in morton-order as well, so they are walked alongside the nodes.
+		auto ParentIterator = Layers[ParentLayerIdx]->begin();
+		for (const auto& [NodeMC, Node] : Layer)
+		{
+			const node_morton ParentNodeMC = FMortonUtils::Node::GetParent(NodeMC, ParentLayerIdx);
+			while(ParentIterator->first != ParentNodeMC) ++ParentIterator;
+			const FRsapNode& ParentNode = ParentIterator->second;
+
+			const child_idx ChildIdx = FMortonUtils::Node::GetChildIndex(NodeMC, LayerIdx);
+			const rsap_direction BorderDirections = FMortonUtils::Node::GetChunkBorderDirections(NodeMC, LayerIdx);
+			for (uint8 DirectionIdx = 0; DirectionIdx < std::size(Direction::List); ++DirectionIdx)
+			{
+				const rsap_direction Relation = Direction::List[DirectionIdx];
+				if(static_cast<bool>(BorderDirections & Relation) != bChunkBorders) continue;
+
+				// The bit of the child-index that is on the same axis as the direction.
+				const child_idx AxisBit = Relation & (Direction::Negative::X | Direction::Positive::X) ? 0b001 : Relation & (Direction::Negative::Y | Direction::Positive::Y) ? 0b010 : 0b100;
+				const bool bIsPositive = Relation & Direction::Positive::XYZ;
+
+				// Sibling.
+				if(static_cast<bool>(ChildIdx & AxisBit) != bIsPositive)
+				{
+					Node.Relations.SetFromDirection(Relation, ParentNode.DoesChildExist(ChildIdx ^ AxisBit) ? LayerIdx : Layer::Parent);
+					continue;
+				}
+
+				// The parent's neighbour is empty space, or a node in an upper layer.
+				const layer_idx ParentRelation = ParentNode.Relations.GetFromDirection(Relation);
+				if(ParentRelation != ParentLayerIdx)
+				{
+					Node.Relations.SetFromDirection(Relation, ParentRelation);
+					continue;
+				}
+
+				// Negative relations within the chunk have already been set by the neighbour if it exists.
+				if(!bIsPositive && !bChunkBorders)
+				{
+					if(Node.Relations.GetFromDirection(Relation) != LayerIdx) Node.Relations.SetFromDirection(Relation, ParentLayerIdx);
+					continue;
+				}
+
+				const FRsapChunk* NeighbourChunk = bChunkBorders ? Chunk.Neighbours[DirectionIdx] : &Chunk;
+				if(FRsapNode* NeighbourNode = NeighbourChunk->FindNode(FMortonUtils::Node::Move(NodeMC, LayerIdx, Relation), LayerIdx, Node::State::Static))
+				{
+					Node.Relations.SetFromDirection(Relation, LayerIdx);
+					NeighbourNode->Relations.SetFromDirectionInverse(Relation, LayerIdx);
+				}
+				else Node.Relations.SetFromDirection(Relation, ParentLayerIdx);
+			}
+		}
+	}
+}
+
+// Adds the children that overlap the component to the builder, while skipping children that are not intersecting with the actor's boundaries.
+/**
+ * Rasterizes the part of the component within the intersection, which should not exceed a single chunk, into the builder.
+ * Returns true if any node is occluded by the component.
+ */
+bool FRsapNavmesh::RasterizeComponent(FRsapOctreeBuilder& Builder, const FRsapCollisionComponent& CollisionComponent, const FRsapBounds& Intersection, const ERsapNodeOrder NodeOrder)
+{
+	const layer_idx LayerIdx = CollisionComponent.GetBoundaries().GetOptimalRasterizationLayer();
+	bool bIsOccluding = false;
+
+	const auto ProcessNode = [&](const node_morton NodeMC, const FRsapVector32& NodeLocation)
+	{
+		// Check if the component overlaps this voxel.
+		if(!FRsapNode::HasComponentOverlap(CollisionComponent, NodeLocation, LayerIdx, true)) return;
+		bIsOccluding = true;
+
+		// Add the node, and any of its children that are occluding. The parents are created by the builder.
+		Builder.AddNode(NodeMC, LayerIdx);
+		RasterizeNode(Builder, NodeMC, NodeLocation, LayerIdx, CollisionComponent, false);
+	};
+
+	const auto Rasterize = [&]
+	{
+		if(NodeOrder == ERsapNodeOrder::Morton) Intersection.ForEachNode<ERsapNodeOrder::Morton>(LayerIdx, ProcessNode);
+		else Intersection.ForEachNode<ERsapNodeOrder::Axis>(LayerIdx, ProcessNode);
+	};
+
+	// Components whose triangles are both their simple and complex collision are tested without the physics-scene, so the scene only has to be locked for the others.
+	// The lock is a read-lock, which the threads can hold at the same time.
+	if(!CollisionComponent.NeedsPhysicsScene()) Rasterize();
+	else if(const UPrimitiveComponent* Primitive = CollisionComponent.GetPrimitive())
+	{
+		// todo: maybe find thread-safer way to handle the collision component?
+		// todo: maybe different ExecuteRead overload that takes scene instead?
+		// todo: or use the component body ptr directly.
+		FPhysicsCommand::ExecuteRead(Primitive->BodyInstance.ActorHandle, [&](const FPhysicsActorHandle& ActorHandle)
+		{
+			Rasterize();
+		});
+	}
+	return bIsOccluding;
+}
+
+void FRsapNavmesh::RasterizeNode(FRsapOctreeBuilder& Builder, const node_morton NodeMC, const FRsapVector32& NodeLocation, const layer_idx LayerIdx, const FRsapCollisionComponent& CollisionComponent, const bool bIsAABBContained)
 {
-	// Create the children.
+	// Find the children.
 	const layer_idx ChildLayerIdx = LayerIdx+1;
 	for(child_idx ChildIdx = 0; ChildIdx < 8; ++ChildIdx)
 	{
@@ -136,50 +277,48 @@ void FRsapNavmesh::RasterizeNode(FRsapChunk& Chunk, const chunk_morton ChunkMC,
 			{
 				case EAABBOverlapResult::NoOverlap: continue;
 				case EAABBOverlapResult::Intersect:
-					if(!FRsapNode::HasComponentOverlap(*CollisionComponent, ChildNodeLocation, ChildLayerIdx, false)) continue;
+					if(!FRsapNode::HasComponentOverlap(CollisionComponent, ChildNodeLocation, ChildLayerIdx, false)) continue;
 					break;
 				case EAABBOverlapResult::Contained:
-					if(!FRsapNode::HasComponentOverlap(*CollisionComponent, ChildNodeLocation, ChildLayerIdx, true )) continue;
+					if(!FRsapNode::HasComponentOverlap(CollisionComponent, ChildNodeLocation, ChildLayerIdx, true )) continue;
 					bIsChildContained = true;
 					break;
 			}
 		}
-		else if(!FRsapNode::HasComponentOverlap(*CollisionComponent, ChildNodeLocation, ChildLayerIdx, true)) continue;
+		else if(!FRsapNode::HasComponentOverlap(CollisionComponent, ChildNodeLocation, ChildLayerIdx, true)) continue;
 		
 		const node_morton ChildNodeMC = FMortonUtils::Node::GetChild(NodeMC, ChildLayerIdx, ChildIdx);
 
-		FRsapNode& ChildNode = Node.DoesChildExist(ChildIdx) ? Chunk.GetNode(ChildNodeMC, ChildLayerIdx, 0) : Chunk.TryInitNode(ChildNodeMC, ChildLayerIdx, 0);
-		SetNodeRelations(Chunk, ChunkMC, ChildNode, ChildNodeMC, ChildLayerIdx, Direction::Negative::XYZ);
-		Node.SetChildActive(ChildIdx);
+		// Nodes that are also the parent of an added node are deduped by the builder.
+		Builder.AddNode(ChildNodeMC, ChildLayerIdx);
 		
 		if(ChildLayerIdx > Layer::StaticDepth) continue;
-		RasterizeNode(Chunk, ChunkMC, ChildNode, ChildNodeMC, ChildNodeLocation, ChildLayerIdx, CollisionComponent, bIsChildContained);
+		RasterizeNode(Builder, ChildNodeMC, ChildNodeLocation, ChildLayerIdx, CollisionComponent, bIsChildContained);
 
 		// This code was for testing leafs.
-		// if(ChildLayerIdx < Layer::NodeDepth)
+		// if(ChildLayerIdx == Layer::NodeDepth)
 		// {
-		// 	FRsapNode& ChildNode = Node.DoesChildExist(ChildIdx) ? Chunk.GetNode(ChildNodeMC, ChildLayerIdx, 0) : Chunk.TryInitNode(ChildNodeMC, ChildLayerIdx, 0);
-		// 	RasterizeNode(Chunk, ChunkMC, ChildNode, ChildNodeMC, ChildNodeLocation, ChildLayerIdx, CollisionComponent, bIsChildContained);
-		// 	SetNodeRelations(Chunk, ChunkMC, ChildNode, ChildNodeMC, ChildLayerIdx, Direction::Negative::XYZ);
-		// }
-		// else
-		// {
-		// 	FRsapLeaf& LeafNode = Node.DoesChildExist(ChildIdx) ? Chunk.GetLeafNode(ChildNodeMC, 0) : Chunk.TryInitLeafNode(ChildNodeMC, 0);
+		// 	FRsapLeaf LeafNode;
 		// 	RasterizeLeaf(LeafNode, ChildNodeLocation, CollisionComponent, bIsChildContained);
+		// 	Builder.AddLeafNode(ChildNodeMC, LeafNode.Leafs);
 		// }
-
-		// Set child to be alive on parent.
-		Node.SetChildActive(ChildIdx);
 	}
 }
 
 void FRsapNavmesh::RasterizeLeaf(FRsapLeaf& LeafNode, const FRsapVector32& NodeLocation, const FRsapCollisionComponent& CollisionComponent, const bool bIsAABBContained)
 {
+	// Meshes with a triangle-BVH are voxelized directly into the 64 leafs, instead of doing an overlap-check per group and leaf.
+	if(const FRsapTriangleBVH* TriangleBVH = CollisionComponent.GetTriangleBVH())
+	{
+		LeafNode.Leafs |= FRsapVoxelizer::LeafNode(*TriangleBVH, CollisionComponent.GetTransform(), NodeLocation);
+		return;
+	}
+	
 	// Rasterize the 64 leafs the same way as the octree, so dividing it per 8, and only rasterize individual leafs if a group of 8 is occluding.
 	for(child_idx LeafGroupIdx = 0; LeafGroupIdx < 8; ++LeafGroupIdx)
 	{
 		const FRsapVector32 GroupLocation = FRsapNode::GetChildLocation(NodeLocation, Layer::GroupedLeaf, LeafGroupIdx);
-		if(!FRsapNode::HasComponentOverlap(*CollisionComponent, GroupLocation, Layer::GroupedLeaf, true))
+		if(!FRsapNode::HasComponentOverlap(CollisionComponent, GroupLocation, Layer::GroupedLeaf, true))
 		{
 			// todo: for updater, clear these 8 bits.
 			continue;
@@ -192,7 +331,7 @@ void FRsapNavmesh::RasterizeLeaf(FRsapLeaf& LeafNode, const FRsapVector32& NodeL
 		child_idx LeafIdx = 0;
 		for(const uint8 Leaf : Node::Children::Masks)
 		{
-			if(!FRsapNode::HasComponentOverlap(*CollisionComponent, FRsapNode::GetChildLocation(GroupLocation, Layer::Leaf, LeafIdx++), Layer::Leaf, true))
+			if(!FRsapNode::HasComponentOverlap(CollisionComponent, FRsapNode::GetChildLocation(GroupLocation, Layer::Leaf, LeafIdx++), Layer::Leaf, true))
 			{
 				// todo: for updater, clear this single bit.
 				continue;
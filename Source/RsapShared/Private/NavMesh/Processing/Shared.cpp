@@ -71,7 +71,7 @@ void FRsapProcessing::SetNodeRelation(FRsapNavmesh& NavMesh, const FRsapChunk& C
 	const FRsapChunk* NeighbourChunk;
 	if(FMortonUtils::Node::HasMovedIntoNewChunk(NodeMC, NeighbourMC, Relation))
 	{
-		NeighbourChunk = NavMesh.FindChunk(FMortonUtils::Chunk::GetNeighbour(ChunkMC, Relation));
+		NeighbourChunk = Chunk.GetNeighbour(Relation);
 		if(!NeighbourChunk)
 		{
 			// There is no chunk, so we can set the relation to 'empty'.
@@ -83,23 +83,31 @@ void FRsapProcessing::SetNodeRelation(FRsapNavmesh& NavMesh, const FRsapChunk& C
 
 	// Set the relation by trying to find the neighbour in this direction, starting from the given layer-index.
 	// If none is found for the layer, then we get it's parent. If this parent equals the node's parent, then we set the relation to a special 'parent' index.
+	// The parents in another chunk are never the node's own parent, so the search continues up to the root of that chunk.
 	for(layer_idx NeighbourLayerIdx = LayerIdx; NeighbourLayerIdx < Layer::Total; --NeighbourLayerIdx)
 	{
-		if(FRsapNode NeighbourNode; NeighbourChunk->FindNode(NeighbourNode, NeighbourMC, NeighbourLayerIdx, 0))
+		if(FRsapNode* NeighbourNode = NeighbourChunk->FindNode(NeighbourMC, NeighbourLayerIdx, 0))
 		{
-			// Neighbour exists, so set the relations on the node, and the neighbour.
+			// Neighbour exists, so set the relation on the node.
+			// A neighbour in the same layer also has this node as its neighbour, so set the inverse relation on the neighbour itself.
 			Node.Relations.SetFromDirection(Relation, NeighbourLayerIdx);
-			NeighbourNode.Relations.SetFromDirectionInverse(Relation, NeighbourLayerIdx);
+			if(NeighbourLayerIdx == LayerIdx) NeighbourNode->Relations.SetFromDirectionInverse(Relation, LayerIdx);
 			// Also update the relations of the neighbour's children that are against the node.
 			// todo: extra flag argument that tells us if we want to update any children BELOW the node's LayerIdx.
 			// RecursiveSetChildRelations
 			break;
 		}
+		if(NeighbourLayerIdx == Layer::Root)
+		{
+			// The neighbouring chunk has no root.
+			Node.Relations.SetFromDirection(Relation, Layer::Empty);
+			break;
+		}
 
 		// Neighbour not found, so set the morton-code to it's parent, and try again if this is not the same parent as the node.
 		const layer_idx ParentLayerIdx = NeighbourLayerIdx-1;
 		NeighbourMC = FMortonUtils::Node::GetParent(NeighbourMC, ParentLayerIdx);
-		if(NeighbourMC != FMortonUtils::Node::GetParent(NodeMC, ParentLayerIdx)) continue;
+		if(NeighbourChunk != &Chunk || NeighbourMC != FMortonUtils::Node::GetParent(NodeMC, ParentLayerIdx)) continue;
 
 		// Same parent, so set the layer-index to the value indicating that this relation points to out parent.
 		Node.Relations.SetFromDirection(Relation, Layer::Parent);
@@ -1,7 +1,483 @@
 ﻿// Copyright Melvin Brink 2023. All Rights Reserved.
 
-#include "Rsap/NavMesh/Navmesh.h"
+#include "Rsap/NavMesh/Updater.h"
 #include "Rsap/World.h"
+#include "HAL/Event.h"
+#include "HAL/PlatformProcess.h"
+#include "HAL/PlatformTime.h"
+#include <algorithm>
 #include <ranges>
+#include <unordered_set>
 
 
+
+namespace
+{
+	FORCEINLINE double GetDistanceSquared(const FVector& Focus, const chunk_morton ChunkMC)
+	{
+		return FVector::DistSquared(Focus, *FRsapVector32::FromChunkMorton(ChunkMC) + FVector(Chunk::Size / 2.0));
+	}
+}
+
+FRsapNavmeshUpdater::FRsapNavmeshUpdater(FRsapNavmesh& InNavmesh)
+	: Navmesh(&InNavmesh), WorkEvent(FPlatformProcess::GetSynchEventFromPool(false))
+{
+}
+
+FRsapNavmeshUpdater::~FRsapNavmeshUpdater()
+{
+	Stop();
+	FPlatformProcess::ReturnSynchEventToPool(WorkEvent);
+}
+
+void FRsapNavmeshUpdater::Start(const IRsapWorld* InRsapWorld)
+{
+	if(IsRunning()) return;
+	RsapWorld = InRsapWorld;
+	FRsapOverlap::InitCollisionBoxes();
+
+	bStopping = false;
+	Thread = FThread(TEXT("RsapNavmeshUpdater"), [this]{ Run(); }, 0, TPri_BelowNormal);
+	TickerHandle = FTSTicker::GetCoreTicker().AddTicker(FTickerDelegate::CreateRaw(this, &FRsapNavmeshUpdater::Tick));
+	StageOccluders();
+}
+
+void FRsapNavmeshUpdater::Stop()
+{
+	if(!IsRunning()) return;
+	bStopping = true;
+	WorkEvent->Trigger();
+	Thread.Join();
+
+	FTSTicker::GetCoreTicker().RemoveTicker(TickerHandle);
+	TickerHandle.Reset();
+
+	// The thread has stopped, so none of these are shared anymore.
+	for (FInbox& Inbox : Inboxes)
+	{
+		Inbox.Snapshots.clear();
+		Inbox.Nodes.clear();
+		Inbox.bHasOccluders = false;
+		Inbox.OccluderSnapshots.clear();
+		Inbox.ChunkComponents.clear();
+	}
+	DirtyNavmesh.Clear();
+	Snapshots.clear();
+	ChunkComponents.clear();
+	ComponentChunks.clear();
+	Outbox.clear();
+	PublishQueue.clear();
+	PendingComponents.clear();
+	bIsProcessing = false;
+	bHasPublished = false;
+	RsapWorld = nullptr;
+}
+
+void FRsapNavmeshUpdater::Resume()
+{
+	bPaused = false;
+	WorkEvent->Trigger();
+}
+
+bool FRsapNavmeshUpdater::IsUpdating() const
+{
+	if(!PendingComponents.empty()) return true;
+
+	// Checked in the same order as the work moves through the updater, so that work which moves on in-between is not missed.
+	{
+		FScopeLock Lock(&InboxLock);
+		if(!Inboxes[InboxIdx].IsEmpty()) return true;
+	}
+	if(bIsProcessing) return true;
+	{
+		FScopeLock Lock(&OutboxLock);
+		if(!Outbox.empty()) return true;
+	}
+	return !PublishQueue.empty();
+}
+
+// The thread keeps track of the components that occlude each chunk of the previous navmesh, so these are staged again for this one.
+void FRsapNavmeshUpdater::SetNavmesh(FRsapNavmesh& InNavmesh)
+{
+	Navmesh = &InNavmesh;
+	if(IsRunning()) StageOccluders();
+}
+
+void FRsapNavmeshUpdater::SetFocus(const FVector& Location)
+{
+	FScopeLock Lock(&InboxLock);
+	bHasFocus = true;
+	Focus = Location;
+}
+
+void FRsapNavmeshUpdater::StageComponent(const FRsapCollisionComponentChangedResult& ChangedResult)
+{
+	if(!IsRunning()) return;
+
+	// Only the latest change is kept, which is staged on the tick after the component has settled.
+	const double Now = FPlatformTime::Seconds();
+	FPendingComponent& PendingComponent = PendingComponents.try_emplace(ChangedResult.Component, FPendingComponent{ChangedResult.ActorKey, Now, Now}).first->second;
+	PendingComponent.LastChangeTime = Now;
+	if(ChangedResult.Type == ERsapCollisionComponentChangedType::Deleted) PendingComponent.bIsDeleted = true;
+}
+
+void FRsapNavmeshUpdater::StageSettledComponents()
+{
+	if(PendingComponents.empty()) return;
+
+	const double Now = FPlatformTime::Seconds();
+	bool bHasStaged = false;
+	for (auto Iterator = PendingComponents.begin(); Iterator != PendingComponents.end();)
+	{
+		const FPendingComponent& PendingComponent = Iterator->second;
+		const bool bHasSettled = PendingComponent.bIsDeleted || Now - PendingComponent.LastChangeTime >= SettleDelayMs / 1000.0 || Now - PendingComponent.FirstChangeTime >= MaxSettleDelayMs / 1000.0;
+		if(!bHasSettled)
+		{
+			++Iterator;
+			continue;
+		}
+
+		StagePendingComponent(Iterator->first, PendingComponent);
+		Iterator = PendingComponents.erase(Iterator);
+		bHasStaged = true;
+	}
+	if(bHasStaged) WorkEvent->Trigger();
+}
+
+// Stages the nodes the component intersects now, and where it was last rasterized, along with a snapshot of the component.
+// The thread rebuilds the chunks of these nodes as a whole, together with the chunks the component occluded before, and the components that occlude each of them.
+void FRsapNavmeshUpdater::StagePendingComponent(const FRsapCollisionComponentHandle Handle, const FPendingComponent& PendingComponent)
+{
+	// A deleted component is released once its actor syncs again, which could have happened while it was pending.
+	FRsapCollisionComponent* Component = PendingComponent.bIsDeleted ? nullptr : FRsapCollisionComponentRegistry::Get().Find(Handle);
+	const bool bIsDeleted = !Component;
+
+	// A deleted component is staged as an empty one, so that it is removed from the chunks it occluded.
+	FSnapshot Snapshot{PendingComponent.ActorKey, bIsDeleted ? FRsapCollisionComponent() : Component->GetSnapshot()};
+	std::vector<FStagedNode> Nodes;
+	if(!bIsDeleted)
+	{
+		Component->ForEachDirtyNode([&](const chunk_morton ChunkMC, const node_morton NodeMC, const layer_idx LayerIdx)
+		{
+			Nodes.push_back({ChunkMC, NodeMC, LayerIdx, Handle});
+		});
+	}
+
+	// Only held while appending to the inbox, which the thread can only swap in-between.
+	FScopeLock Lock(&InboxLock);
+	FInbox& Inbox = Inboxes[InboxIdx];
+	Inbox.Snapshots.insert_or_assign(Handle, std::move(Snapshot));
+	Inbox.Nodes.insert(Inbox.Nodes.end(), Nodes.begin(), Nodes.end());
+}
+
+// Stages the components that occlude each chunk of the navmesh, which the thread keeps track of from then on.
+// Only done when the navmesh is started on, or swapped in, so that staging a changed component does not have to gather the components around it.
+void FRsapNavmeshUpdater::StageOccluders()
+{
+	FSnapshotMap OccluderSnapshots;
+	FChunkComponentMap OccludedChunkComponents;
+	const FRsapCollisionComponentRegistry& ComponentRegistry = FRsapCollisionComponentRegistry::Get();
+	for (const auto& [ActorKey, RsapActor] : RsapWorld->GetActors())
+	{
+		const std::vector<chunk_morton>* ActorChunkMCs = Navmesh->FindActorChunks(ActorKey);
+		if(!ActorChunkMCs) continue;
+
+		for (const FRsapCollisionComponentHandle Handle : RsapActor->GetCollisionComponents())
+		{
+			const FRsapCollisionComponent* Component = ComponentRegistry.Find(Handle);
+			if(!Component) continue;
+
+			// Only the chunks of the actor that this component intersects.
+			bool bIsOccluding = false;
+			for (const chunk_morton ChunkMC : *ActorChunkMCs)
+			{
+				if(!Component->GetBoundaries().Clamp(FRsapBounds::FromChunkMorton(ChunkMC)).HasVolume()) continue;
+				OccludedChunkComponents[ChunkMC].push_back(Handle);
+				bIsOccluding = true;
+			}
+			if(bIsOccluding) OccluderSnapshots.emplace(Handle, FSnapshot{ActorKey, Component->GetSnapshot()});
+		}
+	}
+
+	{
+		FScopeLock Lock(&InboxLock);
+		FInbox& Inbox = Inboxes[InboxIdx];
+		Inbox.bHasOccluders = true;
+		Inbox.OccluderSnapshots = std::move(OccluderSnapshots);
+		Inbox.ChunkComponents = std::move(OccludedChunkComponents);
+	}
+	WorkEvent->Trigger();
+}
+
+void FRsapNavmeshUpdater::Run()
+{
+	while(!bStopping)
+	{
+		WorkEvent->Wait();
+		while(!bStopping && !bPaused)
+		{
+			FInbox* Inbox;
+			{
+				FScopeLock Lock(&InboxLock);
+				if(Inboxes[InboxIdx].IsEmpty() && DirtyNavmesh.Chunks.empty()) break;
+				bIsProcessing = true;
+				Inbox = &Inboxes[InboxIdx];
+				InboxIdx ^= 1;
+				bThreadHasFocus = bHasFocus;
+				ThreadFocus = Focus;
+			}
+			DrainInbox(*Inbox);
+
+			// A single chunk at a time, so that newly staged components, and a moved focus, are taken into account in-between.
+			if(const auto Iterator = FindNearestDirtyChunk(); Iterator != DirtyNavmesh.Chunks.end())
+			{
+				RebuildChunk(Iterator->first, Iterator->second);
+				DirtyNavmesh.Chunks.erase(Iterator);
+			}
+
+			// Releases the memory once every dirty chunk is rebuilt, which includes the snapshots of the components that do not occlude any chunk.
+			if(DirtyNavmesh.Chunks.empty())
+			{
+				DirtyNavmesh.Clear();
+				for (auto Iterator = Snapshots.begin(); Iterator != Snapshots.end();)
+				{
+					if(ComponentChunks.contains(Iterator->first)) ++Iterator;
+					else Iterator = Snapshots.erase(Iterator);
+				}
+				bIsProcessing = false;
+			}
+		}
+	}
+}
+
+// Marks the staged nodes on the dirty-navmesh, with the components that have made them dirty.
+void FRsapNavmeshUpdater::DrainInbox(FInbox& Inbox)
+{
+	// The nodes are grouped per chunk, so the chunk only has to be looked up when it changes.
+	FRsapDirtyChunk* DirtyChunk = nullptr;
+	chunk_morton DirtyChunkMC = 0;
+	const auto MarkNode = [&](const FStagedNode& StagedNode)
+	{
+		if(!DirtyChunk || StagedNode.ChunkMC != DirtyChunkMC)
+		{
+			DirtyChunk = DirtyNavmesh.FindChunk(StagedNode.ChunkMC);
+			if(!DirtyChunk) DirtyChunk = &DirtyNavmesh.InitChunk(StagedNode.ChunkMC);
+			DirtyChunkMC = StagedNode.ChunkMC;
+		}
+
+		bool bWasInserted;
+		FRsapDirtyNode& DirtyNode = DirtyChunk->TryInitNode(bWasInserted, StagedNode.NodeMC, StagedNode.LayerIdx);
+		if(bWasInserted && StagedNode.LayerIdx > Layer::Root) DirtyChunk->InitNodeParents(StagedNode.NodeMC, StagedNode.LayerIdx);
+
+		DirtyChunk->AddComponent(DirtyNode, StagedNode.NodeMC, StagedNode.LayerIdx, StagedNode.Component);
+	};
+
+	// The occluders of a navmesh that has been swapped in, which any component that is staged along with it is applied onto.
+	if(Inbox.bHasOccluders)
+	{
+		for (auto& [Handle, Snapshot] : Inbox.OccluderSnapshots) Snapshots.insert_or_assign(Handle, std::move(Snapshot));
+		ChunkComponents = std::move(Inbox.ChunkComponents);
+		ComponentChunks.clear();
+		for (const auto& [ChunkMC, Handles] : ChunkComponents)
+		{
+			for (const FRsapCollisionComponentHandle Handle : Handles) ComponentChunks[Handle].push_back(ChunkMC);
+		}
+	}
+
+	// A changed component is staged on the root of the chunks it occluded, so that these are rebuilt without it if it has moved away from them.
+	for (auto& [Handle, Snapshot] : Inbox.Snapshots)
+	{
+		Snapshots.insert_or_assign(Handle, std::move(Snapshot));
+		const auto Iterator = ComponentChunks.find(Handle);
+		if(Iterator == ComponentChunks.end()) continue;
+		for (const chunk_morton ChunkMC : Iterator->second) MarkNode({ChunkMC, 0, Layer::Root, Handle});
+	}
+	for (const FStagedNode& StagedNode : Inbox.Nodes) MarkNode(StagedNode);
+
+	Inbox.Snapshots.clear();
+	Inbox.Nodes.clear();
+	Inbox.bHasOccluders = false;
+	Inbox.OccluderSnapshots.clear();
+	Inbox.ChunkComponents.clear();
+}
+
+// Keeps the reverse in sync, so that the chunks a component occluded can be found when it changes.
+void FRsapNavmeshUpdater::SetChunkComponents(const chunk_morton ChunkMC, std::vector<FRsapCollisionComponentHandle>&& Handles)
+{
+	if(const auto Iterator = ChunkComponents.find(ChunkMC); Iterator != ChunkComponents.end())
+	{
+		for (const FRsapCollisionComponentHandle Handle : Iterator->second)
+		{
+			const auto ChunksIterator = ComponentChunks.find(Handle);
+			if(ChunksIterator == ComponentChunks.end()) continue;
+			std::erase(ChunksIterator->second, ChunkMC);
+			if(ChunksIterator->second.empty()) ComponentChunks.erase(ChunksIterator);
+		}
+		ChunkComponents.erase(Iterator);
+	}
+	if(Handles.empty()) return;
+
+	for (const FRsapCollisionComponentHandle Handle : Handles) ComponentChunks[Handle].push_back(ChunkMC);
+	ChunkComponents.emplace(ChunkMC, std::move(Handles));
+}
+
+// Any dirty chunk when there is no focus.
+FRsapDirtyNavmesh::FChunkMap::iterator FRsapNavmeshUpdater::FindNearestDirtyChunk()
+{
+	if(!bThreadHasFocus) return DirtyNavmesh.Chunks.begin();
+	return std::ranges::min_element(DirtyNavmesh.Chunks, {}, [&](const auto& Pair){ return GetDistanceSquared(ThreadFocus, Pair.first); });
+}
+
+// Rasterizes the chunk from the snapshots of the components on its dirty-nodes, which is handed to the game-thread to be published.
+// The chunk replaces the one in the navmesh as a whole, so it also needs the components that already occlude it.
+void FRsapNavmeshUpdater::RebuildChunk(const chunk_morton ChunkMC, const FRsapDirtyChunk& DirtyChunk)
+{
+	std::unordered_set<FRsapCollisionComponentHandle, FRsapCollisionComponentHandle::FHash> Components;
+	for (layer_idx LayerIdx = 0; LayerIdx < DirtyChunk.Octree->Layers.size(); ++LayerIdx)
+	{
+		for (const auto& [NodeMC, DirtyNode] : *DirtyChunk.Octree->Layers[LayerIdx])
+		{
+			DirtyChunk.ForEachComponent(DirtyNode, NodeMC, LayerIdx, [&](const FRsapCollisionComponentHandle Handle)
+			{
+				Components.insert(Handle);
+			});
+		}
+	}
+	if(const auto Iterator = ChunkComponents.find(ChunkMC); Iterator != ChunkComponents.end()) Components.insert(Iterator->second.begin(), Iterator->second.end());
+
+	FRebuiltChunk RebuiltChunk{ChunkMC};
+	std::vector<FRsapCollisionComponentHandle> OccludingComponents;
+	const FRsapBounds ChunkBounds = FRsapBounds::FromChunkMorton(ChunkMC);
+	for (const FRsapCollisionComponentHandle Handle : Components)
+	{
+		const auto Iterator = Snapshots.find(Handle);
+		if(Iterator == Snapshots.end()) continue;
+		const auto& [ActorKey, Component] = Iterator->second;
+
+		const FRsapBounds Intersection = Component.GetBoundaries().Clamp(ChunkBounds);
+		if(!Intersection.HasVolume()) continue;
+		if(Component.NeedsPhysicsScene())
+		{
+			// Whether it occludes the chunk is only known once it is published, so it is kept track of for as long as it intersects the chunk.
+			RebuiltChunk.PhysicsComponents.push_back({ActorKey, Component, Intersection});
+			OccludingComponents.push_back(Handle);
+			continue;
+		}
+		if(!FRsapNavmesh::RasterizeComponent(RebuiltChunk.Builder, Component, Intersection, ERsapNodeOrder::Morton)) continue;
+		OccludingComponents.push_back(Handle);
+		if(std::ranges::find(RebuiltChunk.OccludingActors, ActorKey) == RebuiltChunk.OccludingActors.end()) RebuiltChunk.OccludingActors.push_back(ActorKey);
+	}
+	SetChunkComponents(ChunkMC, std::move(OccludingComponents));
+
+	FScopeLock Lock(&OutboxLock);
+	Outbox.push_back(std::move(RebuiltChunk));
+}
+
+bool FRsapNavmeshUpdater::Tick(float DeltaTime)
+{
+	StageSettledComponents();
+	if(bPaused) return true;
+
+	// A chunk that has been rebuilt again replaces the earlier rebuild, so that the queue can be published in any order.
+	{
+		FScopeLock Lock(&OutboxLock);
+		for (FRebuiltChunk& RebuiltChunk : Outbox)
+		{
+			const auto Iterator = std::ranges::find(PublishQueue, RebuiltChunk.ChunkMC, &FRebuiltChunk::ChunkMC);
+			if(Iterator != PublishQueue.end()) *Iterator = std::move(RebuiltChunk);
+			else PublishQueue.push_back(std::move(RebuiltChunk));
+		}
+		Outbox.clear();
+	}
+
+	// The nearest chunks first, of which the ones within the immediate-radius are published regardless of the budget.
+	FVector TickFocus = FVector::ZeroVector;
+	bool bTickHasFocus;
+	{
+		FScopeLock Lock(&InboxLock);
+		TickFocus = Focus;
+		bTickHasFocus = bHasFocus;
+	}
+	if(bTickHasFocus) std::ranges::sort(PublishQueue, {}, [&](const FRebuiltChunk& RebuiltChunk){ return GetDistanceSquared(TickFocus, RebuiltChunk.ChunkMC); });
+
+	const double ImmediateRadiusSquared = bTickHasFocus ? FMath::Square(static_cast<double>(ImmediateRadius)) : -1.0;
+	const double Deadline = FPlatformTime::Seconds() + PublishBudgetMs / 1000.0;
+	size_t PublishedCount = 0;
+	while(PublishedCount < PublishQueue.size())
+	{
+		const bool bIsImmediate = GetDistanceSquared(TickFocus, PublishQueue[PublishedCount].ChunkMC) <= ImmediateRadiusSquared;
+		if(!bIsImmediate && PublishedCount > 0 && FPlatformTime::Seconds() >= Deadline) break;
+		PublishChunk(PublishQueue[PublishedCount++]);
+		bHasPublished = true;
+	}
+	PublishQueue.erase(PublishQueue.begin(), PublishQueue.begin() + PublishedCount);
+
+	if(IsUpdating()) return true;
+
+	if(bHasPublished)
+	{
+		bHasPublished = false;
+		OnUpdateComplete.Broadcast();
+	}
+	return true;
+}
+
+// Replaces the chunk in the navmesh with the rebuilt one, and stitches the borders of the chunks around it again.
+void FRsapNavmeshUpdater::PublishChunk(FRebuiltChunk& RebuiltChunk) const
+{
+	FRsapNavmesh& NavMesh = *Navmesh;
+	const chunk_morton ChunkMC = RebuiltChunk.ChunkMC;
+
+	// The components that could not be rasterized on the thread, because they are tested against the physics-scene.
+	for (const auto& [ActorKey, Component, Intersection] : RebuiltChunk.PhysicsComponents)
+	{
+		if(!FRsapNavmesh::RasterizeComponent(RebuiltChunk.Builder, Component, Intersection, ERsapNodeOrder::Morton)) continue;
+		if(std::ranges::find(RebuiltChunk.OccludingActors, ActorKey) == RebuiltChunk.OccludingActors.end()) RebuiltChunk.OccludingActors.push_back(ActorKey);
+	}
+
+	std::vector<actor_key> PreviousActors;
+	if(const FRsapChunk* Chunk = NavMesh.FindChunk(ChunkMC))
+	{
+		for (const actor_key ActorKey : *Chunk->ActorEntries | std::views::keys) PreviousActors.push_back(ActorKey);
+	}
+	NavMesh.EraseChunk(ChunkMC);
+
+	if(!RebuiltChunk.OccludingActors.empty())
+	{
+		FRsapChunk& Chunk = NavMesh.InitChunk(ChunkMC);
+		for (const actor_key ActorKey : RebuiltChunk.OccludingActors)
+		{
+			// An actor that has been removed in the meantime has also made this chunk dirty again.
+			const auto Iterator = RsapWorld->GetActors().find(ActorKey);
+			if(Iterator == RsapWorld->GetActors().end()) continue;
+
+			const uint64 CollisionHash = Iterator->second->GetCollisionHash();
+			NavMesh.ActorHashes.insert_or_assign(ActorKey, CollisionHash);
+			NavMesh.AddActorEntry(Chunk, ChunkMC, ActorKey, CollisionHash);
+		}
+		RebuiltChunk.Builder.Build(*Chunk.Octrees[Node::State::Static]);
+		Chunk.InvalidateLinearOctree();
+		NavMesh.SetChunkRelations(Chunk, ChunkMC, false);
+		NavMesh.SetChunkRelations(Chunk, ChunkMC, true);
+
+		NavMesh.DeletedChunkMCs.erase(ChunkMC);
+		NavMesh.UpdatedChunkMCs.insert(ChunkMC);
+	}
+	else
+	{
+		NavMesh.UpdatedChunkMCs.erase(ChunkMC);
+		NavMesh.DeletedChunkMCs.insert(ChunkMC);
+	}
+
+	for (const rsap_direction Direction : Direction::List)
+	{
+		const chunk_morton NeighbourChunkMC = FMortonUtils::Chunk::GetNeighbour(ChunkMC, Direction);
+		if(const FRsapChunk* NeighbourChunk = NavMesh.FindChunk(NeighbourChunkMC)) NavMesh.SetChunkRelations(*NeighbourChunk, NeighbourChunkMC, true);
+	}
+
+	// The actors that have been removed from the world are not needed anymore once they do not occlude any chunk.
+	for (const actor_key ActorKey : PreviousActors)
+	{
+		if(!NavMesh.FindActorChunks(ActorKey) && !RsapWorld->GetActors().contains(ActorKey)) NavMesh.ActorHashes.erase(ActorKey);
+	}
+}
\ No newline at end of file
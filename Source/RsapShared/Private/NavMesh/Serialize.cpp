@@ -1,10 +1,14 @@
 ﻿// Copyright Melvin Brink 2023. All Rights Reserved.
 
+#include <algorithm>
 #include <unordered_set>
 #include "Rsap/NavMesh/Navmesh.h"
 #include "Rsap/NavMesh/Types/Chunk.h"
+#include "Rsap/NavMesh/Types/LinearOctree.h"
 #include "Rsap/NavMesh/Types/Node.h"
 #include "Rsap/World.h"
+#include "HAL/FileManager.h"
+#include "Misc/Paths.h"
 
 
 
@@ -75,21 +79,22 @@ inline FArchive& operator<<(FArchive& Ar, FRsapLeafLayer& LeafNodes)
 	return Ar;
 }
 
-// Serializes the actor-entries which are used when a deserialized chunk is found to be out-of-sync.
-inline FArchive& operator<<(FArchive& Ar, Rsap::Map::flat_map<actor_key, FGuid>& ActorEntries)
+// Serializes the collision-hash of each actor. Used for the actor-entries of the chunks, and for all the actors the navmesh is in-sync with.
+template<typename ActorHashMap>
+FArchive& SerializeActorHashes(FArchive& Ar, ActorHashMap& ActorHashes)
 {
-	size_t Size = ActorEntries.size();
+	size_t Size = ActorHashes.size();
 	Ar << Size;
 	
 	if(Ar.IsSaving())
 	{
-		for (const auto& [Key, ID] : ActorEntries)
+		for (const auto& [Key, Hash] : ActorHashes)
 		{
 			actor_key ActorKey = Key;
-			FGuid Guid = ID;
+			uint64 CollisionHash = Hash;
 			
 			Ar << ActorKey;
-			Ar << Guid;
+			Ar << CollisionHash;
 		}
 	}
 	else if (Ar.IsLoading())
@@ -97,20 +102,64 @@ inline FArchive& operator<<(FArchive& Ar, Rsap::Map::flat_map<actor_key, FGuid>&
 		for(size_t i = 0; i < Size; ++i)
 		{
 			actor_key ActorKey;
-			FGuid Guid;
+			uint64 CollisionHash;
+			
+			Ar << ActorKey;
+			Ar << CollisionHash;
+			
+			ActorHashes.emplace(ActorKey, CollisionHash);
+		}
+	}
+
+	return Ar;
+}
+
+// Serializes the chunks that each actor occludes.
+inline FArchive& SerializeActorChunks(FArchive& Ar, Rsap::Map::flat_map<actor_key, std::vector<chunk_morton>>& ActorChunks)
+{
+	size_t Size = ActorChunks.size();
+	Ar << Size;
+	
+	if(Ar.IsSaving())
+	{
+		for (auto& [Key, ChunkMCs] : ActorChunks)
+		{
+			actor_key ActorKey = Key;
+			uint32 ChunkCount = static_cast<uint32>(ChunkMCs.size());
 			
 			Ar << ActorKey;
-			Ar << Guid;
+			Ar << ChunkCount;
+			for (chunk_morton ChunkMC : ChunkMCs) Ar << ChunkMC;
+		}
+	}
+	else if (Ar.IsLoading())
+	{
+		for(size_t i = 0; i < Size; ++i)
+		{
+			actor_key ActorKey;
+			uint32 ChunkCount;
 			
-			ActorEntries.emplace(ActorKey, Guid);
+			Ar << ActorKey;
+			Ar << ChunkCount;
+
+			std::vector<chunk_morton>& ChunkMCs = ActorChunks[ActorKey];
+			ChunkMCs.resize(ChunkCount);
+			for (chunk_morton& ChunkMC : ChunkMCs) Ar << ChunkMC;
 		}
 	}
 
 	return Ar;
 }
 
-inline void SaveNodes(std::vector<uint8>& Batch, const FRsapChunk& Chunk, const FRsapNode& Node, const node_morton NodeMC, const layer_idx LayerIdx)
+// Serializes the actor-entries which are used when a deserialized chunk is found to be out-of-sync.
+inline FArchive& operator<<(FArchive& Ar, FRsapChunk::FActorEntries& ActorEntries)
 {
+	return SerializeActorHashes(Ar, ActorEntries);
+}
+
+inline void SaveNodes(std::vector<uint8>& Batch, const FRsapLinearOctree& Octree, const uint32 NodeIdx, const layer_idx LayerIdx)
+{
+	const FRsapLinearNode& Node = Octree.Nodes[NodeIdx];
 	Batch.push_back(Node.Children);
 
 	// Leaf nodes are not serialized.
@@ -119,14 +168,12 @@ inline void SaveNodes(std::vector<uint8>& Batch, const FRsapChunk& Chunk, const
 		return;
 	}
 
-	for (const uint8 ChildMask : Node::Children::Masks)
+	// The children are stored next to each other in child-order.
+	const layer_idx ChildLayerIdx = LayerIdx+1;
+	const uint32 ChildCount = Node.GetChildCount();
+	for (uint32 ChildOffset = 0; ChildOffset < ChildCount; ++ChildOffset)
 	{
-		if(!(Node.Children & ChildMask)) continue;
-
-		const layer_idx ChildLayerIdx = LayerIdx+1;
-		const node_morton ChildNodeMC = FMortonUtils::Node::GetChildMCFromMask(NodeMC, ChildMask, ChildLayerIdx);
-		const FRsapNode& ChildNode = Chunk.GetNode(ChildNodeMC, ChildLayerIdx, 0);
-		SaveNodes(Batch, Chunk, ChildNode, ChildNodeMC, ChildLayerIdx);
+		SaveNodes(Batch, Octree, Node.FirstChild + ChildOffset, ChildLayerIdx);
 	}
 }
 
@@ -142,16 +189,16 @@ void SaveStaticOctree(FArchive& ChunkAr, const FRsapChunk& Chunk)
 	// for (uint8& Byte : TestArray) Byte = 0xFF; // Fill with sample data
 	// ChunkAr.Serialize(TestArray.GetData(), TestArray.Num());
 
-	// todo: this could just loop through the layers instead if everything is sorted, maybe preprocessor '#if WITH_EDITOR'
-	// todo: then put it around this method and SaveNodes, and the #else has its own SaveStaticOctree that just loops.
+	// The linear-octree has the children of a node stored contiguously, so the recursion below won't need any map lookups.
+	const FRsapLinearOctree& Octree = Chunk.GetLinearOctree();
+	if(Octree.IsEmpty()) return;
 
 	std::vector<uint8> Batch;
-	Batch.reserve(Chunk.GetStaticNodeCount());
+	Batch.reserve(Octree.Nodes.size());
 	
-	constexpr layer_idx RootNodeMC = 0;
-	const FRsapNode& RootNode = Chunk.Octrees[0]->Layers[0]->find(RootNodeMC)->second;
+	constexpr uint32 RootNodeIdx = 0;
 	constexpr layer_idx RootLayerIdx = 0;
-	SaveNodes(Batch, Chunk, RootNode, RootNodeMC, RootLayerIdx);
+	SaveNodes(Batch, Octree, RootNodeIdx, RootLayerIdx);
 
 	ChunkAr.Serialize(Batch.data(), Batch.size());
 }
@@ -183,6 +230,14 @@ void LoadStaticOctree(FArchive& ChunkAr, const FRsapChunk& Chunk)
 	constexpr node_morton RootNodeMC = 0;
 	constexpr layer_idx RootLayerIdx = 0;
 	LoadNodes(ChunkAr, Chunk, RootNodeMC, RootLayerIdx);
+	Chunk.InvalidateLinearOctree();
+
+#if !WITH_EDITOR
+	// In-game the layers are sorted arrays. The nodes are loaded depth-first in child-order, which is ascending morton-order within every layer, so each node has been appended.
+	// The layers won't grow after this, so release the excess capacity.
+	for (const auto& Layer : Chunk.Octrees[0]->Layers) Layer->shrink_to_fit();
+	Chunk.Octrees[0]->LeafNodes->shrink_to_fit();
+#endif
 }
 
 // Serializes an FRsapChunk.
@@ -215,134 +270,180 @@ inline FString GetChunkDirectory(const FString& LevelPath, const chunk_morton Ch
 	return PathBuilder.ToString();
 }
 
-inline void SerializeChunk(const FRsapChunk& Chunk, const chunk_morton ChunkMC, FGuid* ChunkID, const FString& NavmeshFolderPath)
+// Returns the path of the chunk's binary file.
+inline FString GetChunkFilePath(const FString& NavmeshPath, const chunk_morton ChunkMC)
+{
+	return GetChunkDirectory(NavmeshPath, ChunkMC) / FString::Printf(TEXT("%llu.bin"), ChunkMC & 0b111111);
+}
+
+// Gets the chunk's morton-code from the path of its binary file, see ::GetChunkFilePath. Returns false if the file is not a chunk.
+inline bool GetChunkMortonFromFilePath(const FString& ChunkFilePath, chunk_morton& OutChunkMC)
+{
+	const FString GroupDirectory = FPaths::GetCleanFilename(FPaths::GetPath(ChunkFilePath));
+	const FString FileName = FPaths::GetBaseFilename(ChunkFilePath);
+	if(!GroupDirectory.IsNumeric() || !FileName.IsNumeric()) return false;
+	OutChunkMC = FCString::Strtoui64(*GroupDirectory, nullptr, 10) << 6 | FCString::Strtoui64(*FileName, nullptr, 10);
+	return true;
+}
+
+inline void SerializeChunk(const FRsapChunk& Chunk, const chunk_morton ChunkMC, const FString& NavmeshFolderPath)
 {
 	const FString ChunkDirectory = GetChunkDirectory(NavmeshFolderPath, ChunkMC);
 	if (!IFileManager::Get().DirectoryExists(*ChunkDirectory)) IFileManager::Get().MakeDirectory(*ChunkDirectory, true);
 
-	const FString ChunkFilePath = ChunkDirectory / FString::Printf(TEXT("%llu.bin"), ChunkMC & 0b111111);
-	FArchive* ChunkAr = IFileManager::Get().CreateFileWriter(*ChunkFilePath);
+	FArchive* ChunkAr = IFileManager::Get().CreateFileWriter(*GetChunkFilePath(NavmeshFolderPath, ChunkMC));
+	if(!ChunkAr) return;
 
 	// Serialize the chunk.
-	*ChunkAr << *ChunkID;
 	*ChunkAr << Chunk;
 		
 	ChunkAr->Close();
 	delete ChunkAr;
 }
 
-// Returns the path where the navmesh's chunk binary files are stored.
-// inline FString GetNavmeshBinaryPath(const URsapNavmeshMetadata* NavmeshMetadata)
-// {
-// 	const FString BasePath = FPaths::ProjectDir() / TEXT("Rsap");
-// 	const FString NavmeshPath = BasePath / NavmeshMetadata->ID.ToString();
-// 	return NavmeshPath;
-// }
+// Returns the path where the navmesh's binary files are stored, which follows the path of the map's package.
+inline FString GetNavmeshBinaryPath(const UWorld* World)
+{
+	return FPaths::ProjectDir() / TEXT("Rsap") + World->GetOutermost()->GetName();
+}
+
+// Returns the path of the file holding the collision-hash of every actor the navmesh is in-sync with.
+inline FString GetActorsFilePath(const FString& NavmeshPath)
+{
+	return NavmeshPath / TEXT("Actors.bin");
+}
 
 FRsapNavmeshLoadResult FRsapNavmesh::Load(const IRsapWorld* RsapWorld)
 {
-	return { ERsapNavmeshLoadResult::NotFound };
-	// Chunks.clear();
-	//
-	// // Load the metadata and try to locate the binaries.
-	// Metadata = URsapNavmeshMetadata::Load(RsapWorld->GetWorld());
-	// const FString NavmeshPath = GetNavmeshBinaryPath(Metadata);
-	// if(!IFileManager::Get().DirectoryExists(*NavmeshPath)) return { ERsapNavmeshLoadResult::NotFound };
-	//
-	// // Loop through the chunks within the metadata to locate each chunk binary.
-	// // Check if these chunks are in-sync by comparing the serialized ID with the ID stored on the metadata.
-	// std::vector<chunk_morton> MismatchedChunks;
-	// for (const auto& Pair : Metadata->Chunks)
-	// {
-	// 	const chunk_morton ChunkMC = Pair.Key;
-	// 	const FGuid ChunkID = Pair.Value;
-	//
-	// 	FString ChunkDirectory = GetChunkDirectory(NavmeshPath, ChunkMC);
-	// 	const FString ChunkFilePath = ChunkDirectory / FString::Printf(TEXT("%llu.bin"), ChunkMC & 0b111111);
-	//
-	// 	// Regen chunk if it's binary file does not exist.
-	// 	if (!IFileManager::Get().FileExists(*ChunkFilePath))
-	// 	{
-	// 		MismatchedChunks.emplace_back(ChunkMC);
-	// 		continue;
-	// 	}
-	//
-	// 	// Start reading the binary file.
-	// 	FArchive* ChunkFileArchive = IFileManager::Get().CreateFileReader(*ChunkFilePath);
-	// 	if (!ChunkFileArchive)
-	// 	{
-	// 		MismatchedChunks.emplace_back(ChunkMC);
-	// 		continue;
-	// 	}
-	//
-	// 	// todo: If out-of-sync, then read all the serialized actors, and pass it to a separate method that returns a new list of actors which are the ones out-of-sync.
-	// 	// todo: If in-sync, then skip the actors using FArchive.
-	// 	// Get the serialized chunk ID. If there is a mismatch, then it's out-of-sync.
-	// 	FGuid StoredChunkID; *ChunkFileArchive << StoredChunkID;
-	// 	if (StoredChunkID != ChunkID)
-	// 	{
-	// 		MismatchedChunks.emplace_back(ChunkMC);
-	// 		ChunkFileArchive->Close();
-	// 		delete ChunkFileArchive;
-	// 		continue;
-	// 	}
-	//
-	// 	// Deserialize the chunk, and add it to the navmesh.
-	// 	FRsapChunk StoredChunk; *ChunkFileArchive << StoredChunk;
-	// 	Chunks.emplace(ChunkMC, std::move(StoredChunk));
-	//
-	// 	ChunkFileArchive->Close();
-	// 	delete ChunkFileArchive;
-	// }
-	//
-	// if(MismatchedChunks.size()) return { ERsapNavmeshLoadResult::MisMatch, FRsapActorMap() };
-	// return { ERsapNavmeshLoadResult::Success };
+	Clear();
+	UpdatedChunkMCs.clear();
+	DeletedChunkMCs.clear();
+	bRegenerated = false;
+	if(!RsapWorld->GetWorld()) return { ERsapNavmeshLoadResult::NotFound };
+
+	// None of the chunks can be checked without the actors the navmesh was in-sync with when it was saved.
+	const FString NavmeshPath = GetNavmeshBinaryPath(RsapWorld->GetWorld());
+	FArchive* ActorsAr = IFileManager::Get().CreateFileReader(*GetActorsFilePath(NavmeshPath));
+	if(!ActorsAr) return { ERsapNavmeshLoadResult::NotFound };
+	Rsap::Map::flat_map<actor_key, uint64> SavedActorHashes;
+	Rsap::Map::flat_map<actor_key, std::vector<chunk_morton>> SavedActorChunks;
+	SerializeActorHashes(*ActorsAr, SavedActorHashes);
+	SerializeActorChunks(*ActorsAr, SavedActorChunks);
+	ActorsAr->Close();
+	delete ActorsAr;
+
+	// Any actor that has changed or has been added makes the chunks it currently intersects out-of-sync.
+	// The navmesh is only in-sync with the unchanged actors for now, and with the changed ones that do not intersect any chunk.
+	std::unordered_set<chunk_morton> MismatchedChunkMCs;
+	std::vector<std::pair<actor_key, uint64>> NonIntersectingActors;
+	const FRsapCollisionComponentRegistry& ComponentRegistry = FRsapCollisionComponentRegistry::Get();
+	for (const auto& [ActorKey, RsapActor] : RsapWorld->GetActors())
+	{
+		const uint64 CollisionHash = RsapActor->GetCollisionHash();
+		if(const auto Iterator = SavedActorHashes.find(ActorKey); Iterator != SavedActorHashes.end() && Iterator->second == CollisionHash)
+		{
+			ActorHashes.emplace(ActorKey, CollisionHash);
+			continue;
+		}
+
+		bool bIntersectsChunk = false;
+		for (const FRsapCollisionComponentHandle ComponentHandle : RsapActor->GetCollisionComponents())
+		{
+			const FRsapCollisionComponent* CollisionComponent = ComponentRegistry.Find(ComponentHandle);
+			if(!CollisionComponent) continue;
+			CollisionComponent->GetBoundaries().ForEachChunk([&](const chunk_morton ChunkMC, const FRsapVector32&, const FRsapBounds&)
+			{
+				MismatchedChunkMCs.insert(ChunkMC);
+				bIntersectsChunk = true;
+			});
+		}
+		if(!bIntersectsChunk) NonIntersectingActors.emplace_back(ActorKey, CollisionHash);
+	}
+
+	// Any actor that has changed or has been removed makes the chunks it occluded out-of-sync, which are found without reading any of the chunks.
+	for (const auto& [ActorKey, ActorChunkMCs] : SavedActorChunks)
+	{
+		if(ActorHashes.contains(ActorKey)) continue;
+		MismatchedChunkMCs.insert(ActorChunkMCs.begin(), ActorChunkMCs.end());
+	}
+
+	// The unchanged actors that occlude any of the out-of-sync chunks are in-sync again once these are regenerated, see FRsapGenerationJob.
+	for (const auto& [ActorKey, ActorChunkMCs] : SavedActorChunks)
+	{
+		if(std::ranges::any_of(ActorChunkMCs, [&](const chunk_morton ChunkMC){ return MismatchedChunkMCs.contains(ChunkMC); })) ActorHashes.erase(ActorKey);
+	}
+	for (const auto& [ActorKey, CollisionHash] : NonIntersectingActors) ActorHashes.emplace(ActorKey, CollisionHash);
+
+	// Load the chunks that are in-sync, which are the ones whose occluding actors are all unchanged.
+	TArray<FString> ChunkFilePaths;
+	IFileManager::Get().FindFilesRecursive(ChunkFilePaths, *NavmeshPath, TEXT("*.bin"), true, false);
+	Rsap::Map::flat_map<actor_key, uint64> ActorEntries;
+	for (const FString& ChunkFilePath : ChunkFilePaths)
+	{
+		chunk_morton ChunkMC;
+		if(!GetChunkMortonFromFilePath(ChunkFilePath, ChunkMC) || MismatchedChunkMCs.contains(ChunkMC)) continue;
+
+		FArchive* ChunkAr = IFileManager::Get().CreateFileReader(*ChunkFilePath);
+		if(!ChunkAr)
+		{
+			MismatchedChunkMCs.insert(ChunkMC);
+			continue;
+		}
+
+		ActorEntries.clear();
+		SerializeActorHashes(*ChunkAr, ActorEntries);
+		FRsapChunk& Chunk = InitChunk(ChunkMC);
+		for (const auto& [ActorKey, CollisionHash] : ActorEntries) AddActorEntry(Chunk, ChunkMC, ActorKey, CollisionHash);
+		LoadStaticOctree(*ChunkAr, Chunk);
+
+		ChunkAr->Close();
+		delete ChunkAr;
+	}
+
+	// Only the children are serialized, so the relations are set once all the chunks are loaded.
+	for (const auto& [ChunkMC, Chunk] : Chunks) SetChunkRelations(Chunk, ChunkMC, false);
+	for (const auto& [ChunkMC, Chunk] : Chunks) SetChunkRelations(Chunk, ChunkMC, true);
+
+	if(MismatchedChunkMCs.empty()) return { ERsapNavmeshLoadResult::Success };
+	return { ERsapNavmeshLoadResult::MisMatch, std::vector<chunk_morton>(MismatchedChunkMCs.begin(), MismatchedChunkMCs.end()) };
 }
 
-void FRsapNavmesh::Save()
+void FRsapNavmesh::Save(const IRsapWorld* RsapWorld)
 {
-	// const FString NavmeshPath = GetNavmeshBinaryPath(Metadata);
-	//
-	// // Note: The chunk IDs on the metadata should exactly correspond to the chunks on the navmesh,
-	// // as they are set from the result of a generation or an update.
-	//
-	// // If the navmesh is fully regenerated, then all chunks should be serialized.
-	// // Else, only serialize the chunks that have been recently updated, and remove binaries of deleted chunks.
-	//
-	// //if(bRegenerated) todo: set this back when done testing
-	// if(true)
-	// {
-	// 	// Clear the previous binaries
-	// 	IFileManager::Get().DeleteDirectory(*NavmeshPath, false, true);
-	//
-	// 	// Serialize all the chunks.
-	// 	for (const auto& [ChunkMC, Chunk] : Chunks)
-	// 	{
-	// 		SerializeChunk(Chunk, ChunkMC, Metadata->Chunks.Find(ChunkMC), NavmeshPath);
-	// 	}
-	//
-	// 	// Set regenerated to false to start keep track of newly updated chunks, and serialize only those after the next save.
-	// 	bRegenerated = false;
-	// }
-	// else
-	// {
-	// 	for (const chunk_morton ChunkMC : UpdatedChunkMCs)
-	// 	{
-	// 		const FRsapChunk& Chunk = Chunks.find(ChunkMC)->second;
-	// 		SerializeChunk(Chunk, ChunkMC, Metadata->Chunks.Find(ChunkMC), NavmeshPath);
-	// 	}
-	//
-	// 	for (const chunk_morton ChunkMC : DeletedChunkMCs)
-	// 	{
-	// 		FString ChunkDirectory = GetChunkDirectory(NavmeshPath, ChunkMC);
-	// 		const FString ChunkFilePath = ChunkDirectory / FString::Printf(TEXT("%llu.bin"), ChunkMC & 0b111111);
-	// 		IFileManager::Get().Delete(*ChunkFilePath);
-	// 		Metadata->Chunks.Remove(ChunkMC);
-	// 	}
-	//
-	// 	UpdatedChunkMCs.clear();
-	// 	DeletedChunkMCs.clear();
-	// 	
-	// 	// todo: check if UpdatedChunks is empty.
-	// }
+	if(!RsapWorld->GetWorld()) return;
+	const FString NavmeshPath = GetNavmeshBinaryPath(RsapWorld->GetWorld());
+
+	// If the navmesh is fully regenerated, then all chunks should be serialized.
+	// Else, only serialize the chunks that have been updated since the last save, and remove the binaries of the deleted chunks.
+	if(bRegenerated || !IFileManager::Get().DirectoryExists(*NavmeshPath))
+	{
+		// Clear the previous binaries
+		IFileManager::Get().DeleteDirectory(*NavmeshPath, false, true);
+		for (const auto& [ChunkMC, Chunk] : Chunks) SerializeChunk(Chunk, ChunkMC, NavmeshPath);
+
+		// Set regenerated to false to start keep track of newly updated chunks, and serialize only those after the next save.
+		bRegenerated = false;
+	}
+	else
+	{
+		for (const chunk_morton ChunkMC : UpdatedChunkMCs)
+		{
+			if(const FRsapChunk* Chunk = FindChunk(ChunkMC)) SerializeChunk(*Chunk, ChunkMC, NavmeshPath);
+		}
+		for (const chunk_morton ChunkMC : DeletedChunkMCs)
+		{
+			IFileManager::Get().Delete(*GetChunkFilePath(NavmeshPath, ChunkMC));
+		}
+	}
+	UpdatedChunkMCs.clear();
+	DeletedChunkMCs.clear();
+
+	// The actors are saved every time, since any change to the navmesh also changes the actors it is in-sync with.
+	if(!IFileManager::Get().DirectoryExists(*NavmeshPath)) IFileManager::Get().MakeDirectory(*NavmeshPath, true);
+	FArchive* ActorsAr = IFileManager::Get().CreateFileWriter(*GetActorsFilePath(NavmeshPath));
+	if(!ActorsAr) return;
+	SerializeActorHashes(*ActorsAr, ActorHashes);
+	SerializeActorChunks(*ActorsAr, ActorChunks);
+	ActorsAr->Close();
+	delete ActorsAr;
 }
\ No newline at end of file
@@ -0,0 +1,12 @@
+﻿// Copyright Melvin Brink 2023. All Rights Reserved.
+
+#include "Rsap/NavMesh/Types/Actor.h"
+
+
+
+// Defined here so that every module shares the same registry.
+FRsapCollisionComponentRegistry& FRsapCollisionComponentRegistry::Get()
+{
+	static FRsapCollisionComponentRegistry Registry;
+	return Registry;
+}
@@ -0,0 +1,31 @@
+﻿// Copyright Melvin Brink 2023. All Rights Reserved.
+
+#include "Rsap/NavMesh/Types/Chunk.h"
+#include "Rsap/NavMesh/Types/LinearOctree.h"
+
+
+
+FRsapChunk::~FRsapChunk()
+{
+	std::pmr::polymorphic_allocator<> Allocator(Resource);
+	if(Octrees[Node::State::Static]) Allocator.delete_object(Octrees[Node::State::Static]);
+	if(Octrees[Node::State::Dynamic]) ReleaseDynamicOctree();
+	if(ActorEntries) Allocator.delete_object(ActorEntries);
+	if(LinearOctree) Allocator.delete_object(LinearOctree);
+}
+
+const FRsapLinearOctree& FRsapChunk::GetLinearOctree() const
+{
+	if(!LinearOctree) LinearOctree = std::pmr::polymorphic_allocator<>(Resource).new_object<FRsapLinearOctree>(Resource);
+	if(bLinearOctreeOutdated)
+	{
+		LinearOctree->Build(*Octrees[Node::State::Static]);
+		bLinearOctreeOutdated = false;
+	}
+	return *LinearOctree;
+}
+
+size_t FRsapChunk::GetLinearOctreeAllocatedSize() const
+{
+	return LinearOctree ? sizeof(FRsapLinearOctree) + LinearOctree->GetAllocatedSize() : 0;
+}
@@ -2,12 +2,17 @@
 
 #include "Rsap/SharedModule.h"
 #include "Rsap/Definitions.h"
+#include "Rsap/Math/Morton.h"
 
 #define LOCTEXT_NAMESPACE "FRsapGameModule"
 
 
 
-void FRsapSharedModule::StartupModule() {}
+void FRsapSharedModule::StartupModule()
+{
+	FMortonUtils::InitializeDispatch();
+}
+
 void FRsapSharedModule::ShutdownModule() {}
 
 
@@ -0,0 +1,114 @@
+﻿// Copyright Melvin Brink 2023. All Rights Reserved.
+
+#pragma once
+#include <memory_resource>
+
+
+
+/**
+ * Statistics of an arena, used for the memory-usage report.
+ */
+struct FRsapArenaStats
+{
+	size_t BytesReserved = 0;		// Memory requested from the system, which includes the pool's unused slots.
+	size_t BytesInUse = 0;			// Memory currently handed out to containers.
+	size_t BlockCount = 0;			// Amount of blocks requested from the system.
+	size_t LiveAllocations = 0;		// Allocations that have not been deallocated yet.
+	size_t TotalAllocations = 0;	// Allocations since the last release.
+
+	// Fraction of the reserved memory that is not in use.
+	FORCEINLINE double GetFragmentation() const
+	{
+		return BytesReserved ? 1.0 - static_cast<double>(BytesInUse) / static_cast<double>(BytesReserved) : 0.0;
+	}
+};
+
+/**
+ * Memory-resource that every chunk of a navmesh allocates from, including the octrees, the layer-maps and their nodes.
+ *
+ * Small allocations are served from size-class pools, which are carved out of large blocks.
+ * Freed slots are reused by the pool, so updating the navmesh in the editor does not grow the arena.
+ * Everything is freed at once on ::Release, without visiting the individual allocations.
+ *
+ * Not thread-safe.
+ */
+class FRsapArena final : public std::pmr::memory_resource
+{
+	// Requests the blocks from the system, and keeps track of how much is reserved.
+	class FUpstream final : public std::pmr::memory_resource
+	{
+	public:
+		size_t BytesReserved = 0;
+		size_t BlockCount = 0;
+
+	private:
+		virtual void* do_allocate(const size_t Bytes, const size_t Alignment) override
+		{
+			BytesReserved += Bytes;
+			++BlockCount;
+			return std::pmr::new_delete_resource()->allocate(Bytes, Alignment);
+		}
+
+		virtual void do_deallocate(void* Pointer, const size_t Bytes, const size_t Alignment) override
+		{
+			BytesReserved -= Bytes;
+			--BlockCount;
+			std::pmr::new_delete_resource()->deallocate(Pointer, Bytes, Alignment);
+		}
+
+		virtual bool do_is_equal(const memory_resource& Other) const noexcept override
+		{
+			return this == &Other;
+		}
+	};
+
+	static inline constexpr size_t MaxBlocksPerChunk = 256;
+	static inline constexpr size_t LargestPooledSize = 4096; // Larger allocations, like the arrays of a sorted-map, go straight to the upstream.
+
+	FUpstream Upstream;
+	std::pmr::unsynchronized_pool_resource Pool{std::pmr::pool_options{MaxBlocksPerChunk, LargestPooledSize}, &Upstream};
+
+	size_t BytesInUse = 0;
+	size_t LiveAllocations = 0;
+	size_t TotalAllocations = 0;
+
+public:
+	FRsapArena() = default;
+	FRsapArena(const FRsapArena&) = delete;
+	FRsapArena& operator=(const FRsapArena&) = delete;
+
+	// Frees all the memory at once. Anything that still points into the arena is dangling after this.
+	void Release()
+	{
+		Pool.release();
+		BytesInUse = 0;
+		LiveAllocations = 0;
+		TotalAllocations = 0;
+	}
+
+	FRsapArenaStats GetStats() const
+	{
+		return { Upstream.BytesReserved, BytesInUse, Upstream.BlockCount, LiveAllocations, TotalAllocations };
+	}
+
+private:
+	virtual void* do_allocate(const size_t Bytes, const size_t Alignment) override
+	{
+		BytesInUse += Bytes;
+		++LiveAllocations;
+		++TotalAllocations;
+		return Pool.allocate(Bytes, Alignment);
+	}
+
+	virtual void do_deallocate(void* Pointer, const size_t Bytes, const size_t Alignment) override
+	{
+		BytesInUse -= Bytes;
+		--LiveAllocations;
+		Pool.deallocate(Pointer, Bytes, Alignment);
+	}
+
+	virtual bool do_is_equal(const memory_resource& Other) const noexcept override
+	{
+		return this == &Other;
+	}
+};
@@ -0,0 +1,214 @@
+﻿// Copyright Melvin Brink 2023. All Rights Reserved.
+
+// ReSharper disable CppUE4CodingStandardNamingViolationWarning
+#pragma once
+#include <map>
+#include <vector>
+
+
+
+namespace Rsap::Map
+{
+	/**
+	 * Flat map that stores its keys in a sorted array, and the values in a separate array with the same order.
+	 * Lookups are a branchless binary search over the keys only, so a search touches a few cache lines instead of walking a red-black tree.
+	 *
+	 * Meant for data that is built once and then mostly read, like the static octree in-game.
+	 * Inserting a key greater than the last key is an append, so building from an already sorted source is linear.
+	 * Any other insert/erase shifts both arrays, which is fine for the small amount of nodes the dynamic octree holds.
+	 *
+	 * Iteration is always in ascending key order, and exposes '(key, value)' pairs like the std maps do.
+	 * The allocator is rebound for both arrays, so a polymorphic allocator makes it allocate from the same resource as the std maps.
+	 */
+	template <class Key, class T, class Allocator = std::allocator<std::pair<const Key, T>>>
+	class sorted_map
+	{
+	public:
+		using key_type = Key;
+		using mapped_type = T;
+		using size_type = size_t;
+		using allocator_type = Allocator;
+
+	private:
+		using key_allocator = typename std::allocator_traits<Allocator>::template rebind_alloc<Key>;
+		using value_allocator = typename std::allocator_traits<Allocator>::template rebind_alloc<T>;
+
+		std::vector<Key, key_allocator> Keys;
+		std::vector<T, value_allocator> Values;
+
+		template<bool bConst>
+		class iterator_base
+		{
+			friend class sorted_map;
+			template<bool> friend class iterator_base;
+			using map_type = std::conditional_t<bConst, const sorted_map, sorted_map>;
+			using value_reference = std::conditional_t<bConst, const T&, T&>;
+
+			map_type* Map = nullptr;
+			size_type Index = 0;
+
+			iterator_base(map_type* InMap, const size_type InIndex) : Map(InMap), Index(InIndex) {}
+
+		public:
+			using reference = std::pair<const Key&, value_reference>;
+			using difference_type = std::ptrdiff_t;
+
+			// Allows 'Iterator->second' on the pair that is created on dereference.
+			struct arrow_proxy
+			{
+				reference Pair;
+				const reference* operator->() const { return &Pair; }
+			};
+
+			iterator_base() = default;
+
+			// Non-const to const conversion.
+			template<bool bOtherConst, typename = std::enable_if_t<bConst && !bOtherConst>>
+			iterator_base(const iterator_base<bOtherConst>& Other) : Map(Other.Map), Index(Other.Index) {}
+
+			FORCEINLINE reference operator*() const { return reference(Map->Keys[Index], Map->Values[Index]); }
+			FORCEINLINE arrow_proxy operator->() const { return arrow_proxy{**this}; }
+
+			FORCEINLINE iterator_base& operator++() { ++Index; return *this; }
+			FORCEINLINE iterator_base operator++(int) { iterator_base Temp = *this; ++Index; return Temp; }
+			FORCEINLINE iterator_base& operator--() { --Index; return *this; }
+			FORCEINLINE iterator_base operator--(int) { iterator_base Temp = *this; --Index; return Temp; }
+
+			FORCEINLINE bool operator==(const iterator_base& Other) const { return Index == Other.Index; }
+			FORCEINLINE bool operator!=(const iterator_base& Other) const { return Index != Other.Index; }
+
+			// Index of the element within the arrays.
+			FORCEINLINE size_type index() const { return Index; }
+		};
+
+	public:
+		using iterator = iterator_base<false>;
+		using const_iterator = iterator_base<true>;
+
+		sorted_map() = default;
+		explicit sorted_map(const Allocator& Alloc) : Keys(key_allocator(Alloc)), Values(value_allocator(Alloc)) {}
+
+		// Builds the map from a std::map, which is already sorted so this is a straight copy.
+		explicit sorted_map(const std::map<Key, T>& Ordered, const Allocator& Alloc = Allocator()) : sorted_map(Alloc)
+		{
+			reserve(Ordered.size());
+			for (const auto& [InKey, InValue] : Ordered)
+			{
+				Keys.emplace_back(InKey);
+				Values.emplace_back(InValue);
+			}
+		}
+
+		// Returns the index of the first key that is not less than the given key. Returns size() if there is none.
+		FORCEINLINE size_type lower_bound_index(const Key& InKey) const
+		{
+			size_type Length = Keys.size();
+			if(!Length) return 0;
+
+			// Branchless: the loop always runs log2(n) times, and the compiler turns the comparison into a conditional move.
+			const Key* Base = Keys.data();
+			while (Length > 1)
+			{
+				const size_type Half = Length / 2;
+				Base = Base[Half] < InKey ? Base + Half : Base;
+				Length -= Half;
+			}
+			return (Base - Keys.data()) + (*Base < InKey);
+		}
+
+		FORCEINLINE iterator lower_bound(const Key& InKey) { return iterator(this, lower_bound_index(InKey)); }
+		FORCEINLINE const_iterator lower_bound(const Key& InKey) const { return const_iterator(this, lower_bound_index(InKey)); }
+
+		FORCEINLINE iterator find(const Key& InKey)
+		{
+			const size_type Index = lower_bound_index(InKey);
+			if(Index == Keys.size() || Keys[Index] != InKey) return end();
+			return iterator(this, Index);
+		}
+		FORCEINLINE const_iterator find(const Key& InKey) const
+		{
+			const size_type Index = lower_bound_index(InKey);
+			if(Index == Keys.size() || Keys[Index] != InKey) return end();
+			return const_iterator(this, Index);
+		}
+		FORCEINLINE bool contains(const Key& InKey) const
+		{
+			const size_type Index = lower_bound_index(InKey);
+			return Index != Keys.size() && Keys[Index] == InKey;
+		}
+
+		// Constructs the value in-place if the key does not exist yet. Appending is O(1), inserting in the middle shifts the arrays.
+		template<typename... TArgs>
+		std::pair<iterator, bool> try_emplace(const Key& InKey, TArgs&&... Args)
+		{
+			// Fast path for keys that are added in sorted order.
+			if(Keys.empty() || Keys.back() < InKey)
+			{
+				Keys.emplace_back(InKey);
+				Values.emplace_back(std::forward<TArgs>(Args)...);
+				return { iterator(this, Keys.size() - 1), true };
+			}
+
+			const size_type Index = lower_bound_index(InKey);
+			if(Keys[Index] == InKey) return { iterator(this, Index), false };
+
+			Keys.emplace(Keys.begin() + Index, InKey);
+			Values.emplace(Values.begin() + Index, std::forward<TArgs>(Args)...);
+			return { iterator(this, Index), true };
+		}
+		template<typename... TArgs>
+		FORCEINLINE std::pair<iterator, bool> emplace(const Key& InKey, TArgs&&... Args)
+		{
+			return try_emplace(InKey, std::forward<TArgs>(Args)...);
+		}
+
+		size_type erase(const Key& InKey)
+		{
+			const size_type Index = lower_bound_index(InKey);
+			if(Index == Keys.size() || Keys[Index] != InKey) return 0;
+			Keys.erase(Keys.begin() + Index);
+			Values.erase(Values.begin() + Index);
+			return 1;
+		}
+		iterator erase(const_iterator Iterator)
+		{
+			Keys.erase(Keys.begin() + Iterator.Index);
+			Values.erase(Values.begin() + Iterator.Index);
+			return iterator(this, Iterator.Index);
+		}
+
+		FORCEINLINE void reserve(const size_type Capacity)
+		{
+			Keys.reserve(Capacity);
+			Values.reserve(Capacity);
+		}
+		FORCEINLINE void clear()
+		{
+			Keys.clear();
+			Values.clear();
+		}
+
+		// Releases any excess capacity, call after the map has been fully built.
+		FORCEINLINE void shrink_to_fit()
+		{
+			Keys.shrink_to_fit();
+			Values.shrink_to_fit();
+		}
+
+		FORCEINLINE size_type size() const { return Keys.size(); }
+		FORCEINLINE bool empty() const { return Keys.empty(); }
+		FORCEINLINE size_type capacity() const { return Keys.capacity(); }
+
+		FORCEINLINE iterator begin() { return iterator(this, 0); }
+		FORCEINLINE iterator end() { return iterator(this, Keys.size()); }
+		FORCEINLINE const_iterator begin() const { return const_iterator(this, 0); }
+		FORCEINLINE const_iterator end() const { return const_iterator(this, Keys.size()); }
+
+		// Direct access to the sorted arrays.
+		FORCEINLINE const std::vector<Key, key_allocator>& keys() const { return Keys; }
+		FORCEINLINE const std::vector<T, value_allocator>& values() const { return Values; }
+		FORCEINLINE std::vector<T, value_allocator>& values() { return Values; }
+
+		FORCEINLINE allocator_type get_allocator() const { return allocator_type(Keys.get_allocator()); }
+	};
+}
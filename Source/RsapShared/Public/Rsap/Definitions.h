@@ -4,6 +4,9 @@
 #pragma once
 #include <map>
 #include "Rsap/ThirdParty/unordered_dense/unordered_dense.h"
+#include "Rsap/Containers/SortedMap.h"
+#include <memory_resource>
+#include <bit>
 
 DECLARE_LOG_CATEGORY_EXTERN(LogRsap, Log, All);
 inline DEFINE_LOG_CATEGORY(LogRsap);
@@ -25,6 +28,7 @@ namespace Rsap::NavMesh
 namespace Rsap::NavMesh::Layer
 {
 	static inline constexpr layer_idx Root			 = 0;
+	static inline constexpr layer_idx DenseDepth	 = 4; // Deepest layer that is stored densely, see TRsapOctreeLayer.
 	static inline constexpr layer_idx StaticDepth	 = 8;
 	static inline constexpr layer_idx NodeDepth		 = 10;
 	static inline constexpr layer_idx GroupedLeaf	 = 11;
@@ -177,6 +181,10 @@ namespace Rsap::NavMesh::Direction
 	static inline constexpr rsap_direction All	= 0b111111;
 	static inline constexpr rsap_direction None	= 0b000000;
 	static inline constexpr rsap_direction List[6] = {Negative::X, Negative::Y, Negative::Z, Positive::X, Positive::Y, Positive::Z};	
+
+	// Index of a single direction within the ::List. The opposite direction is 3 indices further, see ::GetInverseIndex.
+	constexpr uint8 GetIndex(const rsap_direction Direction) { return 5 - std::countr_zero(Direction); }
+	constexpr uint8 GetInverseIndex(const uint8 DirectionIdx) { return (DirectionIdx + 3) % 6; }
 }
 
 struct FRsapChunk;
@@ -192,4 +200,26 @@ namespace Rsap::Map
 	
 	template <class Key, class T, class Compare = std::less<Key>, class Allocator = std::allocator<std::pair<const Key, T>>>
 	using ordered_map = std::map<Key, T, Compare, Allocator>;
+
+	// Same maps, but allocating from a memory-resource like the navmesh's arena.
+	namespace pmr
+	{
+		template <class Key, class T, class Hash = ankerl::unordered_dense::hash<Key>, class KeyEqual = std::equal_to<Key>>
+		using flat_map = Rsap::Map::flat_map<Key, T, Hash, KeyEqual, std::pmr::polymorphic_allocator<std::pair<Key, T>>>;
+
+		template <class Key, class T, class Compare = std::less<Key>>
+		using ordered_map = Rsap::Map::ordered_map<Key, T, Compare, std::pmr::polymorphic_allocator<std::pair<const Key, T>>>;
+
+		template <class Key, class T>
+		using sorted_map = Rsap::Map::sorted_map<Key, T, std::pmr::polymorphic_allocator<std::pair<const Key, T>>>;
+	}
+
+	// Map used for the octree layers. The editor continuously inserts/erases nodes, while in-game the static octree is only read after it has been loaded.
+#if WITH_EDITOR
+	template <class Key, class T>
+	using layer_map = pmr::ordered_map<Key, T>;
+#else
+	template <class Key, class T>
+	using layer_map = pmr::sorted_map<Key, T>;
+#endif
 }
\ No newline at end of file
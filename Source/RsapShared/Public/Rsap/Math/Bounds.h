@@ -9,6 +9,13 @@ using namespace Rsap::NavMesh;
 
 
 
+// Order in which FRsapBounds::ForEachNode visits the nodes.
+enum class ERsapNodeOrder
+{
+	Axis,	// Loops over the Z, then Y, then X axis.
+	Morton	// Increasing morton-code, which is the order of the sorted layers. The bounds should be within a single chunk.
+};
+
 // AABB overlap check result.
 enum class EAABBOverlapResult
 {
@@ -286,15 +293,17 @@ struct FRsapBounds
 
 	/**
 	 * Runs the callback for-each node intersecting with these bounds in the given layer.
+	 * Both orders visit the same nodes. ERsapNodeOrder::Morton visits them in the order they are stored, so inserting them into a layer appends to it.
 	 * 
 	 * Callback returns:
 	 * node_morton: morton-code of the node.
 	 * FRsapVector32: global location of the node.
 	 */
-	template<typename Func>
+	template<ERsapNodeOrder Order = ERsapNodeOrder::Axis, typename Func>
 	void ForEachNode(const layer_idx LayerIdx, Func Callback) const
 	{
 		static_assert(std::is_invocable_v<Func, node_morton, FRsapVector32>, "'::ForEachNode' callback must be invocable with 'node_morton, FRsapVector32'");
+		if constexpr (Order == ERsapNodeOrder::Morton) return ForEachNodeInMortonOrder(LayerIdx, Callback);
 
 		// Round the boundaries to the node-size of the layer, and then subtract one node-size to get the boundaries we can loop over.
 		// We can't just floor the bounds because a coordinate can be an exact multiple of the node-size,
@@ -337,6 +346,40 @@ struct FRsapBounds
 		}
 	}
 
+	/**
+	 * Walks the morton-codes from the first to the last node within the bounds.
+	 * Stepping to the next morton-code in the layer leaves the bounds when it crosses one of its sides, which is when BIGMIN jumps to where the curve re-enters it.
+	 */
+	template<typename Func>
+	void ForEachNodeInMortonOrder(const layer_idx LayerIdx, Func& Callback) const
+	{
+		if(!HasVolume()) return;
+		const auto [MinMC, MaxMC] = GetNodeMortonRange(LayerIdx);
+		const FRsapVector32 ChunkLocation = Min.FloorToChunk();
+		
+		node_morton NodeMC = MinMC;
+		while (true)
+		{
+			Callback(NodeMC, FRsapVector32::FromNodeMorton(NodeMC, ChunkLocation));
+			if(NodeMC == MaxMC) return;
+
+			NodeMC += FMortonUtils::Node::LayerOffsets[LayerIdx];
+			if(!FMortonUtils::Node::IsInBox(NodeMC, MinMC, MaxMC)) NodeMC = FMortonUtils::Node::GetBigMin(NodeMC, MinMC, MaxMC);
+		}
+	}
+
+	/**
+	 * Returns the morton-codes of the first and last node in the given layer that intersect with these bounds, which should be within a single chunk.
+	 * Together they span the box that can be queried with TRsapOctreeLayer::ForEachInBox.
+	 */
+	std::pair<node_morton, node_morton> GetNodeMortonRange(const layer_idx LayerIdx) const
+	{
+		// Same as ::ForEachNode, the max is the location of the last node within the rounded bounds.
+		FRsapBounds Boundaries = RoundToLayer(LayerIdx);
+		Boundaries.Max = Boundaries.Max - Node::Sizes[LayerIdx];
+		return { Boundaries.Min.ToNodeMorton(), Boundaries.Max.ToNodeMorton() };
+	}
+
 	/**
 	 * Gets the most optimal octree-layer to start rasterizing the nodes that are intersecting with these bounds.
 	 * See docs for more info.
@@ -356,20 +399,16 @@ struct FRsapBounds
 	}
 
 	/**
-	 * Gets the nodes intersecting with these boundaries within the given layer.
+	 * Gets the nodes intersecting with these boundaries within the given layer, which should be within a single chunk.
+	 * The nodes are sorted by their morton-code. The given array is cleared first, so that the caller can reuse its memory.
 	 */
-	std::unordered_set<node_morton> GetIntersectingNodes(const layer_idx LayerIdx) const
+	void GetIntersectingNodes(const layer_idx LayerIdx, std::vector<node_morton>& OutNodes) const
 	{
-		std::unordered_set<node_morton> Result;
-		ForEachNode(LayerIdx, [&](const node_morton NodeMC, const FRsapVector32& Location)
+		OutNodes.clear();
+		ForEachNode<ERsapNodeOrder::Morton>(LayerIdx, [&](const node_morton NodeMC, const FRsapVector32& Location)
 		{
-			// todo: remove the debug part.
-			// FRsapBounds(Location, Location + Node::Sizes[LayerIdx]).Draw(GEditor->GetEditorWorldContext().World(), FColor::Green, 5);
-			// this->FromNodeMorton(NodeMC, LayerIdx, Location.FloorToChunk()).Draw(GEditor->GetEditorWorldContext().World(), FColor::Red, 5);
-			
-			Result.emplace(NodeMC);
+			OutNodes.emplace_back(NodeMC);
 		});
-		return Result;
 	}
 
 	std::vector<FRsapVector32> GetIntersectingNodeLocations(const layer_idx LayerIdx) const
@@ -11,6 +11,25 @@
 // Provides functionality for morton-codes.
 struct FMortonUtils
 {
+	// True when the CPU has fast pdep/pext instructions. Set on module startup by ::InitializeDispatch.
+	static RSAPSHARED_API bool bUseBMI2;
+
+	// Detects the CPU features used to encode/decode the morton-codes. Called on module startup.
+	static RSAPSHARED_API void InitializeDispatch();
+
+	/**
+	 * Encoding/decoding using the BMI2 pdep/pext instructions, which (de)interleave the bits of all the axis in a few cycles.
+	 * Compiled for BMI2 regardless of the build's target, so only call these when ::bUseBMI2 is true.
+	 * The results are bit-exact with libmorton's lookup-tables.
+	 */
+	struct RSAPSHARED_API BMI2
+	{
+		static node_morton EncodeNode(uint32 X, uint32 Y, uint32 Z);
+		static void DecodeNode(node_morton MortonCode, uint32& OutX, uint32& OutY, uint32& OutZ);
+		static chunk_morton EncodeChunk(uint64 X, uint64 Y, uint64 Z);
+		static void DecodeChunk(chunk_morton MortonCode, uint64& OutX, uint64& OutY, uint64& OutZ);
+	};
+	
 	struct Node
 	{
 		static inline constexpr node_morton Mask_X = 0b00001001001001001001001001001001;
@@ -57,6 +76,7 @@ struct FMortonUtils
 		FORCEINLINE static node_morton Encode(const uint_fast16_t X, const uint_fast16_t Y, const uint_fast16_t Z)
 		{
 			using namespace Rsap::NavMesh;
+			if(bUseBMI2) return BMI2::EncodeNode(X, Y, Z);
 			return libmorton::morton3D_32_encode(X, Y, Z);
 		}
 
@@ -64,6 +84,16 @@ struct FMortonUtils
 		FORCEINLINE static void Decode(const node_morton MortonCode, uint16& OutX, uint16& OutY, uint16& OutZ)
 		{
 			using namespace Rsap::NavMesh;
+			if(bUseBMI2)
+			{
+				uint32 X, Y, Z;
+				BMI2::DecodeNode(MortonCode, X, Y, Z);
+				OutX = X;
+				OutY = Y;
+				OutZ = Z;
+				return;
+			}
+			
 			uint_fast16_t X, Y, Z;
 			libmorton::morton3D_32_decode(MortonCode, X, Y, Z);
 			OutX = X;
@@ -83,7 +113,7 @@ struct FMortonUtils
 			// Shift the MortonCode, and mask the last 3 bits.
 			// The remainder evaluates directly to the node's index in it's parent.
 			static constexpr node_morton ChildIdxMask = 0b00000000000000000000000000000111;
-			static constexpr uint8 Shifts[10] = {30, 27, 24, 21, 18, 15, 12, 9, 6, 3};
+			static constexpr uint8 Shifts[11] = {30, 27, 24, 21, 18, 15, 12, 9, 6, 3, 0}; // Includes the leaf-nodes.
 			return (MortonCode >> Shifts[LayerIdx]) & ChildIdxMask;
 		}
 
@@ -154,6 +184,22 @@ struct FMortonUtils
 			}
 		}
 
+		// Returns the directions in which the neighbour of the node is in another chunk, which are the sides of the node against the border of its chunk.
+		FORCEINLINE static rsap_direction GetChunkBorderDirections(const node_morton MortonCode, const layer_idx LayerIdx)
+		{
+			using namespace Rsap::NavMesh::Direction;
+			const node_morton LayerMask = ParentMasks[LayerIdx]; // Only the bits that are used by the nodes in this layer.
+
+			rsap_direction Directions = None;
+			if(!(MortonCode & Mask_X)) Directions |= Negative::X;
+			if(!(MortonCode & Mask_Y)) Directions |= Negative::Y;
+			if(!(MortonCode & Mask_Z)) Directions |= Negative::Z;
+			if((MortonCode & Mask_X) == (Mask_X & LayerMask)) Directions |= Positive::X;
+			if((MortonCode & Mask_Y) == (Mask_Y & LayerMask)) Directions |= Positive::Y;
+			if((MortonCode & Mask_Z) == (Mask_Z & LayerMask)) Directions |= Positive::Z;
+			return Directions;
+		}
+
 		// Gets the neighbour's morton-code of a node in the given direction, which could also be in an upper layer.
 		FORCEINLINE static node_morton GetNeighbour(const node_morton MortonCode, const layer_idx NeighbourLayerIdx, const rsap_direction Direction)
 		{
@@ -255,6 +301,46 @@ struct FMortonUtils
 				default: return false;
 			}
 		}
+
+		// Returns true if the morton-code lies within the box spanned by the min and max morton-codes, which are both inclusive.
+		FORCEINLINE static bool IsInBox(const node_morton MortonCode, const node_morton MinMC, const node_morton MaxMC)
+		{
+			const node_morton X = MortonCode & Mask_X, Y = MortonCode & Mask_Y, Z = MortonCode & Mask_Z;
+			return	X >= (MinMC & Mask_X) && X <= (MaxMC & Mask_X) &&
+					Y >= (MinMC & Mask_Y) && Y <= (MaxMC & Mask_Y) &&
+					Z >= (MinMC & Mask_Z) && Z <= (MaxMC & Mask_Z);
+		}
+
+		/**
+		 * BIGMIN: the smallest morton-code within the box that is larger than the given one, which should be outside of the box, but between MinMC and MaxMC.
+		 * Used to skip over the parts of the Z-order curve that leave the box, see TRsapOctreeLayer::ForEachInBox.
+		 *
+		 * Walks the bits from the most significant one, and splits the box in two at every bit where MinMC and MaxMC differ.
+		 * "Tropf & Herzog, Multidimensional Range Search in Dynamically Balanced Trees".
+		 */
+		static node_morton GetBigMin(const node_morton MortonCode, node_morton MinMC, node_morton MaxMC)
+		{
+			node_morton BigMin = MaxMC;
+			for (int32 Bit = 29; Bit >= 0; --Bit)
+			{
+				const node_morton BitMask = 1u << Bit;
+				const node_morton LowerAxisBits = (Mask_X << (Bit % 3)) & (BitMask - 1);
+				switch ((MortonCode & BitMask ? 0b100 : 0) | (MinMC & BitMask ? 0b010 : 0) | (MaxMC & BitMask ? 0b001 : 0))
+				{
+					case 0b001: // The box is split, and the morton-code is in the lower half. BIGMIN is either the start of the upper half, or in the lower half.
+						BigMin = (MinMC | BitMask) & ~LowerAxisBits;
+						MaxMC = (MaxMC & ~BitMask) | LowerAxisBits;
+						break;
+					case 0b011: return MinMC;	// Whole box is above the morton-code.
+					case 0b100: return BigMin;	// Whole box is below the morton-code.
+					case 0b101: // Continue in the upper half.
+						MinMC = (MinMC | BitMask) & ~LowerAxisBits;
+						break;
+					default: break;
+				}
+			}
+			return BigMin;
+		}
 	};
 
 
@@ -280,6 +366,7 @@ struct FMortonUtils
 			const uint_fast32_t InY = (Y + Rsap::NavMesh::Chunk::SignOffset) >> Rsap::NavMesh::Chunk::SizeBits;
 			const uint_fast32_t InZ = (Z + Rsap::NavMesh::Chunk::SignOffset) >> Rsap::NavMesh::Chunk::SizeBits;
 			
+			if(bUseBMI2) return BMI2::EncodeChunk(InX, InY, InZ);
 			return libmorton::morton3D_64_encode(InX, InY, InZ);
 		}
 
@@ -287,7 +374,13 @@ struct FMortonUtils
 		static void Decode(const chunk_morton ChunkMorton, int32& OutX, int32& OutY, int32& OutZ)
 		{
 			uint_fast32_t X, Y, Z;
-			libmorton::morton3D_64_decode(ChunkMorton, X, Y, Z);
+			if(bUseBMI2)
+			{
+				uint64 X64, Y64, Z64;
+				BMI2::DecodeChunk(ChunkMorton, X64, Y64, Z64);
+				X = X64; Y = Y64; Z = Z64;
+			}
+			else libmorton::morton3D_64_decode(ChunkMorton, X, Y, Z);
 			
 			OutX = (X << Rsap::NavMesh::Chunk::SizeBits) - Rsap::NavMesh::Chunk::SignOffset;
 			OutY = (Y << Rsap::NavMesh::Chunk::SizeBits) - Rsap::NavMesh::Chunk::SignOffset;
@@ -2,6 +2,7 @@
 
 #pragma once
 #include "Vectors.h"
+#include "TriangleBVH.h"
 
 
 // todo: For very large objects, like terrain, do a recursive overlap check to filter out the parts that have no overlap. Should be a certain size that the chunk-size fits in perfectly.
@@ -43,6 +44,12 @@ struct FRsapOverlap
 		return Component->GetBodyInstance()->OverlapTest_AssumesLocked(*(NodeLocation + Node::HalveSizes[LayerIdx]), FQuat::Identity, CollisionBoxes[LayerIdx], nullptr, bComplex);
 	}
 
+	// Checks the node against the triangles of a mesh, using the transform of the component. Does not need the physics-scene, so it is safe to run on any thread.
+	FORCEINLINE static bool Triangles(const FRsapTriangleBVH& TriangleBVH, const FTransform& Transform, const FRsapVector32& NodeLocation, const layer_idx LayerIdx)
+	{
+		return TriangleBVH.Overlaps(Transform, *(NodeLocation + Node::HalveSizes[LayerIdx]), FVector(Node::HalveSizes[LayerIdx]));
+	}
+
 	// Returns a list of actors that overlap with the given node.
 	FORCEINLINE static TArray<AActor*> GetActors(const UWorld* World, const FRsapVector32& NodeLocation, const layer_idx LayerIdx)
 	{
@@ -0,0 +1,59 @@
+﻿// Copyright Melvin Brink 2023. All Rights Reserved.
+
+#pragma once
+#include <array>
+#include <utility>
+#include <vector>
+
+
+
+namespace Rsap::Sort
+{
+	/**
+	 * Least-significant-digit radix-sort on an unsigned integer key of each value, which is stable.
+	 * Sorts 10 bits per pass, so a node_morton is sorted in three linear passes without any comparisons.
+	 * The counts of all passes are gathered in a single read, and a pass is skipped when all values have the same digit.
+	 *
+	 * @param Values Values to sort in-place.
+	 * @param Scratch Buffer the values are moved in-between, which keeps its memory for the next sort.
+	 * @param GetKey Returns the key of a value, which should fit in 'KeyBits'.
+	 * @tparam KeyBits Number of bits of the key that are sorted on.
+	 */
+	template<uint32 KeyBits = 30, typename T, typename KeyFunc>
+	void RadixSort(std::vector<T>& Values, std::vector<T>& Scratch, KeyFunc GetKey)
+	{
+		static constexpr uint32 DigitBits = 10;
+		static constexpr uint32 DigitCount = 1 << DigitBits;
+		static constexpr uint32 PassCount = (KeyBits + DigitBits - 1) / DigitBits;
+		if(Values.size() < 2) return;
+
+		std::array<std::array<size_t, DigitCount>, PassCount> Counts{};
+		for (const T& Value : Values)
+		{
+			const uint64 Key = GetKey(Value);
+			for (uint32 Pass = 0; Pass < PassCount; ++Pass) ++Counts[Pass][(Key >> (Pass * DigitBits)) & (DigitCount - 1)];
+		}
+
+		Scratch.resize(Values.size());
+		for (uint32 Pass = 0; Pass < PassCount; ++Pass)
+		{
+			std::array<size_t, DigitCount>& Offsets = Counts[Pass];
+			const uint64 FirstDigit = (GetKey(Values[0]) >> (Pass * DigitBits)) & (DigitCount - 1);
+			if(Offsets[FirstDigit] == Values.size()) continue;
+
+			// Counts to the starting offset of each digit.
+			size_t Offset = 0;
+			for (size_t& Count : Offsets) Offset += std::exchange(Count, Offset);
+
+			for (T& Value : Values) Scratch[Offsets[(GetKey(Value) >> (Pass * DigitBits)) & (DigitCount - 1)]++] = std::move(Value);
+			Values.swap(Scratch);
+		}
+	}
+
+	// Sorts the unsigned integers, see ::RadixSort.
+	template<uint32 KeyBits = 30, typename T>
+	FORCEINLINE void RadixSort(std::vector<T>& Values, std::vector<T>& Scratch)
+	{
+		RadixSort<KeyBits>(Values, Scratch, [](const T Value) { return static_cast<uint64>(Value); });
+	}
+}
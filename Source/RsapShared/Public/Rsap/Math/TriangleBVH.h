@@ -0,0 +1,92 @@
+﻿// Copyright Melvin Brink 2023. All Rights Reserved.
+
+#pragma once
+#include "Rsap/Definitions.h"
+#include <array>
+#include <memory>
+#include <vector>
+
+class UPrimitiveComponent;
+class UStaticMesh;
+
+
+
+/**
+ * Bounding-volume-hierarchy over the collision-triangles of a static-mesh, in mesh-space.
+ * Used to check if a node overlaps a mesh without querying the physics-scene, see FRsapOverlap::Triangles.
+ *
+ * The leaves store their triangles in blocks of four, laid out per coordinate, so that a whole block is tested against the node with SIMD.
+ * Only the triangles are tested, same as the complex-collision of the physics-engine, so a node that is fully inside a mesh has no overlap.
+ */
+class RSAPSHARED_API FRsapTriangleBVH
+{
+public:
+	typedef std::array<FVector3f, 3> FTriangle;
+	
+	static inline constexpr uint32 MaxTrianglesPerLeaf = 8;
+
+	struct FNode
+	{
+		FVector3f Min;
+		uint32 FirstIdx = 0;	// Index of the first child, or the first triangle-block if this is a leaf. The second child directly follows the first.
+		FVector3f Max;
+		uint32 BlockCount = 0;	// Zero if this is not a leaf.
+	};
+
+	// Four triangles, where unused lanes repeat the last triangle.
+	struct alignas(16) FTriangleBlock
+	{
+		float Vertices[3][3][4]; // [Vertex][Axis][Lane]
+	};
+
+	// Vertices of the triangles in mesh-space. Degenerate triangles are skipped.
+	explicit FRsapTriangleBVH(std::vector<FTriangle> Triangles, bool bIsSimpleCollision = false);
+
+	/**
+	 * Returns true if the box overlaps any of the triangles, which are transformed using the given transform of the component that uses this mesh.
+	 * Touching a triangle counts as an overlap.
+	 */
+	bool Overlaps(const FTransform& Transform, const FVector& BoxCenter, const FVector& BoxExtent) const;
+
+	/**
+	 * Gets the triangles that overlap the box, transformed into world-space relative to the center of the box.
+	 * The given array is cleared first, so that the caller can reuse its memory.
+	 */
+	void GetOverlappingTriangles(const FTransform& Transform, const FVector& BoxCenter, const FVector& BoxExtent, std::vector<FTriangle>& OutTriangles) const;
+
+	// Returns the cached BVH for the static-mesh of the component. Returns nullptr if it is not a static-mesh-component, or if its mesh uses simple collision as complex.
+	static std::shared_ptr<const FRsapTriangleBVH> Find(const UPrimitiveComponent* Component);
+
+	// Removes the cached BVH of the static-mesh, so that it is rebuilt the next time it is found. Call this when the mesh or its collision has changed.
+	static void Invalidate(const UStaticMesh* StaticMesh);
+
+	FORCEINLINE bool IsEmpty() const { return Nodes.empty(); }
+
+	// True if the physics-engine also uses these triangles for simple queries, so they can replace both the simple and complex collision.
+	FORCEINLINE bool IsSimpleCollision() const { return bIsSimpleCollision; }
+	FORCEINLINE uint32 GetTriangleCount() const { return TriangleCount; }
+	FORCEINLINE size_t GetAllocatedSize() const { return Nodes.capacity() * sizeof(FNode) + Blocks.capacity() * sizeof(FTriangleBlock); }
+
+private:
+	std::vector<FNode> Nodes;
+	std::vector<FTriangleBlock> Blocks;
+	uint32 TriangleCount = 0;
+	bool bIsSimpleCollision = false;
+
+	// Transforms from mesh-space into the space of the box, in which the box is centered at the origin.
+	struct FBoxSpace
+	{
+		float Matrix[3][4]; // [Axis][X, Y, Z, Translation]
+		float Extent[3];
+	};
+
+	void BuildNode(uint32 NodeIdx, std::vector<FTriangle>& Triangles, uint32 Begin, uint32 End);
+	static FBoxSpace GetBoxSpace(const FTransform& Transform, const FVector& BoxCenter, const FVector& BoxExtent, FVector3f& OutQueryMin, FVector3f& OutQueryMax);
+
+	// Runs the callback with the index of each block in the leaves that overlap the query-bounds, until it returns true.
+	template<typename Func>
+	bool ForEachBlock(const FVector3f& QueryMin, const FVector3f& QueryMax, Func Callback) const;
+
+	// Returns a mask of the lanes of the block whose triangle overlaps the box.
+	static uint32 OverlapsBlock(const FTriangleBlock& Block, const FBoxSpace& BoxSpace);
+};
@@ -0,0 +1,29 @@
+﻿// Copyright Melvin Brink 2023. All Rights Reserved.
+
+#pragma once
+#include "Rsap/Math/Vectors.h"
+#include "Rsap/Math/TriangleBVH.h"
+
+
+
+/**
+ * Conservative voxelization of triangles into the 64 leafs of a leaf-node, which replaces an overlap-query per leaf with a few bit-operations.
+ *
+ * Similar to Voxelization/PointCount.usf, each triangle is projected along its major axis onto the 4x4 grid of columns of the leaf-node.
+ * The triangle is clipped to each column it covers, and the range of the clipped polygon along the major axis gives the leafs in that column,
+ * which are set all at once with a precomputed mask. Touching a leaf counts as an overlap, same as FRsapTriangleBVH::Overlaps.
+ */
+struct RSAPSHARED_API FRsapVoxelizer
+{
+	// Number of leafs on each axis of a leaf-node.
+	static inline constexpr int32 LeafsPerAxis = 4;
+
+	/**
+	 * Returns the mask of the leafs that the triangle overlaps, ordered the same as FRsapLeaf::Leafs.
+	 * The vertices are relative to the negative corner of the leaf-node, and in leaf-units, so the leaf-node goes from 0 to 4 on each axis.
+	 */
+	static uint64 Triangle(const FRsapTriangleBVH::FTriangle& Triangle);
+
+	// Voxelizes the triangles of the mesh that overlap the leaf-node. Does not need the physics-scene, so it is safe to run on any thread.
+	static uint64 LeafNode(const FRsapTriangleBVH& TriangleBVH, const FTransform& Transform, const FRsapVector32& NodeLocation);
+};
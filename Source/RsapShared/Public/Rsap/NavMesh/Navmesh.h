@@ -3,9 +3,14 @@
 #pragma once
 #include "Engine/AssetUserData.h"
 #include "Rsap/Definitions.h"
+#include "Rsap/Containers/Arena.h"
 #include "Rsap/NavMesh/Types/Chunk.h"
 #include "Types/Actor.h"
+#include "Processing/OctreeBuilder.h"
+#include <algorithm>
+#include <ranges>
 #include <unordered_set>
+#include <vector>
 
 class IRsapWorld;
 
@@ -65,19 +70,35 @@ enum class ERsapNavmeshLoadResult
 struct FRsapNavmeshLoadResult
 {
 	ERsapNavmeshLoadResult Result;
-	FRsapActorMap MismatchedActors;
+	std::vector<chunk_morton> MismatchedChunkMCs; // The chunks that are out-of-sync, which are not loaded and should be regenerated.
 };
 
 
+/**
+ * Every chunk allocates its octrees and nodes from the arena owned by the navmesh, as does the chunk-map itself.
+ */
 template <typename ChunkType>
 class RSAPSHARED_API TRsapNavMeshBase
 {
+protected:
+	FRsapArena Arena; // Declared before the chunks, which are allocated from it.
+
 public:
 #if WITH_EDITOR
-	Rsap::Map::ordered_map<chunk_morton, ChunkType> Chunks;
+	typedef Rsap::Map::pmr::ordered_map<chunk_morton, ChunkType> FChunkMap;
 #else
-	Rsap::Map::flat_map<chunk_morton, ChunkType> Chunks;
+	typedef Rsap::Map::pmr::flat_map<chunk_morton, ChunkType> FChunkMap;
 #endif
+	FChunkMap Chunks{&Arena};
+
+	TRsapNavMeshBase() = default;
+	TRsapNavMeshBase(const TRsapNavMeshBase&) = delete;
+	TRsapNavMeshBase& operator=(const TRsapNavMeshBase&) = delete;
+
+	~TRsapNavMeshBase()
+	{
+		Clear();
+	}
 	
 	// Returns nullptr if it does not exist.
 	FORCEINLINE ChunkType* FindChunk(const chunk_morton ChunkMC)
@@ -89,12 +110,16 @@ public:
 
 	FORCEINLINE ChunkType& InitChunk(const chunk_morton ChunkMC)
 	{
-		return Chunks.try_emplace(ChunkMC).first->second;
+		return Chunks.try_emplace(ChunkMC, &Arena).first->second;
 	}
 
+	// Frees all the chunks at once by releasing the arena, instead of destroying every chunk and its octrees one-by-one.
+	// The destructors can only be skipped for chunks that do not own memory from outside of the arena, the others are destroyed first.
 	FORCEINLINE void Clear()
 	{
-		Chunks.clear();
+		if constexpr (!TRsapIsArenaOnlyChunk<ChunkType>::Value) Chunks.clear();
+		Arena.Release();
+		std::construct_at(&Chunks, &Arena);
 	}
 
 	void LogNodeCount() const
@@ -107,6 +132,24 @@ public:
 			UE_LOG(LogRsap, Log, TEXT("Chunk: '%llu-%llu' has %llu nodes"), ChunkMC >> 6, ChunkMC & 0b111111, NodeCount)
 		}
 	}
+
+	// Returns a breakdown of the memory used by this navmesh, per chunk, layer and container-type.
+	FRsapMemoryReport GetMemoryReport() const
+	{
+		FRsapMemoryReport Report;
+		Report.Arena = Arena.GetStats();
+		Report.Containers.Chunks = Rsap::Memory::GetAllocatedSize(Chunks); // Includes the chunk objects.
+		Report.Chunks.reserve(Chunks.size());
+		
+		for(const auto& [ChunkMC, Chunk] : Chunks)
+		{
+			FRsapMemoryReport::FChunk& ChunkReport = Report.Chunks.emplace_back();
+			ChunkReport.ChunkMC = ChunkMC;
+			ChunkReport.Bytes = sizeof(ChunkType);
+			Chunk.CollectMemory(Report, ChunkReport);
+		}
+		return Report;
+	}
 };
 
 /*
@@ -116,17 +159,139 @@ public:
 class RSAPSHARED_API FRsapNavmesh : public TRsapNavMeshBase<FRsapChunk>
 {
 public:
-	void Generate(const IRsapWorld* RsapWorld);
+	// Chunks are given the pool to take their dynamic octree from, and are linked to the chunks around them.
+	FORCEINLINE FRsapChunk& InitChunk(const chunk_morton ChunkMC)
+	{
+		const FRsapChunk* PreviousChunkData = GetChunkData();
+		const auto [Iterator, bInserted] = Chunks.try_emplace(ChunkMC, &Arena, &DynamicOctreePool);
+		if(bInserted)
+		{
+			// All chunks have moved if the map has grown.
+			if(GetChunkData() != PreviousChunkData) LinkChunks();
+			else LinkChunk(ChunkMC, Iterator->second);
+		}
+		return Iterator->second;
+	}
+
+	// Destroys the chunk together with its linear-octree, and unlinks it from the chunks around it and from the actors that occlude it.
+	void EraseChunk(const chunk_morton ChunkMC)
+	{
+		const auto Iterator = Chunks.find(ChunkMC);
+		if(Iterator == Chunks.end()) return;
+		RemoveActorEntries(Iterator->second, ChunkMC);
+		UnlinkChunk(Iterator->second);
+#if WITH_EDITOR
+		Chunks.erase(Iterator);
+#else
+		// The flat-map moves its last chunk into the erased one.
+		const chunk_morton LastChunkMC = Chunks.values().back().first;
+		Chunks.erase(Iterator);
+		if(LastChunkMC != ChunkMC) LinkChunk(LastChunkMC, Chunks.find(LastChunkMC)->second);
+#endif
+	}
+
+	FORCEINLINE void Clear()
+	{
+		DynamicOctreePool.Reset();
+		TRsapNavMeshBase::Clear();
+		ActorHashes.clear();
+		ActorChunks.clear();
+	}
+
+	// Returns the chunks the actor occludes, or nullptr if it does not occlude any.
+	FORCEINLINE const std::vector<chunk_morton>* FindActorChunks(const actor_key ActorKey) const
+	{
+		const auto Iterator = ActorChunks.find(ActorKey);
+		if(Iterator == ActorChunks.end()) return nullptr;
+		return &Iterator->second;
+	}
+
+	// Rasterizes the chunks on the given amount of threads, which uses every worker-thread when zero. The result is the same for any amount.
+	// Blocks until the navmesh is generated, use a FRsapGenerationJob to spread it over multiple frames.
+	void Generate(const IRsapWorld* RsapWorld, ERsapNodeOrder NodeOrder = ERsapNodeOrder::Morton, int32 ThreadCount = 0);
+
+	// Regenerates only the given chunks, and repairs the relations on their borders.
+	// Blocks until the chunks are regenerated, use a FRsapGenerationJob to spread it over multiple frames, like for the out-of-sync chunks after loading.
+	void Regenerate(const IRsapWorld* RsapWorld, const std::vector<chunk_morton>& ChunkMCs, ERsapNodeOrder NodeOrder = ERsapNodeOrder::Morton, int32 ThreadCount = 0);
+
+	// Regenerates the chunks the actors occlude, and the chunks they intersect now. For actors that have been deleted, moved, or are out-of-sync.
+	void RegenerateActors(const IRsapWorld* RsapWorld, const std::vector<actor_key>& ActorKeys, ERsapNodeOrder NodeOrder = ERsapNodeOrder::Morton, int32 ThreadCount = 0);
 
-	void Save();
+	void Save(const IRsapWorld* RsapWorld);
+
+	/**
+	 * Loads the chunks that are in-sync with the world, and leaves out the ones that are not.
+	 * A chunk is out-of-sync if an actor that occluded it has changed, or if an actor that has changed or been added intersects it now.
+	 * The navmesh is only in-sync with the world once the out-of-sync chunks are regenerated, see FRsapGenerationJob.
+	 * Until then, only the hashes of the unchanged actors that do not occlude any of these chunks are kept, so that a cancelled regeneration is detected again on the next load.
+	 */
 	FRsapNavmeshLoadResult Load(const IRsapWorld* RsapWorld);
 
 private:
-	// Processing
-	void HandleGenerate(const FRsapActorMap& ActorMap);
+	friend class FRsapGenerationJob;
+	friend class FRsapNavmeshUpdater;
 	
-	void RasterizeNode(FRsapChunk& Chunk, chunk_morton ChunkMC, FRsapNode& Node,
-	                   node_morton NodeMC, const FRsapVector32& NodeLocation, layer_idx LayerIdx,
+	FRsapOctreePool DynamicOctreePool{&Arena};
+
+	// Used to detect if the chunks have moved.
+	FORCEINLINE const FRsapChunk* GetChunkData() const
+	{
+#if WITH_EDITOR
+		return nullptr; // The chunks in an ordered-map never move.
+#else
+		return Chunks.empty() ? nullptr : &Chunks.values().front().second;
+#endif
+	}
+
+	// Points the chunk and the chunks around it to each other.
+	FORCEINLINE void LinkChunk(const chunk_morton ChunkMC, FRsapChunk& Chunk)
+	{
+		for (uint8 DirectionIdx = 0; DirectionIdx < std::size(Direction::List); ++DirectionIdx)
+		{
+			FRsapChunk* Neighbour = FindChunk(FMortonUtils::Chunk::GetNeighbour(ChunkMC, Direction::List[DirectionIdx]));
+			Chunk.Neighbours[DirectionIdx] = Neighbour;
+			if(Neighbour) Neighbour->Neighbours[Direction::GetInverseIndex(DirectionIdx)] = &Chunk;
+		}
+	}
+	FORCEINLINE void UnlinkChunk(const FRsapChunk& Chunk)
+	{
+		for (uint8 DirectionIdx = 0; DirectionIdx < std::size(Direction::List); ++DirectionIdx)
+		{
+			if(FRsapChunk* Neighbour = Chunk.Neighbours[DirectionIdx]) Neighbour->Neighbours[Direction::GetInverseIndex(DirectionIdx)] = nullptr;
+		}
+	}
+	void LinkChunks()
+	{
+		for (auto& [ChunkMC, Chunk] : Chunks) LinkChunk(ChunkMC, Chunk);
+	}
+
+	// Adds the actor to the entries of the chunk, and the chunk to the chunks of the actor.
+	// Both are kept in-sync, so the chunk is only new to the actor when the actor is new to the chunk.
+	FORCEINLINE void AddActorEntry(FRsapChunk& Chunk, const chunk_morton ChunkMC, const actor_key ActorKey, const uint64 CollisionHash)
+	{
+		if(Chunk.UpdateActorEntry(ActorKey, CollisionHash)) ActorChunks[ActorKey].push_back(ChunkMC);
+	}
+	void RemoveActorEntries(const FRsapChunk& Chunk, const chunk_morton ChunkMC)
+	{
+		for (const actor_key ActorKey : *Chunk.ActorEntries | std::views::keys)
+		{
+			const auto Iterator = ActorChunks.find(ActorKey);
+			if(Iterator == ActorChunks.end()) continue;
+
+			// The order of the chunks does not matter, so the last one is moved into the removed one.
+			std::vector<chunk_morton>& ActorChunkMCs = Iterator->second;
+			if(const auto ChunkIterator = std::ranges::find(ActorChunkMCs, ChunkMC); ChunkIterator != ActorChunkMCs.end())
+			{
+				*ChunkIterator = ActorChunkMCs.back();
+				ActorChunkMCs.pop_back();
+			}
+			if(ActorChunkMCs.empty()) ActorChunks.erase(Iterator);
+		}
+	}
+	
+	// Processing
+	static bool RasterizeComponent(FRsapOctreeBuilder& Builder, const FRsapCollisionComponent& CollisionComponent, const FRsapBounds& Intersection, ERsapNodeOrder NodeOrder);
+	static void RasterizeNode(FRsapOctreeBuilder& Builder, node_morton NodeMC, const FRsapVector32& NodeLocation, layer_idx LayerIdx,
 	                   const FRsapCollisionComponent& CollisionComponent, bool bIsAABBContained);
 	static void RasterizeLeaf(FRsapLeaf& LeafNode, const FRsapVector32& NodeLocation,
 	                   const FRsapCollisionComponent& CollisionComponent, bool bIsAABBContained);
@@ -136,51 +301,16 @@ private:
 	void InitNodeParents(const FRsapChunk& Chunk, chunk_morton ChunkMC, node_morton NodeMC, layer_idx LayerIdx, node_state NodeState);
 	void SetNodeRelation(const FRsapChunk& Chunk, chunk_morton ChunkMC, FRsapNode& Node, node_morton NodeMC, layer_idx LayerIdx, rsap_direction Relation);
 	void SetNodeRelations(const FRsapChunk& Chunk, chunk_morton ChunkMC, FRsapNode& Node, node_morton NodeMC, layer_idx LayerIdx, rsap_direction Relations);
+	void SetChunkRelations(const FRsapChunk& Chunk, chunk_morton ChunkMC, bool bChunkBorders);
 	
 	//URsapNavmeshMetadata* Metadata = nullptr;
 	bool bRegenerated = false;
+	Rsap::Map::flat_map<actor_key, uint64> ActorHashes; // The collision-hash of every actor the navmesh is in-sync with, see FRsapActor::GetCollisionHash.
+	Rsap::Map::flat_map<actor_key, std::vector<chunk_morton>> ActorChunks; // The chunks each actor occludes, which is the reverse of the actor-entries of the chunks.
 	std::unordered_set<chunk_morton> UpdatedChunkMCs;
 	std::unordered_set<chunk_morton> DeletedChunkMCs;
 
 
-	
-	/**
-	 * Runs the given callback for each node, in the most optimal layer, that is intersecting the collision component.
-	 *
-	 * @param CollisionComponent The FRsapCollisionComponent to iterate over.
-	 * @param ProcessNodeCallback The callback that receives all the necessary data to process the node in any way.
-	 *
-	 * The callback will receive:
-	 * - FRsapChunk*& The chunk the node is in, which will be nullptr if it has not been initialized yet.
-	 * - chunk_morton Morton-code of the chunk.
-	 * - layer_idx The layer the node is in.
-	 * - node_morton The morton-code of the node.
-	 * - FRsapVector32 The location of the node.
-	 *
-	 * @note The chunk ptr reference can be null, and if so, init a new chunk ( if required ) into this reference so that it can be reused in the next iteration.
-	 */
-	template<typename TCallback>
-	void IterateIntersectingNodes(const FRsapCollisionComponent& CollisionComponent, TCallback ProcessNodeCallback)
-	{
-		static_assert(std::is_invocable_v<TCallback, FRsapChunk*&, chunk_morton, layer_idx, node_morton, FRsapVector32&>,
-		"IterateIntersectingNodes: argument 'TCallback ProcessNodeCallback' signature must match (FRsapChunk*&, chunk_morton, layer_idx, node_morton, FRsapVector32&)");
-
-		const FRsapBounds& AABB = CollisionComponent.GetBoundaries();
-		const layer_idx LayerIdx = AABB.GetOptimalRasterizationLayer();
-
-		// Loop through the chunks intersecting these component's AABB. This also returns the intersection of the AABB with the chunk.
-		AABB.ForEachChunk([&](const chunk_morton ChunkMC, const FRsapVector32& ChunkLocation, const FRsapBounds& Intersection)
-		{
-			FRsapChunk* Chunk = FindChunk(ChunkMC);
-
-			// Loop through the nodes within the intersection.
-			Intersection.ForEachNode(LayerIdx, [&](const node_morton NodeMC, const FRsapVector32& NodeLocation)
-			{
-				ProcessNodeCallback(Chunk, ChunkMC, LayerIdx, NodeMC, NodeLocation);
-			});
-		});
-	}
-
 	bool IsSorted() const
 	{
 		for (const auto& Chunk : Chunks | std::views::values)
@@ -188,7 +318,7 @@ private:
 			for (const auto& Layer : Chunk.Octrees[0]->Layers)
 			{
 				node_morton LastNodeMC = 0;
-				for (const node_morton NodeMC : *Layer.get() | std::views::keys)
+				for (const auto& [NodeMC, Node] : *Layer)
 				{
 					if(NodeMC < LastNodeMC)
 					{
@@ -0,0 +1,139 @@
+﻿// Copyright Melvin Brink 2023. All Rights Reserved.
+
+#pragma once
+#include "Rsap/Definitions.h"
+#include "Rsap/NavMesh/Navmesh.h"
+#include <limits>
+#include <unordered_set>
+#include <vector>
+
+class IRsapWorld;
+
+
+
+/**
+ * Generates the navmesh in slices, so that it can be spread over multiple frames.
+ *
+ * The work of every component is split per chunk it intersects, which is the unit of work of each phase:
+ * - Rasterize: each chunk is rasterized into its own builder, in parallel on the task-graph.
+ * - Build: the chunks are initialized and their octrees are built. Serial, because the arena of the navmesh is not thread-safe.
+ * - Relations: the relations within each chunk, in parallel.
+ * - Stitch: the relations across the borders of the chunks, which is serial because it writes to the neighbouring chunks.
+ *
+ * The navmesh should not be used until the job is complete, so generate into a separate navmesh when the current one has to stay usable.
+ * Cancel the job by destroying it, after which the navmesh holds the chunks that have been built so far.
+ * The navmesh is then only in-sync with the actors whose chunks have all been built, so the others are regenerated when the saved navmesh is loaded.
+ *
+ * When given a focus, the job instead goes through these phases in batches of the chunks nearest to the focus.
+ * A batch is completed in the same tick once it is rasterized, so the navmesh is usable in-between ticks, growing outward from the focus.
+ */
+class RSAPSHARED_API FRsapGenerationJob
+{
+public:
+	/**
+	 * Clears the navmesh, and gathers the work from all the actors in the world.
+	 * The components are referenced by their handle, so any component that is removed before it is rasterized is skipped.
+	 *
+	 * @param ThreadCount Amount of threads to rasterize on, which uses every worker-thread when zero. The result is the same for any amount.
+	 */
+	FRsapGenerationJob(FRsapNavmesh& InNavMesh, const IRsapWorld* RsapWorld, ERsapNodeOrder InNodeOrder = ERsapNodeOrder::Morton, int32 InThreadCount = 0);
+
+	/**
+	 * Regenerates only the given chunks, from the actors that intersect them, and keeps the rest of the navmesh.
+	 * The chunks are erased first. Any of them that is not occluded anymore stays erased, and the borders of the chunks around it are stitched again on completion.
+	 * The chunks are marked as updated or deleted, so that they are serialized on the next save.
+	 */
+	FRsapGenerationJob(FRsapNavmesh& InNavMesh, const IRsapWorld* RsapWorld, const std::vector<chunk_morton>& ChunkMCs,
+	                   ERsapNodeOrder InNodeOrder = ERsapNodeOrder::Morton, int32 InThreadCount = 0);
+
+	FRsapGenerationJob(const FRsapGenerationJob&) = delete;
+	FRsapGenerationJob& operator=(const FRsapGenerationJob&) = delete;
+
+	/**
+	 * Continues the generation until it is complete, or until the budget has been used.
+	 * The budget is checked in-between chunks, so a slice exceeds it by at most the time it takes to process a single chunk on each thread.
+	 *
+	 * @return True when the generation is complete.
+	 */
+	bool Tick(double BudgetSeconds = std::numeric_limits<double>::infinity());
+
+	FORCEINLINE bool IsComplete() const { return Phase == EPhase::Complete; }
+
+	/**
+	 * Generates the chunks nearest to this location first, such as the camera. Can be moved during the job.
+	 * Reorders the chunks that are not rasterized yet, which is skipped for small moves.
+	 */
+	void SetFocus(const FVector& Location);
+
+	// Between 0 and 1, where each phase of a batch takes an equal part.
+	float GetProgress() const;
+	const TCHAR* GetPhaseName() const;
+
+	// Amount of batches that have been completed, which are usable when the job has a focus.
+	FORCEINLINE uint32 GetCompletedBatchCount() const { return CompletedBatchCount; }
+
+private:
+	enum class EPhase : uint8
+	{
+		Rasterize, Build, Relations, Stitch, Complete
+	};
+
+	// Part of a component that intersects a chunk.
+	struct FChunkPart
+	{
+		FRsapCollisionComponentHandle Component;
+		FRsapBounds Intersection;
+		actor_key ActorKey;
+	};
+
+	struct FChunkTask
+	{
+		chunk_morton ChunkMC;
+		std::vector<FChunkPart> Parts;
+		FRsapOctreeBuilder Builder;
+		std::vector<actor_key> Actors; // Every actor that has a part in this chunk.
+		std::vector<actor_key> OccludingActors;
+	};
+
+	// An actor whose chunks are not all built yet. Its hash is added to the navmesh once they are.
+	struct FPendingActor
+	{
+		uint64 CollisionHash;
+		uint32 RemainingChunkCount;
+	};
+
+	// Amount of chunks in a batch, for each thread, when the job has a focus.
+	static constexpr int32 BatchSizePerThread = 4;
+
+	FRsapNavmesh& NavMesh;
+	ERsapNodeOrder NodeOrder;
+	int32 ThreadCount;
+
+	bool bHasFocus = false;
+	bool bFocusMoved = false;
+	FVector Focus;
+
+	// The chunks to regenerate, which is every chunk when empty.
+	std::unordered_set<chunk_morton> RegeneratedChunkMCs;
+
+	EPhase Phase = EPhase::Rasterize;
+	int32 NextIdx = 0; // Index of the next task or chunk to process within the current phase.
+	std::vector<FChunkTask> ChunkTasks;
+	Rsap::Map::flat_map<actor_key, FPendingActor> PendingActors;
+	int32 BatchBegin = 0; // Range of the tasks in the current batch, which are all the tasks when the job has no focus.
+	int32 BatchEnd = 0;
+	uint32 CompletedBatchCount = 0;
+
+	// The initialized chunks of the batch, gathered when the build is complete.
+	// The stitch-phase adds the neighbouring chunks from earlier batches, whose borders have changed.
+	std::vector<std::pair<chunk_morton, FRsapChunk*>> Chunks;
+
+	// Whether the current phase changes the navmesh, which has to be completed without interruption when the job has a focus.
+	FORCEINLINE bool IsPublishing() const { return bHasFocus && Phase != EPhase::Rasterize && Phase != EPhase::Complete; }
+
+	void GatherTasks(const IRsapWorld* RsapWorld);
+	void RasterizeChunk(FChunkTask& ChunkTask) const;
+	void BuildChunk(FChunkTask& ChunkTask);
+	void StartBatch();
+	void NextPhase();
+};
@@ -0,0 +1,77 @@
+﻿// Copyright Melvin Brink 2023. All Rights Reserved.
+
+#pragma once
+#include "Rsap/Definitions.h"
+#include "Rsap/NavMesh/Types/Chunk.h"
+#include <algorithm>
+#include <array>
+#include <vector>
+
+
+
+/**
+ * Builds an octree bottom-up from the nodes that are occupied, instead of initializing every node and walking up its parents one at a time.
+ *
+ * The occupied nodes can be added in any order, and can contain duplicates. ::Build radix-sorts and dedupes them per layer,
+ * and then walks up the layers once: consecutive nodes with the same parent are merged into the Children mask of that parent.
+ * Every layer comes out in morton-order, so the nodes are appended to the layers of the octree instead of being inserted in-between.
+ */
+class RSAPSHARED_API FRsapOctreeBuilder
+{
+public:
+	typedef THighResSparseOctree<FRsapNode> FOctree;
+
+	// Deepest layer of the normal nodes. The leaf-nodes are in the layer below it.
+	static inline constexpr layer_idx DeepestLayerIdx = std::tuple_size_v<decltype(FOctree::Layers)> - 1;
+
+	// Adds a node that is occupied. Its parents are created while building.
+	FORCEINLINE void AddNode(const node_morton NodeMC, const layer_idx LayerIdx)
+	{
+		check(LayerIdx <= DeepestLayerIdx);
+		NodeLayers[LayerIdx].push_back(NodeMC);
+	}
+
+	// Adds a leaf-node with its occupied leafs. The leafs of duplicate leaf-nodes are combined.
+	FORCEINLINE void AddLeafNode(const node_morton NodeMC, const uint64 Leafs)
+	{
+		LeafNodes.push_back({NodeMC, Leafs});
+	}
+
+	FORCEINLINE bool IsEmpty() const
+	{
+		return LeafNodes.empty() && std::ranges::all_of(NodeLayers, [](const std::vector<node_morton>& Nodes){ return Nodes.empty(); });
+	}
+
+	/**
+	 * Replaces the nodes of the octree with the added ones. This resets the builder, but it keeps its memory for the next octree.
+	 * Only the Children masks are set. The relations are left to the caller, which can set them once the neighbouring octrees are built as well.
+	 */
+	void Build(FOctree& Octree);
+
+	// Removes the added nodes without building them.
+	void Reset();
+
+private:
+	struct FLeafNode
+	{
+		node_morton NodeMC;
+		uint64 Leafs;
+	};
+
+	struct FParentNode
+	{
+		node_morton NodeMC;
+		uint8 Children;
+	};
+
+	std::array<std::vector<node_morton>, DeepestLayerIdx+1> NodeLayers;
+	std::vector<FLeafNode> LeafNodes;
+
+	// Reused between builds.
+	std::vector<node_morton> NodeScratch;
+	std::vector<FLeafNode> LeafScratch;
+	std::vector<FParentNode> Parents;
+	std::vector<FParentNode> NextParents;
+
+	static void AddToParent(std::vector<FParentNode>& OutParents, node_morton NodeMC, layer_idx LayerIdx);
+};
@@ -3,109 +3,152 @@
 #pragma once
 
 #include <ranges>
-#include <unordered_set>
+#include <algorithm>
+#include <array>
+#include <memory>
+#include <vector>
 #include "Rsap/Definitions.h"
 #include "Rsap/Math/Bounds.h"
+#include "Rsap/Math/TriangleBVH.h"
+#include "Components/StaticMeshComponent.h"
+#include "Engine/StaticMesh.h"
+#include "Hash/CityHash.h"
 
 
 
 class RSAPSHARED_API FRsapCollisionComponent
 {
-	friend class FRsapActor; // Owns the components.
-	friend class FRsapNavmeshUpdater; // Co-owner if processing dirty nodes.
+	friend class FRsapActor; // Tracks the components of its actor, which are owned by the FRsapCollisionComponentRegistry.
+	friend class FRsapNavmeshUpdater; // Reads the dirty-nodes when staging the component, and creates empty snapshots for deleted ones.
 	
 	TWeakObjectPtr<UPrimitiveComponent> PrimitiveComponent;
 	uint16 SoundPresetID = 0;
 
 	FTransform Transform;
 	FRsapBounds Boundaries;
+	std::shared_ptr<const FRsapTriangleBVH> TriangleBVH; // Shared by all components using the same static-mesh, nullptr if there is none.
+
+	// Morton-codes of the nodes per layer, each sorted so that they can be compared using a linear merge.
+	// Cleared layers keep their memory, so a component that keeps moving reuses the same arrays instead of allocating new ones.
+	struct FNodeLayers
+	{
+		std::array<std::vector<node_morton>, Layer::Total> Layers;
+
+		FORCEINLINE std::vector<node_morton>& operator[](const layer_idx LayerIdx) { return Layers[LayerIdx]; }
+		FORCEINLINE const std::vector<node_morton>& operator[](const layer_idx LayerIdx) const { return Layers[LayerIdx]; }
+
+		FORCEINLINE bool IsEmpty() const
+		{
+			return std::ranges::all_of(Layers, [](const std::vector<node_morton>& Nodes){ return Nodes.empty(); });
+		}
+
+		// Runs the callback for each layer that has any nodes.
+		template<typename Func>
+		FORCEINLINE void ForEachLayer(Func Callback) const
+		{
+			for (layer_idx LayerIdx = 0; LayerIdx < Layer::Total; ++LayerIdx)
+			{
+				if(!Layers[LayerIdx].empty()) Callback(LayerIdx, Layers[LayerIdx]);
+			}
+		}
+	};
 
 	// Stores nodes associated with this component within a chunk.
 	struct FChunk
 	{
-		typedef Rsap::Map::flat_map<layer_idx, std::unordered_set<node_morton>> FLayer;
-		
 		layer_idx IntersectedNodesLayer = Layer::Empty;
-		std::unordered_set<node_morton> IntersectedNodes;
+		std::vector<node_morton> IntersectedNodes;
+		bool bIsIntersected = false; // If the component intersected this chunk during the last update.
 
 		// Holds the owning-nodes, which are the nodes that were intersecting with the component's boundaries at the moment said nodes were being rasterized.
-		FLayer OwningLayers;
+		FNodeLayers OwningLayers;
 
 		// Holds the dirty-nodes, which exists of the owning nodes + the latest intersected nodes, which need to be processed/re-rasterized by the updater.
-		FLayer DirtyLayers;
+		FNodeLayers DirtyLayers;
 		
 		// These nodes are the nodes that have been staged on the dirty-navmesh, but can be removed from it since they don't have to be processed anymore.
 		// Explanation: when a component moves, any non-owning dirty-nodes that don't intersect with the component anymore can be cleared from the dirty-navmesh. This is because they don't have to be processed/re-rasterized by the updater anymore.
 		// This makes it so that a single object that moves a lot, won't cause large portions of the navmesh to become and 'stay' dirty. This keeps the update time constant to how many objects 'have' moved instead of how 'much' the objects have moved in total.
 		// Note that other components can own the same node. Just the reference to this component on said node on the dirty-navmesh will be removed, and said node will be cleared from it if it holds no references to any components.
-		FLayer StagedNodesToClear;
+		FNodeLayers StagedNodesToClear;
 
-		FChunk(const std::unordered_set<node_morton>& IntersectedNodes, const layer_idx LayerIdx)
+		// Updates the intersecting-nodes, which should be sorted, and in-turn updates the different type of layers.
+		void SetIntersectedNodes(const std::vector<node_morton>& NewIntersectedNodes, const layer_idx LayerIdx)
 		{
-			SetIntersectedNodes(IntersectedNodes, LayerIdx);
-		}
-
-		// Updates the intersecting-nodes and in-turn updates the different type of layers.
-		void SetIntersectedNodes(const std::unordered_set<node_morton>& NewIntersectedNodes, const layer_idx LayerIdx)
-		{
-			// Update intersected-nodes and clear the current dirty-layers.
-			IntersectedNodes = NewIntersectedNodes;
+			// The old dirty-layers are swapped into a buffer that is reused by every chunk, and the current buffer becomes the new dirty-layers.
+			// Components are only tracked on the game-thread, so these buffers are shared.
+			static FNodeLayers OldDirtyLayers;
+			static std::vector<node_morton> NodesToStage;
+			static std::vector<node_morton> MergedNodes;
+			check(IsInGameThread());
+			std::swap(DirtyLayers, OldDirtyLayers);
+			
+			IntersectedNodes.assign(NewIntersectedNodes.begin(), NewIntersectedNodes.end());
 			IntersectedNodesLayer = LayerIdx;
-			auto OldDirtyLayers = std::move(DirtyLayers);
 
-			// Set the dirty-layers to be the same as the owning-layers + the new intersected-nodes.
-			DirtyLayers = OwningLayers;
-			if(!NewIntersectedNodes.empty()) DirtyLayers[LayerIdx].insert(IntersectedNodes.begin(), IntersectedNodes.end());
-
-			// Any non-owning dirty-nodes can be staged for removal from the dirty-navmesh.
-			// To get these we simply check the dirty-nodes in the old-layers, and stage the ones that do not exist on any new-layers.
-			for (const auto& [OldLayerIdx, OldDirtyNodes] : OldDirtyLayers)
+			for (layer_idx CurrentLayerIdx = 0; CurrentLayerIdx < Layer::Total; ++CurrentLayerIdx)
 			{
-				const auto Iterator = DirtyLayers.find(OldLayerIdx);
-				if(Iterator == DirtyLayers.end())
-				{
-					// The new-layer doesn't exist, so all the dirty-nodes in this old-layer can be staged for removal.
-					StagedNodesToClear[OldLayerIdx].insert(OldDirtyNodes.begin(), OldDirtyNodes.end());
-					continue;
-				}
-
-				// The new-layer exists, so check each dirty-node in the old-layer, and stage it for removal if it does not exist in the new-layer.
-				const auto& DirtyLayer = Iterator->second;
-				for (const node_morton NodeMC : OldDirtyNodes)
-				{
-					if(!DirtyLayer.contains(NodeMC)) StagedNodesToClear[OldLayerIdx].insert(NodeMC);
-				}
+				// Set the dirty-layers to be the same as the owning-layers + the new intersected-nodes.
+				std::vector<node_morton>& DirtyLayer = DirtyLayers[CurrentLayerIdx];
+				const std::vector<node_morton>& OwningLayer = OwningLayers[CurrentLayerIdx];
+				DirtyLayer.clear();
+				if(CurrentLayerIdx == LayerIdx) std::ranges::set_union(OwningLayer, IntersectedNodes, std::back_inserter(DirtyLayer));
+				else DirtyLayer.assign(OwningLayer.begin(), OwningLayer.end());
+
+				// Any non-owning dirty-nodes can be staged for removal from the dirty-navmesh.
+				// These are the dirty-nodes in the old-layer that do not exist in the new-layer.
+				const std::vector<node_morton>& OldDirtyLayer = OldDirtyLayers[CurrentLayerIdx];
+				if(OldDirtyLayer.empty()) continue;
+				NodesToStage.clear();
+				std::ranges::set_difference(OldDirtyLayer, DirtyLayer, std::back_inserter(NodesToStage));
+				if(NodesToStage.empty()) continue;
+
+				std::vector<node_morton>& StagedLayer = StagedNodesToClear[CurrentLayerIdx];
+				MergedNodes.clear();
+				std::ranges::set_union(StagedLayer, NodesToStage, std::back_inserter(MergedNodes));
+				std::swap(StagedLayer, MergedNodes);
 			}
 		}
 
 		// Clears the intersecting-nodes and in-turn updates the different type of layers.
 		void ClearIntersectedNodes()
 		{
-			SetIntersectedNodes(std::unordered_set<node_morton>(), Layer::Empty);
+			SetIntersectedNodes({}, Layer::Empty);
 		}
 
 		bool IsEmpty() const
 		{
-			return IntersectedNodes.empty() && OwningLayers.empty() &&
-				   DirtyLayers.empty() && StagedNodesToClear.empty();
+			return IntersectedNodes.empty() && OwningLayers.IsEmpty() &&
+				   DirtyLayers.IsEmpty() && StagedNodesToClear.IsEmpty();
 		}
 	};
 	Rsap::Map::flat_map<chunk_morton, FChunk> TrackedChunks;
 
+	// Set when the boundaries have changed since the chunks were tracked.
+	// The chunks are only tracked again once the dirty-nodes are read, so a component that changes many times before it is staged is only tracked once.
+	bool bIsTrackingOutdated = false;
+
+	FRsapCollisionComponent() = default;
+
 	// Synchronizes the values with the PrimitiveComponent.
 	void Sync()
 	{
+		const FRsapBounds PrevBoundaries = Boundaries;
 		if(PrimitiveComponent.IsValid())
 		{
 			Transform = PrimitiveComponent->GetComponentTransform();
 			Boundaries = FRsapBounds(PrimitiveComponent.Get());
-			UpdateTrackedChunks();
-			return;
+			TriangleBVH = FRsapTriangleBVH::Find(PrimitiveComponent.Get());
 		}
-		
-		Transform = FTransform::Identity;
-		Boundaries = FRsapBounds();
-		UpdateTrackedChunks();
+		else
+		{
+			Transform = FTransform::Identity;
+			Boundaries = FRsapBounds();
+			TriangleBVH.reset();
+		}
+
+		// The tracked nodes only depend on the boundaries.
+		if(!Boundaries.Equals(PrevBoundaries)) bIsTrackingOutdated = true;
 	}
 
 	// Returns true if there was a change.
@@ -117,44 +160,47 @@ class RSAPSHARED_API FRsapCollisionComponent
 			return true;
 		}
 		
-		if(Transform.Equals(PrimitiveComponent->GetComponentTransform())) return false; // todo: Later try switching to checking the boundaries instead, and see if it still accurately updates the navmesh.
+		// The BVH changes when the component has been given another mesh, or when the cache of its mesh has been invalidated.
+		if(Transform.Equals(PrimitiveComponent->GetComponentTransform()) && TriangleBVH == FRsapTriangleBVH::Find(PrimitiveComponent.Get())) return false; // todo: Later try switching to checking the boundaries instead, and see if it still accurately updates the navmesh.
 		Sync();
 		return true;
 	}
 
+	// Reused for the intersected-nodes of every chunk, so that tracking the chunks does not allocate once it has grown large enough. Only used on the game-thread.
+	static std::vector<node_morton>& GetIntersectedNodesBuffer()
+	{
+		check(IsInGameThread());
+		static std::vector<node_morton> IntersectedNodes;
+		return IntersectedNodes;
+	}
+
 	void UpdateTrackedChunks()
 	{
+		bIsTrackingOutdated = false;
 		const layer_idx OptimalLayer = Boundaries.GetOptimalRasterizationLayer();
-		std::unordered_set<chunk_morton> IntersectedChunks;
+		std::vector<node_morton>& IntersectedNodes = GetIntersectedNodesBuffer();
+		for (FChunk& TrackedChunk : TrackedChunks | std::views::values) TrackedChunk.bIsIntersected = false;
 
 		FlushPersistentDebugLines(GEditor->GetEditorWorldContext().World());// todo remove
 
 		// For each new-chunk the boundaries are intersecting.
 		Boundaries.ForEachChunk([&](const chunk_morton ChunkMC, const FRsapVector32& ChunkLocation, const FRsapBounds& Intersection)
 		{
-			IntersectedChunks.emplace(ChunkMC);
-			
-			const auto& TrackedChunkIterator = TrackedChunks.find(ChunkMC);
-			const auto IntersectedNodes = Intersection.GetIntersectingNodes(OptimalLayer);
+			Intersection.GetIntersectingNodes(OptimalLayer, IntersectedNodes);
 
 			// todo this is debug so remove
 			FRsapBounds::FromChunkMorton(ChunkMC).Draw(GEditor->GetEditorWorldContext().World(), FColor::Black, 5);
-			
-			if(TrackedChunkIterator == TrackedChunks.end())
-			{
-				// This chunk is not yet tracked.
-				TrackedChunks.emplace(ChunkMC, FChunk(IntersectedNodes, OptimalLayer));
-				return;
-			}
 
-			// Already tracked, so update it with the new intersected-nodes.
-			TrackedChunkIterator->second.SetIntersectedNodes(IntersectedNodes, OptimalLayer); 
+			// Track the chunk if it isn't already, and update it with the new intersected-nodes.
+			FChunk& TrackedChunk = TrackedChunks.try_emplace(ChunkMC).first->second;
+			TrackedChunk.SetIntersectedNodes(IntersectedNodes, OptimalLayer);
+			TrackedChunk.bIsIntersected = true;
 		});
 
 		// Clear the intersected-nodes on each tracked-chunk that is not currently intersected.
 		for (auto It = TrackedChunks.begin(); It != TrackedChunks.end();)
 		{
-			if (!IntersectedChunks.contains(It->first))
+			if (!It->second.bIsIntersected)
 			{
 				auto& TrackedChunk = It->second;
 				TrackedChunk.ClearIntersectedNodes();
@@ -172,15 +218,31 @@ class RSAPSHARED_API FRsapCollisionComponent
 
 public:
 	explicit FRsapCollisionComponent(UPrimitiveComponent* Component)
-		: PrimitiveComponent(Component), Transform(Component->GetComponentTransform()), Boundaries(Component)
+		: PrimitiveComponent(Component), Transform(Component->GetComponentTransform()), Boundaries(Component), TriangleBVH(FRsapTriangleBVH::Find(Component))
 	{
 		const layer_idx OptimalLayer = Boundaries.GetOptimalRasterizationLayer();
+		std::vector<node_morton>& IntersectedNodes = GetIntersectedNodesBuffer();
 		Boundaries.ForEachChunk([&](const chunk_morton ChunkMC, const FRsapVector32& ChunkLocation, const FRsapBounds& Intersection)
 		{
-			TrackedChunks.emplace(ChunkMC, FChunk(Intersection.GetIntersectingNodes(OptimalLayer), OptimalLayer));
+			Intersection.GetIntersectingNodes(OptimalLayer, IntersectedNodes);
+			FChunk& TrackedChunk = TrackedChunks.try_emplace(ChunkMC).first->second;
+			TrackedChunk.SetIntersectedNodes(IntersectedNodes, OptimalLayer);
+			TrackedChunk.bIsIntersected = true;
 		});
 	}
 
+	// Copy of the synced state without the tracked chunks, which can be read on another thread while this component keeps changing.
+	FRsapCollisionComponent GetSnapshot() const
+	{
+		FRsapCollisionComponent Snapshot;
+		Snapshot.PrimitiveComponent = PrimitiveComponent;
+		Snapshot.SoundPresetID = SoundPresetID;
+		Snapshot.Transform = Transform;
+		Snapshot.Boundaries = Boundaries;
+		Snapshot.TriangleBVH = TriangleBVH;
+		return Snapshot;
+	}
+
 	// bool IsValid() const { return PrimitiveComponent.IsValid(); }
 	const UPrimitiveComponent* operator*() const { return PrimitiveComponent.Get(); }
 
@@ -191,15 +253,15 @@ public:
 		const UWorld* World = PrimitiveComponent->GetWorld();
 		FlushPersistentDebugLines(World);
 
-		auto DrawLayers = [&](const Rsap::Map::flat_map<layer_idx, std::unordered_set<node_morton>>& Layers, const FRsapVector32& ChunkLocation, const FColor Color)
+		auto DrawLayers = [&](const FNodeLayers& Layers, const FRsapVector32& ChunkLocation, const FColor Color)
 		{
-			for (const auto& [LayerIdx, Nodes] : Layers)
+			Layers.ForEachLayer([&](const layer_idx LayerIdx, const std::vector<node_morton>& Nodes)
 			{
 				for (const node_morton NodeMC : Nodes)
 				{
 					FRsapBounds::FromNodeMorton(NodeMC, LayerIdx, ChunkLocation).Draw(World, Color, 10);
 				}
-			}
+			});
 		};
 		
 		for (const auto& [ChunkMC, Chunk] : TrackedChunks)
@@ -224,24 +286,144 @@ public:
 		static_assert(std::is_invocable_v<TCallback, chunk_morton, node_morton, layer_idx>,
 		"ForEachDirtyNode: TCallback signature must match (chunk_morton, node_morton, layer_idx)");
 
+		if(bIsTrackingOutdated) UpdateTrackedChunks();
 		for (auto& [ChunkMC, TrackedChunk] : TrackedChunks)
 		{
-			for (auto& [LayerIdx, DirtyLayer] : TrackedChunk.DirtyLayers)
+			TrackedChunk.DirtyLayers.ForEachLayer([&, ChunkMC = ChunkMC](const layer_idx LayerIdx, const std::vector<node_morton>& DirtyLayer)
 			{
-				for (node_morton NodeMC : DirtyLayer)
+				for (const node_morton NodeMC : DirtyLayer)
 				{
 					Callback(ChunkMC, NodeMC, LayerIdx);
 				}
-			}
+			});
+		}
+	}
+
+	/**
+	 * Hash of the synced state of this component, which stays the same across sessions as long as it has not changed.
+	 * Shapes are described by their transform and boundaries, meshes also by the path of their static-mesh.
+	 */
+	uint64 GetCollisionHash() const
+	{
+		const FVector Location = Transform.GetLocation();
+		const FQuat Rotation = Transform.GetRotation();
+		const FVector Scale = Transform.GetScale3D();
+		const double TransformValues[] = {Location.X, Location.Y, Location.Z, Rotation.X, Rotation.Y, Rotation.Z, Rotation.W, Scale.X, Scale.Y, Scale.Z};
+		const int32 BoundaryValues[] = {Boundaries.Min.X, Boundaries.Min.Y, Boundaries.Min.Z, Boundaries.Max.X, Boundaries.Max.Y, Boundaries.Max.Z};
+
+		uint64 Hash = CityHash64(reinterpret_cast<const char*>(TransformValues), sizeof(TransformValues));
+		Hash = CityHash64WithSeed(reinterpret_cast<const char*>(BoundaryValues), sizeof(BoundaryValues), Hash);
+		if(const UStaticMeshComponent* StaticMeshComponent = Cast<UStaticMeshComponent>(PrimitiveComponent.Get()); StaticMeshComponent && StaticMeshComponent->GetStaticMesh())
+		{
+			const FString MeshPath = StaticMeshComponent->GetStaticMesh()->GetPathName();
+			Hash = CityHash64WithSeed(reinterpret_cast<const char*>(*MeshPath), MeshPath.Len() * sizeof(TCHAR), Hash);
 		}
+		return Hash;
 	}
 
 	const FRsapBounds& GetBoundaries() const { return Boundaries; }
+	const FTransform& GetTransform() const { return Transform; }
+	const FRsapTriangleBVH* GetTriangleBVH() const { return TriangleBVH.get(); }
+
+	// True if rasterizing this component queries the physics-scene, which is the case for simple tests unless its triangles are also its simple-collision.
+	bool NeedsPhysicsScene() const { return !TriangleBVH || !TriangleBVH->IsSimpleCollision(); }
 	UPrimitiveComponent* GetPrimitive() const { return PrimitiveComponent.Get(); }
 };
 
-typedef Rsap::Map::flat_map<const UPrimitiveComponent*, std::shared_ptr<FRsapCollisionComponent>> FRsapCollisionComponentMap;
-typedef std::weak_ptr<FRsapCollisionComponent> FRsapCollisionComponentPtr;
+/**
+ * 32-bit handle to a collision-component within the FRsapCollisionComponentRegistry.
+ * The lower bits hold the index of the slot, and the upper bits hold the generation of the slot when the handle was created.
+ * Releasing a component increments the generation of its slot, so any handle that is still around will no longer resolve.
+ */
+struct FRsapCollisionComponentHandle
+{
+	static inline constexpr uint8  IndexBits = 24;
+	static inline constexpr uint32 IndexMask = (1u << IndexBits) - 1;
+
+	uint32 Packed = 0; // Generations start at 1, so a zeroed handle is never valid.
+
+	FRsapCollisionComponentHandle() = default;
+	FRsapCollisionComponentHandle(const uint32 Index, const uint8 Generation)
+		: Packed(Index | static_cast<uint32>(Generation) << IndexBits) {}
+
+	FORCEINLINE uint32 GetIndex() const { return Packed & IndexMask; }
+	FORCEINLINE uint8 GetGeneration() const { return static_cast<uint8>(Packed >> IndexBits); }
+	FORCEINLINE bool IsSet() const { return Packed != 0; }
+	FORCEINLINE bool operator==(const FRsapCollisionComponentHandle& Other) const { return Packed == Other.Packed; }
+
+	struct FHash
+	{
+		using is_avalanching = void;
+		FORCEINLINE uint64 operator()(const FRsapCollisionComponentHandle Handle) const noexcept
+		{
+			return ankerl::unordered_dense::detail::wyhash::hash(Handle.Packed);
+		}
+	};
+};
+
+/**
+ * Owns every collision-component, and hands out generational handles to them.
+ * The handles are plain integers, so they can be copied into the dirty-nodes without any reference-counting.
+ *
+ * Slots of released components are reused, and the components themselves never move, so a resolved pointer stays valid until the component is released.
+ * Only use the registry from the game-thread.
+ */
+class RSAPSHARED_API FRsapCollisionComponentRegistry
+{
+	struct FSlot
+	{
+		std::unique_ptr<FRsapCollisionComponent> Component;
+		uint8 Generation = 1;
+	};
+
+	std::vector<FSlot> Slots;
+	std::vector<uint32> FreeSlots;
+
+public:
+	static FRsapCollisionComponentRegistry& Get();
+
+	FRsapCollisionComponentHandle Create(UPrimitiveComponent* PrimitiveComponent)
+	{
+		uint32 Index;
+		if(FreeSlots.empty())
+		{
+			check(Slots.size() <= FRsapCollisionComponentHandle::IndexMask);
+			Index = static_cast<uint32>(Slots.size());
+			Slots.emplace_back();
+		}
+		else
+		{
+			Index = FreeSlots.back();
+			FreeSlots.pop_back();
+		}
+
+		FSlot& Slot = Slots[Index];
+		Slot.Component = std::make_unique<FRsapCollisionComponent>(PrimitiveComponent);
+		return FRsapCollisionComponentHandle(Index, Slot.Generation);
+	}
+
+	// Destroys the component, and invalidates all the handles to it.
+	void Release(const FRsapCollisionComponentHandle Handle)
+	{
+		if(!Find(Handle)) return;
+		FSlot& Slot = Slots[Handle.GetIndex()];
+		Slot.Component.reset();
+		if(++Slot.Generation == 0) Slot.Generation = 1;
+		FreeSlots.emplace_back(Handle.GetIndex());
+	}
+
+	// Returns nullptr if the component has been released.
+	FORCEINLINE FRsapCollisionComponent* Find(const FRsapCollisionComponentHandle Handle) const
+	{
+		const uint32 Index = Handle.GetIndex();
+		if(Index >= Slots.size() || Slots[Index].Generation != Handle.GetGeneration()) return nullptr;
+		return Slots[Index].Component.get();
+	}
+
+	FORCEINLINE size_t Num() const { return Slots.size() - FreeSlots.size(); }
+};
+
+typedef Rsap::Map::flat_map<const UPrimitiveComponent*, FRsapCollisionComponentHandle> FRsapCollisionComponentMap;
 
 // The action that has happened on the wrapped primitive-component.
 enum class ERsapCollisionComponentChangedType
@@ -252,12 +434,19 @@ enum class ERsapCollisionComponentChangedType
 struct RSAPSHARED_API FRsapCollisionComponentChangedResult
 {
 	const ERsapCollisionComponentChangedType Type;
-	const std::shared_ptr<FRsapCollisionComponent> Component;
+	const FRsapCollisionComponentHandle Component;
+	const actor_key ActorKey; // Of the actor owning the component, which is also known after the actor has been deleted.
 
 	FRsapCollisionComponentChangedResult(
-		const ERsapCollisionComponentChangedType InType, const std::shared_ptr<FRsapCollisionComponent>& InComponent)
-		: Type(InType), Component(InComponent)
+		const ERsapCollisionComponentChangedType InType, const FRsapCollisionComponentHandle InComponent, const actor_key InActorKey)
+		: Type(InType), Component(InComponent), ActorKey(InActorKey)
 	{}
+
+	// Deleted components can still be resolved until the next time their actor syncs, see FRsapActor::DetectAndSyncChanges.
+	FORCEINLINE FRsapCollisionComponent* GetComponent() const
+	{
+		return FRsapCollisionComponentRegistry::Get().Find(Component);
+	}
 };
 
 /**
@@ -267,28 +456,45 @@ struct RSAPSHARED_API FRsapCollisionComponentChangedResult
 class RSAPSHARED_API FRsapActor
 {
 	TWeakObjectPtr<const AActor> ActorPtr;
+	actor_key ActorKey; // Cached, so that it is still known after the actor has been deleted.
 	FRsapCollisionComponentMap CollisionComponents;
+	std::vector<FRsapCollisionComponentHandle> ComponentsToRelease; // Deleted components, kept alive until the next sync so that the listeners can still read them.
 	bool bIsStatic = true;
 
+	void ReleaseDeletedComponents()
+	{
+		FRsapCollisionComponentRegistry& Registry = FRsapCollisionComponentRegistry::Get();
+		for (const FRsapCollisionComponentHandle Handle : ComponentsToRelease) Registry.Release(Handle);
+		ComponentsToRelease.clear();
+	}
+
 public:
 	explicit FRsapActor(const AActor* Actor)
 	{
 		ActorPtr = Actor;
+		ActorKey = GetTypeHash(Actor->GetActorGuid());
 
 		// Init the collision-components.
+		FRsapCollisionComponentRegistry& Registry = FRsapCollisionComponentRegistry::Get();
 		for (UPrimitiveComponent* PrimitiveComponent : GetPrimitiveComponents())
 		{
-			CollisionComponents.emplace(PrimitiveComponent, std::make_shared<FRsapCollisionComponent>(PrimitiveComponent));
+			CollisionComponents.emplace(PrimitiveComponent, Registry.Create(PrimitiveComponent));
 		}
 	}
 
-	const AActor* GetActor() const { return ActorPtr.Get(); }
-	actor_key GetActorKey() const
+	FRsapActor(const FRsapActor&) = delete;
+	FRsapActor& operator=(const FRsapActor&) = delete;
+
+	~FRsapActor()
 	{
-		if(!ActorPtr.IsValid()) return 0;
-		return GetTypeHash(ActorPtr->GetActorGuid());
+		ComponentsToRelease.reserve(ComponentsToRelease.size() + CollisionComponents.size());
+		for (const FRsapCollisionComponentHandle Handle : CollisionComponents | std::views::values) ComponentsToRelease.emplace_back(Handle);
+		ReleaseDeletedComponents();
 	}
 
+	const AActor* GetActor() const { return ActorPtr.Get(); }
+	actor_key GetActorKey() const { return ActorKey; }
+
 	std::vector<UPrimitiveComponent*> GetPrimitiveComponents() const
 	{
 		std::vector<UPrimitiveComponent*> Result;
@@ -303,26 +509,43 @@ public:
 		return Result;
 	}
 
-	std::vector<std::shared_ptr<FRsapCollisionComponent>> GetCollisionComponents()
+	std::vector<FRsapCollisionComponentHandle> GetCollisionComponents() const
 	{
-		std::vector<std::shared_ptr<FRsapCollisionComponent>> Result;
-		for (const auto& CollisionComponent : CollisionComponents | std::views::values) Result.emplace_back(CollisionComponent);
+		std::vector<FRsapCollisionComponentHandle> Result;
+		Result.reserve(CollisionComponents.size());
+		for (const FRsapCollisionComponentHandle Handle : CollisionComponents | std::views::values) Result.emplace_back(Handle);
 		return Result;
 	}
 
 	bool HasAnyCollisionComponent() const { return !CollisionComponents.empty(); }
+
+	// Hash of all the collision-components, which is used to check if the navmesh is in-sync with this actor. See FRsapCollisionComponent::GetCollisionHash.
+	uint64 GetCollisionHash() const
+	{
+		// Summed, so that it does not depend on the order of the components.
+		const FRsapCollisionComponentRegistry& Registry = FRsapCollisionComponentRegistry::Get();
+		uint64 Hash = CollisionComponents.size();
+		for (const FRsapCollisionComponentHandle Handle : CollisionComponents | std::views::values)
+		{
+			if(const FRsapCollisionComponent* CollisionComponent = Registry.Find(Handle)) Hash += CollisionComponent->GetCollisionHash();
+		}
+		return Hash;
+	}
 	
 	std::vector<FRsapCollisionComponentChangedResult> DetectAndSyncChanges()
 	{
 	    std::vector<FRsapCollisionComponentChangedResult> ChangedResults;
+		ReleaseDeletedComponents();
+		FRsapCollisionComponentRegistry& Registry = FRsapCollisionComponentRegistry::Get();
 
 	    if (!ActorPtr.IsValid())
 	    {
 	    	// Actor is invalid so we can pass all components to the result as 'deleted'.
-	        for (const auto& CollisionComponent : CollisionComponents | std::views::values)
+	        for (const FRsapCollisionComponentHandle Handle : CollisionComponents | std::views::values)
 	        {
-	        	CollisionComponent->Sync();
-	            ChangedResults.emplace_back(FRsapCollisionComponentChangedResult(ERsapCollisionComponentChangedType::Deleted, CollisionComponent));
+	        	Registry.Find(Handle)->Sync();
+	            ChangedResults.emplace_back(FRsapCollisionComponentChangedResult(ERsapCollisionComponentChangedType::Deleted, Handle, ActorKey));
+	        	ComponentsToRelease.emplace_back(Handle);
 	        }
 
 	        CollisionComponents.clear();
@@ -330,20 +553,22 @@ public:
 	    }
 
 		// Check the cached collision-components for any changes.
-	    for (const auto& CollisionComponent : CollisionComponents | std::views::values)
+	    for (const FRsapCollisionComponentHandle Handle : CollisionComponents | std::views::values)
 	    {
+	    	FRsapCollisionComponent* CollisionComponent = Registry.Find(Handle);
+
 	    	// Check if the wrapped primitive has been deleted.
 		    if(!CollisionComponent->PrimitiveComponent.IsValid())
 		    {
 		    	CollisionComponent->Sync();
-		    	ChangedResults.emplace_back(FRsapCollisionComponentChangedResult(ERsapCollisionComponentChangedType::Deleted, CollisionComponent));
+		    	ChangedResults.emplace_back(FRsapCollisionComponentChangedResult(ERsapCollisionComponentChangedType::Deleted, Handle, ActorKey));
 		    	continue;
 		    }
 
 	    	// Check if the transform has changed.
 	    	if(CollisionComponent->DetectAndSyncChanges())
 	    	{
-	    		ChangedResults.emplace_back(FRsapCollisionComponentChangedResult(ERsapCollisionComponentChangedType::Moved, CollisionComponent));
+	    		ChangedResults.emplace_back(FRsapCollisionComponentChangedResult(ERsapCollisionComponentChangedType::Moved, Handle, ActorKey));
 	    	}
 	    }
 
@@ -351,8 +576,8 @@ public:
 	    for (UPrimitiveComponent* PrimitiveComponent : GetPrimitiveComponents())
 	    {
 	    	if(CollisionComponents.contains(PrimitiveComponent)) continue;
-	    	const auto& NewComponent = CollisionComponents.emplace(PrimitiveComponent, std::make_shared<FRsapCollisionComponent>(PrimitiveComponent)).first->second;
-	    	ChangedResults.emplace_back(FRsapCollisionComponentChangedResult(ERsapCollisionComponentChangedType::Added, NewComponent));
+	    	const FRsapCollisionComponentHandle NewComponent = CollisionComponents.emplace(PrimitiveComponent, Registry.Create(PrimitiveComponent)).first->second;
+	    	ChangedResults.emplace_back(FRsapCollisionComponentChangedResult(ERsapCollisionComponentChangedType::Added, NewComponent, ActorKey));
 	    }
 		
 	    return ChangedResults;
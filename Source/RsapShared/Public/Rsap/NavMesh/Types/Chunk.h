@@ -2,44 +2,99 @@
 
 #pragma once
 #include "Rsap/NavMesh/Types/Node.h"
+#include "Rsap/NavMesh/Types/OctreeLayer.h"
+#include "Rsap/NavMesh/Types/MemoryReport.h"
 #include "Rsap/Math/Vectors.h"
+#include "Rsap/Math/Bounds.h"
 #include "Rsap/Definitions.h"
 #include "Rsap/Math/Overlap.h"
+#include <set>
 
 using namespace Rsap::NavMesh;
 
+struct FRsapLinearOctree;
 
 
 /**
- * Sparse voxel octree with a depth of 10, storing nodes in a hashmap where morton-codes are used as the key.
+ * Sparse voxel octree with a depth of 10, storing nodes in a map per layer where morton-codes are used as the key.
+ * In-game the layers are sorted flat arrays, see Rsap::Map::layer_map.
+ *
+ * The first DenseLayerCount layers are stored densely instead, see TRsapOctreeLayer.
+ * The layers, and the nodes within them, are allocated from the given memory-resource, which is the navmesh's arena.
  */
-template<typename NodeType>
+template<typename NodeType, layer_idx DenseLayerCount = 0>
 struct RSAPSHARED_API TLowResSparseOctree
 {
+	typedef TRsapOctreeLayer<NodeType> FLayer;
+	
 	// todo to unique?
-	std::array<std::shared_ptr<Rsap::Map::ordered_map<node_morton, NodeType>>, 10> Layers;
+	std::array<std::shared_ptr<FLayer>, 10> Layers;
 
-	TLowResSparseOctree()
+	explicit TLowResSparseOctree(std::pmr::memory_resource* Resource = std::pmr::get_default_resource())
 	{
+		const std::pmr::polymorphic_allocator<FLayer> Allocator(Resource);
 		for (layer_idx LayerIdx = 0; LayerIdx < 10; ++LayerIdx)
 		{
-			Layers[LayerIdx] = std::make_shared<Rsap::Map::ordered_map<node_morton, NodeType>>();
+			Layers[LayerIdx] = std::allocate_shared<FLayer>(Allocator, LayerIdx, LayerIdx < DenseLayerCount, Resource);
+		}
+	}
+
+	// Adds the memory used by this octree to the report.
+	void CollectMemory(FRsapMemoryReport& Report, FRsapMemoryReport::FChunk& Chunk) const
+	{
+		// The layers are allocated together with the control-block of the shared-ptr, which holds two counters and a vtable.
+		const size_t OctreeBytes = sizeof(*this) + Layers.size() * (sizeof(FLayer) + 2 * sizeof(void*));
+		Report.Containers.Octrees += OctreeBytes;
+		Chunk.Bytes += OctreeBytes;
+
+		for (layer_idx LayerIdx = 0; LayerIdx < Layers.size(); ++LayerIdx)
+		{
+			const FLayer& Layer = *Layers[LayerIdx];
+			const size_t LayerBytes = Layer.GetAllocatedSize();
+			Report.AddLayer(LayerIdx, Layer.size(), LayerBytes, Chunk);
+			(Layer.IsDense() ? Report.Containers.DenseLayers : Report.Containers.SparseLayers) += LayerBytes;
+
+			// Nodes that own memory themselves.
+			if constexpr (requires(const NodeType& Node) { Node.GetAllocatedSize(); })
+			{
+				for (const auto& [NodeMC, Node] : Layer)
+				{
+					const size_t NodeBytes = Node.GetAllocatedSize();
+					Report.Containers.Other += NodeBytes;
+					Chunk.Bytes += NodeBytes;
+				}
+			}
 		}
 	}
 };
 
 /**
  * Extends the low-resolution sparse-octree by adding leaf-nodes which multiply the max resolution by 64.
+ * The layers up to Layer::DenseDepth are dense, which costs around 37KB per octree once these are filled, but makes the upward neighbour searches a bit-test.
  */
 template<typename NodeType>
-struct RSAPSHARED_API THighResSparseOctree : TLowResSparseOctree<NodeType>
+struct RSAPSHARED_API THighResSparseOctree : TLowResSparseOctree<NodeType, Layer::DenseDepth+1>
 {
 	// todo to unique?
 	std::shared_ptr<FRsapLeafLayer> LeafNodes;
 
-	THighResSparseOctree()
+	explicit THighResSparseOctree(std::pmr::memory_resource* Resource = std::pmr::get_default_resource())
+		: TLowResSparseOctree<NodeType, Layer::DenseDepth+1>(Resource)
 	{
-		LeafNodes = std::make_shared<FRsapLeafLayer>();
+		LeafNodes = std::allocate_shared<FRsapLeafLayer>(std::pmr::polymorphic_allocator<FRsapLeafLayer>(Resource));
+	}
+
+	void CollectMemory(FRsapMemoryReport& Report, FRsapMemoryReport::FChunk& Chunk) const
+	{
+		TLowResSparseOctree<NodeType, Layer::DenseDepth+1>::CollectMemory(Report, Chunk);
+
+		const size_t LeafLayerObjectBytes = sizeof(FRsapLeafLayer) + 2 * sizeof(void*);
+		Report.Containers.Octrees += LeafLayerObjectBytes;
+		Chunk.Bytes += LeafLayerObjectBytes;
+
+		const size_t LeafBytes = Rsap::Memory::GetAllocatedSize(*LeafNodes);
+		Report.AddLayer(FRsapMemoryReport::LeafLayerIdx, LeafNodes->size(), LeafBytes, Chunk);
+		Report.Containers.LeafLayers += LeafBytes;
 	}
 };
 
@@ -47,7 +102,7 @@ template<typename OctreeType>
 struct RSAPSHARED_API TRsapChunkBase
 {
 protected:
-	OctreeType* Octree = nullptr;
+	mutable OctreeType* Octree = nullptr; // Mutable so that it can be reset when the octree it points to is recycled.
 };
 
 enum class EOctreeType
@@ -55,44 +110,140 @@ enum class EOctreeType
 	Static = 0, Dynamic = 1
 };
 
+/**
+ * Recycles the dynamic octrees of the chunks.
+ * Only chunks that are touched by dynamic objects need a dynamic octree, and these objects tend to move in and out of the same chunks.
+ * An octree that is returned is cleared, but keeps the memory of its layers for the next chunk that acquires it.
+ *
+ * The octrees are allocated from the navmesh's arena, so the pool is reset together with the arena.
+ */
+class RSAPSHARED_API FRsapOctreePool
+{
+public:
+	typedef THighResSparseOctree<FRsapNode> FOctree;
+
+	explicit FRsapOctreePool(std::pmr::memory_resource* InResource = std::pmr::get_default_resource())
+		: Resource(InResource) {}
+
+	FRsapOctreePool(const FRsapOctreePool&) = delete;
+	FRsapOctreePool& operator=(const FRsapOctreePool&) = delete;
+
+	FOctree* Acquire()
+	{
+		if(FreeOctrees.empty()) return std::pmr::polymorphic_allocator<>(Resource).new_object<FOctree>(Resource);
+		FOctree* Octree = FreeOctrees.back();
+		FreeOctrees.pop_back();
+		return Octree;
+	}
+
+	void Recycle(FOctree* Octree)
+	{
+		for (const auto& Layer : Octree->Layers) Layer->clear();
+		Octree->LeafNodes->clear();
+		FreeOctrees.emplace_back(Octree);
+	}
+
+	// Forgets the pooled octrees, call when the arena they were allocated from is released.
+	FORCEINLINE void Reset()
+	{
+		FreeOctrees.clear();
+	}
+
+	FORCEINLINE size_t GetPooledCount() const { return FreeOctrees.size(); }
+
+private:
+	std::pmr::memory_resource* Resource;
+	std::vector<FOctree*> FreeOctrees;
+};
+
 /**
  * Chunk used for 3D pathfinding.
  * The first octree at index 0 is static. The nodes are generated/updated within the editor, never during gameplay. Only the relations can be updated during gameplay to point to dynamic nodes, but these changes aren't serialized.
  * The second octree at index 1 is dynamic. The nodes are created from dynamic objects during gameplay. These will not be serialized.
+ * The dynamic octree is only created when the first dynamic node is initialized, and is returned to the pool once it is empty again. Until then it is a nullptr.
  *
  * Call ::SetActiveOctree to set one of the two active.
+ *
+ * The linear-octree of the static octree is kept until nodes are added to or removed from it, see ::GetLinearOctree.
+ *
+ * Everything the chunk owns is allocated from the given memory-resource, which is the navmesh's arena.
+ * The navmesh can then free all of its chunks at once, see TRsapNavMeshBase::Clear.
  */
 struct RSAPSHARED_API FRsapChunk : TRsapChunkBase<THighResSparseOctree<FRsapNode>>
 {
-	std::array<THighResSparseOctree<FRsapNode>*, 2> Octrees; // Accessed using a node-state, 0 static, 1 dynamic.
-	Rsap::Map::flat_map<actor_key, FGuid>* ActorEntries;
+	// The collision-hash of each actor that occludes this chunk, at the moment it was rasterized. See FRsapActor::GetCollisionHash.
+	typedef Rsap::Map::pmr::flat_map<actor_key, uint64> FActorEntries;
+	
+	// Accessed using a node-state, 0 static, 1 dynamic.
+	// Mutable because the dynamic octree is created/recycled by the const node accessors.
+	mutable std::array<THighResSparseOctree<FRsapNode>*, 2> Octrees;
+	FActorEntries* ActorEntries;
 	uint8 ActiveOctreeType = Node::State::Static;
 
-	FRsapChunk()
+	// The chunks against each side of this chunk, in the order of Direction::List, which are nullptr if there is none. Linked by the navmesh.
+	std::array<FRsapChunk*, std::size(Direction::List)> Neighbours = {};
+
+	// The dynamic octree is taken from the pool if one is given, otherwise it is allocated from the resource.
+	explicit FRsapChunk(std::pmr::memory_resource* InResource = std::pmr::get_default_resource(), FRsapOctreePool* InDynamicOctreePool = nullptr)
+		: Resource(InResource), DynamicOctreePool(InDynamicOctreePool)
 	{
-		Octrees[0] = new THighResSparseOctree<FRsapNode>;
-		Octrees[1] = new THighResSparseOctree<FRsapNode>;
+		std::pmr::polymorphic_allocator<> Allocator(Resource);
+		Octrees[Node::State::Static] = Allocator.new_object<THighResSparseOctree<FRsapNode>>(Resource);
+		Octrees[Node::State::Dynamic] = nullptr;
 		SetActiveOctree(EOctreeType::Static);
 		
-		ActorEntries = new Rsap::Map::flat_map<actor_key, FGuid>();
+		ActorEntries = Allocator.new_object<FActorEntries>();
 	}
 
-	~FRsapChunk()
+	// Chunks are moved when the flat-map of the navmesh grows, so the ownership has to move with it.
+	FRsapChunk(FRsapChunk&& Other) noexcept
+		: Octrees(std::exchange(Other.Octrees, {nullptr, nullptr})), ActorEntries(std::exchange(Other.ActorEntries, nullptr)),
+		  ActiveOctreeType(Other.ActiveOctreeType), Neighbours(Other.Neighbours), Resource(Other.Resource), DynamicOctreePool(Other.DynamicOctreePool),
+		  LinearOctree(std::exchange(Other.LinearOctree, nullptr)), bLinearOctreeOutdated(Other.bLinearOctreeOutdated)
+	{
+		Octree = std::exchange(Other.Octree, nullptr);
+	}
+	FRsapChunk& operator=(FRsapChunk&& Other) noexcept
 	{
-		delete Octrees[0];
-		delete Octrees[1];
-		delete ActorEntries;
+		std::swap(Octrees, Other.Octrees);
+		std::swap(ActorEntries, Other.ActorEntries);
+		std::swap(ActiveOctreeType, Other.ActiveOctreeType);
+		std::swap(Neighbours, Other.Neighbours);
+		std::swap(Resource, Other.Resource);
+		std::swap(DynamicOctreePool, Other.DynamicOctreePool);
+		std::swap(Octree, Other.Octree);
+		std::swap(LinearOctree, Other.LinearOctree);
+		std::swap(bLinearOctreeOutdated, Other.bLinearOctreeOutdated);
+		return *this;
 	}
+	FRsapChunk(const FRsapChunk&) = delete;
+	FRsapChunk& operator=(const FRsapChunk&) = delete;
+
+	~FRsapChunk();
 
 	void SetActiveOctree(const EOctreeType OctreeType)
 	{
-		Octree = Octrees[static_cast<uint8>(OctreeType)];
+		Octree = GetOrCreateOctree(static_cast<node_state>(OctreeType));
+	}
+
+	FORCEINLINE bool HasDynamicOctree() const { return Octrees[Node::State::Dynamic] != nullptr; }
+
+	// Returns the linear-octree of the static octree, which is only rebuilt when it is outdated. Its memory is reused, and allocated from the arena, so only call from the game-thread.
+	const FRsapLinearOctree& GetLinearOctree() const;
+
+	// Call after adding nodes to, or removing nodes from, the static octree directly. Updating the relations does not outdate it.
+	FORCEINLINE void InvalidateLinearOctree() const { bLinearOctreeOutdated = true; }
+
+	// Returns nullptr if there is no chunk in this direction.
+	FORCEINLINE FRsapChunk* GetNeighbour(const rsap_direction Direction) const
+	{
+		return Neighbours[Direction::GetIndex(Direction)];
 	}
 
-	// Adds/updates this actor to the entry with a new unique FGuid.
-	FORCEINLINE void UpdateActorEntry(const actor_key ActorKey)
+	// Adds/updates this actor in the entries with the hash of its current collision. Returns true if the actor has been added.
+	FORCEINLINE bool UpdateActorEntry(const actor_key ActorKey, const uint64 CollisionHash)
 	{
-		ActorEntries->insert_or_assign(ActorKey,FGuid::NewGuid());
+		return ActorEntries->insert_or_assign(ActorKey, CollisionHash).second;
 	}
 
 	// Use only when you are certain it exists.
@@ -108,13 +259,23 @@ struct RSAPSHARED_API FRsapChunk : TRsapChunkBase<THighResSparseOctree<FRsapNode
 	
 	FORCEINLINE bool FindNode(FRsapNode& OutNode, const node_morton NodeMC, const layer_idx LayerIdx, const node_state NodeState) const
 	{
+		if(!Octrees[NodeState]) return false;
 		const auto& Iterator = Octrees[NodeState]->Layers[LayerIdx]->find(NodeMC);
 		if(Iterator == Octrees[NodeState]->Layers[LayerIdx]->end()) return false;
 		OutNode = Iterator->second;
 		return true;
 	}
+	// Returns nullptr if it does not exist.
+	FORCEINLINE FRsapNode* FindNode(const node_morton NodeMC, const layer_idx LayerIdx, const node_state NodeState) const
+	{
+		if(!Octrees[NodeState]) return nullptr;
+		const auto& Iterator = Octrees[NodeState]->Layers[LayerIdx]->find(NodeMC);
+		if(Iterator == Octrees[NodeState]->Layers[LayerIdx]->end()) return nullptr;
+		return &Iterator->second;
+	}
 	FORCEINLINE bool FindLeafNode(FRsapLeaf& OutLeafNode, const node_morton NodeMC, const node_state NodeState) const
 	{
+		if(!Octrees[NodeState]) return false;
 		const auto& Iterator = Octrees[NodeState]->LeafNodes->find(NodeMC);
 		if(Iterator == Octrees[NodeState]->LeafNodes->end()) return false;
 		OutLeafNode = Iterator->second;
@@ -123,33 +284,58 @@ struct RSAPSHARED_API FRsapChunk : TRsapChunkBase<THighResSparseOctree<FRsapNode
 	
 	FORCEINLINE FRsapNode& TryInitNode(const node_morton NodeMC, const layer_idx LayerIdx, const node_state NodeState) const
 	{
-		return Octrees[NodeState]->Layers[LayerIdx]->try_emplace(NodeMC).first->second;
+		bool bInserted;
+		return TryInitNode(bInserted, NodeMC, LayerIdx, NodeState);
 	}
 	FORCEINLINE FRsapNode& TryInitNode(bool& bOutInserted, const node_morton NodeMC, const layer_idx LayerIdx, const node_state NodeState) const
 	{
-		const auto [NodePair, bInserted] = Octrees[NodeState]->Layers[LayerIdx]->try_emplace(NodeMC);
+		const auto [NodePair, bInserted] = GetOrCreateOctree(NodeState)->Layers[LayerIdx]->try_emplace(NodeMC);
+		if(bInserted && NodeState == Node::State::Static) InvalidateLinearOctree();
 		bOutInserted = bInserted;
 		return NodePair->second;
 	}
 	
 	FORCEINLINE FRsapLeaf& TryInitLeafNode(const node_morton NodeMC, const node_state NodeState) const
 	{
-		return Octrees[NodeState]->LeafNodes->try_emplace(NodeMC).first->second;
+		bool bInserted;
+		return TryInitLeafNode(bInserted, NodeMC, NodeState);
 	}
 	FORCEINLINE FRsapLeaf& TryInitLeafNode(bool& bOutInserted, const node_morton NodeMC, const node_state NodeState) const
 	{
-		const auto [NodePair, bInserted] = Octrees[NodeState]->LeafNodes->try_emplace(NodeMC);
+		const auto [NodePair, bInserted] = GetOrCreateOctree(NodeState)->LeafNodes->try_emplace(NodeMC);
+		if(bInserted && NodeState == Node::State::Static) InvalidateLinearOctree();
 		bOutInserted = bInserted;
 		return NodePair->second;
 	}
 
+	// Returns the dynamic octree to the pool when its last node is erased.
 	FORCEINLINE void EraseNode(const node_morton NodeMC, const layer_idx LayerIdx, const node_state NodeState) const
 	{
+		if(!Octrees[NodeState]) return;
 		Octrees[NodeState]->Layers[LayerIdx]->erase(NodeMC);
+		if(NodeState == Node::State::Static) InvalidateLinearOctree();
+		else if(IsOctreeEmpty(NodeState)) ReleaseDynamicOctree();
 	}
 	FORCEINLINE void EraseLeafNode(const node_morton NodeMC, const node_state NodeState) const
 	{
+		if(!Octrees[NodeState]) return;
 		Octrees[NodeState]->LeafNodes->erase(NodeMC);
+		if(NodeState == Node::State::Static) InvalidateLinearOctree();
+		else if(IsOctreeEmpty(NodeState)) ReleaseDynamicOctree();
+	}
+
+	/**
+	 * Runs the callback for each existing node in the layer that intersects with the bounds, which should be within this chunk.
+	 * Walks only the stored nodes within the morton-range of the bounds, instead of looking up every node-location like FRsapBounds::ForEachNode.
+	 *
+	 * Callback receives the node_morton and the FRsapNode.
+	 */
+	template<typename Func>
+	void ForEachNodeInBounds(const FRsapBounds& Bounds, const layer_idx LayerIdx, const node_state NodeState, Func Callback) const
+	{
+		if(!Octrees[NodeState]) return;
+		const auto [MinMC, MaxMC] = Bounds.GetNodeMortonRange(LayerIdx);
+		Octrees[NodeState]->Layers[LayerIdx]->ForEachInBox(MinMC, MaxMC, Callback);
 	}
 
 	FORCEINLINE static void Draw(const UWorld* World, const chunk_morton ChunkMC)
@@ -167,6 +353,22 @@ struct RSAPSHARED_API FRsapChunk : TRsapChunkBase<THighResSparseOctree<FRsapNode
 		return FRsapOverlap::Component(Component, ChunkLocation, 0, false);
 	}
 
+	void CollectMemory(FRsapMemoryReport& Report, FRsapMemoryReport::FChunk& Chunk) const
+	{
+		for (const THighResSparseOctree<FRsapNode>* OctreePtr : Octrees)
+		{
+			if(OctreePtr) OctreePtr->CollectMemory(Report, Chunk);
+		}
+
+		const size_t ActorEntriesBytes = sizeof(FActorEntries) + Rsap::Memory::GetAllocatedSize(*ActorEntries);
+		Report.Containers.ActorEntries += ActorEntriesBytes;
+		Chunk.Bytes += ActorEntriesBytes;
+
+		const size_t LinearOctreeBytes = GetLinearOctreeAllocatedSize();
+		Report.Containers.LinearOctrees += LinearOctreeBytes;
+		Chunk.Bytes += LinearOctreeBytes;
+	}
+
 	FORCEINLINE uint64 GetStaticNodeCount() const
 	{
 		uint64 Count = 0;
@@ -176,6 +378,40 @@ struct RSAPSHARED_API FRsapChunk : TRsapChunkBase<THighResSparseOctree<FRsapNode
 		}
 		return Count;
 	}
+
+private:
+	std::pmr::memory_resource* Resource;
+	FRsapOctreePool* DynamicOctreePool;
+	mutable FRsapLinearOctree* LinearOctree = nullptr; // Created on the first ::GetLinearOctree.
+	mutable bool bLinearOctreeOutdated = true;
+
+	size_t GetLinearOctreeAllocatedSize() const;
+
+	FORCEINLINE THighResSparseOctree<FRsapNode>* GetOrCreateOctree(const node_state NodeState) const
+	{
+		if(!Octrees[NodeState]) [[unlikely]]
+		{
+			// Only the dynamic octree can be missing.
+			Octrees[NodeState] = DynamicOctreePool
+				? DynamicOctreePool->Acquire()
+				: std::pmr::polymorphic_allocator<>(Resource).new_object<THighResSparseOctree<FRsapNode>>(Resource);
+		}
+		return Octrees[NodeState];
+	}
+
+	FORCEINLINE bool IsOctreeEmpty(const node_state NodeState) const
+	{
+		for (const auto& Layer : Octrees[NodeState]->Layers) if(!Layer->empty()) return false;
+		return Octrees[NodeState]->LeafNodes->empty();
+	}
+
+	void ReleaseDynamicOctree() const
+	{
+		THighResSparseOctree<FRsapNode>* DynamicOctree = std::exchange(Octrees[Node::State::Dynamic], nullptr);
+		if(Octree == DynamicOctree) Octree = Octrees[Node::State::Static];
+		if(DynamicOctreePool) DynamicOctreePool->Recycle(DynamicOctree);
+		else std::pmr::polymorphic_allocator<>(Resource).delete_object(DynamicOctree);
+	}
 };
 
 /**
@@ -186,14 +422,27 @@ struct RSAPSHARED_API FRsapDirtyChunk
 {
 	TLowResSparseOctree<FRsapDirtyNode>* Octree;
 
-	FRsapDirtyChunk()
+	explicit FRsapDirtyChunk(std::pmr::memory_resource* InResource = std::pmr::get_default_resource())
+		: Resource(InResource), OverflowingComponents(InResource)
 	{
-		Octree = new TLowResSparseOctree<FRsapDirtyNode>;
+		Octree = std::pmr::polymorphic_allocator<>(Resource).new_object<TLowResSparseOctree<FRsapDirtyNode>>(Resource);
 	}
+
+	FRsapDirtyChunk(FRsapDirtyChunk&& Other) noexcept
+		: Octree(std::exchange(Other.Octree, nullptr)), Resource(Other.Resource), OverflowingComponents(std::move(Other.OverflowingComponents)) {}
+	FRsapDirtyChunk& operator=(FRsapDirtyChunk&& Other) noexcept
+	{
+		std::swap(Octree, Other.Octree);
+		std::swap(Resource, Other.Resource);
+		std::swap(OverflowingComponents, Other.OverflowingComponents);
+		return *this;
+	}
+	FRsapDirtyChunk(const FRsapDirtyChunk&) = delete;
+	FRsapDirtyChunk& operator=(const FRsapDirtyChunk&) = delete;
 	
 	~FRsapDirtyChunk()
 	{
-		delete Octree;
+		if(Octree) std::pmr::polymorphic_allocator<>(Resource).delete_object(Octree);
 	}
 
 	// Use only when you are certain it exists.
@@ -208,6 +457,14 @@ struct RSAPSHARED_API FRsapDirtyChunk
 		OutNode = Iterator->second;
 		return true;
 	}
+
+	// Runs the callback for each existing dirty-node in the layer that intersects with the bounds, see FRsapChunk::ForEachNodeInBounds.
+	template<typename Func>
+	void ForEachNodeInBounds(const FRsapBounds& Bounds, const layer_idx LayerIdx, Func Callback) const
+	{
+		const auto [MinMC, MaxMC] = Bounds.GetNodeMortonRange(LayerIdx);
+		Octree->Layers[LayerIdx]->ForEachInBox(MinMC, MaxMC, Callback);
+	}
 	FORCEINLINE FRsapDirtyNode& TryInitNode(const node_morton NodeMC, const layer_idx LayerIdx) const
 	{
 		return Octree->Layers[LayerIdx]->try_emplace(NodeMC).first->second;
@@ -219,6 +476,47 @@ struct RSAPSHARED_API FRsapDirtyChunk
 		return NodePair->second;
 	}
 	
+	void CollectMemory(FRsapMemoryReport& Report, FRsapMemoryReport::FChunk& Chunk) const
+	{
+		Octree->CollectMemory(Report, Chunk);
+		
+		const size_t OverflowBytes = Rsap::Memory::GetAllocatedSize(OverflowingComponents);
+		Report.Containers.Other += OverflowBytes;
+		Chunk.Bytes += OverflowBytes;
+	}
+
+	// Adds the component to the node, if it does not have it yet. Returns true if it has been added.
+	bool AddComponent(FRsapDirtyNode& Node, const node_morton NodeMC, const layer_idx LayerIdx, const FRsapCollisionComponentHandle Handle)
+	{
+		if(HasInlineComponent(Node, Handle)) return false;
+		if(Node.ComponentCount < FRsapDirtyNode::InlineComponents) Node.Components[Node.ComponentCount] = Handle;
+		else if(!OverflowingComponents.emplace(GetOverflowKey(NodeMC, LayerIdx), Handle).second) return false;
+		++Node.ComponentCount;
+		return true;
+	}
+
+	bool HasComponent(const FRsapDirtyNode& Node, const node_morton NodeMC, const layer_idx LayerIdx, const FRsapCollisionComponentHandle Handle) const
+	{
+		if(HasInlineComponent(Node, Handle)) return true;
+		return Node.HasOverflowingComponents() && OverflowingComponents.contains({GetOverflowKey(NodeMC, LayerIdx), Handle});
+	}
+
+	// Runs the callback with the handle of each component that has made the node dirty.
+	template<typename Func>
+	void ForEachComponent(const FRsapDirtyNode& Node, const node_morton NodeMC, const layer_idx LayerIdx, Func Callback) const
+	{
+		const uint16 InlineCount = FMath::Min<uint16>(Node.ComponentCount, FRsapDirtyNode::InlineComponents);
+		for (uint16 Idx = 0; Idx < InlineCount; ++Idx) Callback(Node.Components[Idx]);
+		if(!Node.HasOverflowingComponents()) return;
+
+		// The components of the node are next to each other, starting from the lowest handle, which is the zeroed one.
+		const uint64 Key = GetOverflowKey(NodeMC, LayerIdx);
+		for (auto Iterator = OverflowingComponents.lower_bound({Key, FRsapCollisionComponentHandle()}); Iterator != OverflowingComponents.end() && Iterator->first == Key; ++Iterator)
+		{
+			Callback(Iterator->second);
+		}
+	}
+	
 	FORCEINLINE void InitNodeParents(const node_morton NodeMC, const layer_idx LayerIdx)
 	{
 		const layer_idx ParentLayerIdx = LayerIdx-1;
@@ -233,4 +531,45 @@ struct RSAPSHARED_API FRsapDirtyChunk
 		const child_idx ChildIdx = FMortonUtils::Node::GetChildIndex(NodeMC, LayerIdx);
 		ParentNode.SetChildActive(ChildIdx);
 	}
-};
\ No newline at end of file
+
+private:
+	// Components of the nodes that have more than fit inline, paired with the key of the node they belong to.
+	// Sorted on the node first, so that the components of a node can be found, and checked for duplicates, without going through those of the other nodes.
+	typedef std::pair<uint64, FRsapCollisionComponentHandle> FOverflowingComponent;
+	struct FOverflowingComponentLess
+	{
+		FORCEINLINE bool operator()(const FOverflowingComponent& A, const FOverflowingComponent& B) const
+		{
+			return A.first != B.first ? A.first < B.first : A.second.Packed < B.second.Packed;
+		}
+	};
+
+	FORCEINLINE static uint64 GetOverflowKey(const node_morton NodeMC, const layer_idx LayerIdx)
+	{
+		return static_cast<uint64>(NodeMC) << 4 | LayerIdx;
+	}
+
+	FORCEINLINE static bool HasInlineComponent(const FRsapDirtyNode& Node, const FRsapCollisionComponentHandle Handle)
+	{
+		const uint16 InlineCount = FMath::Min<uint16>(Node.ComponentCount, FRsapDirtyNode::InlineComponents);
+		for (uint16 Idx = 0; Idx < InlineCount; ++Idx) if(Node.Components[Idx] == Handle) return true;
+		return false;
+	}
+
+	std::pmr::memory_resource* Resource;
+	std::pmr::set<FOverflowingComponent, FOverflowingComponentLess> OverflowingComponents;
+};
+
+/**
+ * Whether everything a chunk owns is allocated from the memory-resource it is given.
+ * Only then can the navmesh free its chunks by releasing the arena without destroying them, see TRsapNavMeshBase::Clear.
+ * Any other chunk-type is destroyed normally.
+ */
+template<typename ChunkType>
+struct TRsapIsArenaOnlyChunk { static constexpr bool Value = false; };
+
+template<>
+struct TRsapIsArenaOnlyChunk<FRsapChunk> { static constexpr bool Value = true; };
+
+template<>
+struct TRsapIsArenaOnlyChunk<FRsapDirtyChunk> { static constexpr bool Value = true; };
\ No newline at end of file
@@ -0,0 +1,223 @@
+﻿// Copyright Melvin Brink 2023. All Rights Reserved.
+
+#pragma once
+#include "Rsap/Definitions.h"
+#include "Rsap/Math/Morton.h"
+#include "Rsap/NavMesh/Types/Chunk.h"
+#include "Rsap/NavMesh/Types/Node.h"
+
+using namespace Rsap::NavMesh;
+
+
+
+/**
+ * Node within the linear-octree, which points to the node in the octree and knows where its children are stored.
+ * Only the topology is copied, the relations are read from the node itself because these change without the topology changing.
+ */
+struct RSAPSHARED_API FRsapLinearNode
+{
+	const FRsapNode* OctreeNode = nullptr;
+	uint32 FirstChild = 0;	// Index of the first child, in the node-array, or the leaf-array if this node is on the last layer.
+	uint8 Children = 0;		// Children-mask of the node, without the children that could not be found.
+
+	FRsapLinearNode() = default;
+	explicit FRsapLinearNode(const FRsapNode& InOctreeNode) : OctreeNode(&InOctreeNode), Children(InOctreeNode.Children) {}
+
+	// Returns the index of the child in the array, only valid if the child exists.
+	FORCEINLINE uint32 GetChildIndex(const child_idx ChildIdx) const
+	{
+		return FirstChild + static_cast<uint32>(FMath::CountBits(Children & (Node::Children::Masks[ChildIdx] - 1)));
+	}
+
+	FORCEINLINE uint32 GetChildCount() const
+	{
+		return static_cast<uint32>(FMath::CountBits(Children));
+	}
+};
+
+/**
+ * Flat representation of a static octree, meant for runtime queries that traverse the octree top-down.
+ *
+ * All nodes are stored in a single array, layer after layer, where each layer is in ascending morton-order.
+ * Morton-codes are hierarchical, so the children of a node are stored next to each other in the next layer, in child-index order.
+ * Every node stores the index of its first child, so any child is found using the children-mask and a popcount, without any map lookups.
+ *
+ * The leaf-nodes are stored in their own array, which the nodes on the last layer point into.
+ * The morton-codes are stored in a parallel array, which traversal does not have to touch.
+ *
+ * The nodes and leafs are pointers into the octree it is built from, so it has to be rebuilt once nodes are added to or removed from that octree.
+ * Each chunk keeps the one of its static octree, see FRsapChunk::GetLinearOctree.
+ */
+struct RSAPSHARED_API FRsapLinearOctree
+{
+	static inline constexpr layer_idx LayerCount = Layer::NodeDepth;
+
+	std::pmr::vector<FRsapLinearNode> Nodes;
+	std::pmr::vector<node_morton> NodeMCs;
+	std::pmr::vector<const FRsapLeaf*> Leafs;
+
+	// Index of the first node for each layer. The last entry is the total node count.
+	std::array<uint32, LayerCount+1> LayerStarts = {};
+
+	explicit FRsapLinearOctree(std::pmr::memory_resource* Resource = std::pmr::get_default_resource())
+		: Nodes(Resource), NodeMCs(Resource), Leafs(Resource) {}
+	explicit FRsapLinearOctree(const THighResSparseOctree<FRsapNode>& Octree, std::pmr::memory_resource* Resource = std::pmr::get_default_resource())
+		: FRsapLinearOctree(Resource)
+	{
+		Build(Octree);
+	}
+
+	/**
+	 * Builds the linear-octree from a sparse-octree, in a single sweep over every layer.
+	 * Each layer is merged with the sorted nodes of the next layer, so the nodes are added in the exact order they have to be stored.
+	 * Nodes that are not reachable from the root are skipped, and children that can't be found are cleared from the mask.
+	 * Reuses the memory of the arrays from a previous build.
+	 */
+	void Build(const THighResSparseOctree<FRsapNode>& Octree)
+	{
+		Nodes.clear();
+		NodeMCs.clear();
+		Leafs.clear();
+
+		size_t NodeCount = 0;
+		for (const auto& Layer : Octree.Layers) NodeCount += Layer->size();
+		Nodes.reserve(NodeCount);
+		NodeMCs.reserve(NodeCount);
+		Leafs.reserve(Octree.LeafNodes->size());
+
+		LayerStarts[0] = 0;
+		constexpr node_morton RootNodeMC = 0;
+		if(const auto Iterator = Octree.Layers[Layer::Root]->find(RootNodeMC); Iterator != Octree.Layers[Layer::Root]->end())
+		{
+			Nodes.emplace_back(Iterator->second);
+			NodeMCs.emplace_back(RootNodeMC);
+		}
+		LayerStarts[1] = Nodes.size();
+
+		for (layer_idx LayerIdx = 0; LayerIdx < LayerCount; ++LayerIdx)
+		{
+			const layer_idx ChildLayerIdx = LayerIdx+1;
+			if(ChildLayerIdx < LayerCount)
+			{
+				LinkChildren(*Octree.Layers[ChildLayerIdx], LayerIdx, [&](const node_morton ChildMC, const FRsapNode& Child)
+				{
+					Nodes.emplace_back(Child);
+					NodeMCs.emplace_back(ChildMC);
+					return static_cast<uint32>(Nodes.size() - 1);
+				});
+				LayerStarts[ChildLayerIdx+1] = Nodes.size();
+				continue;
+			}
+
+			// The last layer points to the leaf-nodes.
+			LinkChildren(*Octree.LeafNodes, LayerIdx, [&](const node_morton, const FRsapLeaf& Leaf)
+			{
+				Leafs.emplace_back(&Leaf);
+				return static_cast<uint32>(Leafs.size() - 1);
+			});
+		}
+	}
+
+	FORCEINLINE bool IsEmpty() const { return Nodes.empty(); }
+	FORCEINLINE uint32 GetLayerNodeCount(const layer_idx LayerIdx) const { return LayerStarts[LayerIdx+1] - LayerStarts[LayerIdx]; }
+	FORCEINLINE size_t GetAllocatedSize() const
+	{
+		return Nodes.capacity() * sizeof(FRsapLinearNode) + NodeMCs.capacity() * sizeof(node_morton) + Leafs.capacity() * sizeof(const FRsapLeaf*);
+	}
+
+	/**
+	 * Runs the callback for each child of the node.
+	 *
+	 * Callback receives:
+	 * - uint32: index of the child within the node-array, or the leaf-array if the node is on the last layer.
+	 * - node_morton: morton-code of the child.
+	 * - child_idx: index of the child within its parent.
+	 */
+	template<typename Func>
+	FORCEINLINE void ForEachChild(const uint32 NodeIdx, const node_morton NodeMC, const layer_idx LayerIdx, Func&& Callback) const
+	{
+		const FRsapLinearNode& Node = Nodes[NodeIdx];
+		const layer_idx ChildLayerIdx = LayerIdx+1;
+
+		uint32 ChildArrayIdx = Node.FirstChild;
+		for (uint32 Mask = Node.Children; Mask; Mask &= Mask - 1)
+		{
+			const child_idx ChildIdx = static_cast<child_idx>(FMath::CountTrailingZeros(Mask));
+			Callback(ChildArrayIdx++, FMortonUtils::Node::GetChild(NodeMC, ChildLayerIdx, ChildIdx), ChildIdx);
+		}
+	}
+
+	/**
+	 * Traverses the octree depth-first, starting from the root node, in ascending morton-order.
+	 * The callback should return true to also visit the children of the node.
+	 *
+	 * Callback receives:
+	 * - const FRsapLinearNode&: the node.
+	 * - uint32: index of the node within the node-array.
+	 * - node_morton: morton-code of the node.
+	 * - layer_idx: layer the node is in.
+	 */
+	template<typename Func>
+	void Traverse(Func&& Callback) const
+	{
+		static_assert(std::is_invocable_r_v<bool, Func, const FRsapLinearNode&, uint32, node_morton, layer_idx>,
+		"'::Traverse' callback must be invocable with 'const FRsapLinearNode&, uint32, node_morton, layer_idx', and return a bool");
+
+		if(IsEmpty()) return;
+		TraverseNode(0, 0, Layer::Root, Callback);
+	}
+
+private:
+	template<typename Func>
+	void TraverseNode(const uint32 NodeIdx, const node_morton NodeMC, const layer_idx LayerIdx, Func& Callback) const
+	{
+		if(!Callback(Nodes[NodeIdx], NodeIdx, NodeMC, LayerIdx)) return;
+		if(LayerIdx+1 >= LayerCount) return;
+
+		ForEachChild(NodeIdx, NodeMC, LayerIdx, [&](const uint32 ChildArrayIdx, const node_morton ChildMC, child_idx)
+		{
+			TraverseNode(ChildArrayIdx, ChildMC, LayerIdx+1, Callback);
+		});
+	}
+
+	// Links the nodes of the given layer to their children, by merging them with the sorted nodes of the child-layer.
+	template<typename ChildLayerType, typename Func>
+	void LinkChildren(const ChildLayerType& ChildLayer, const layer_idx LayerIdx, Func&& AddChild)
+	{
+		const layer_idx ChildLayerIdx = LayerIdx+1;
+		auto ChildIterator = ChildLayer.begin();
+		const auto ChildEnd = ChildLayer.end();
+
+		for (uint32 NodeIdx = LayerStarts[LayerIdx]; NodeIdx < LayerStarts[LayerIdx+1]; ++NodeIdx)
+		{
+			// Copy the mask because adding a child could reallocate the node-array.
+			uint8 Children = Nodes[NodeIdx].Children;
+			uint32 FirstChild = 0;
+			bool bFirst = true;
+
+			for (child_idx ChildIdx = 0; ChildIdx < 8; ++ChildIdx)
+			{
+				if(!(Children & Node::Children::Masks[ChildIdx])) continue;
+
+				const node_morton ChildMC = FMortonUtils::Node::GetChild(NodeMCs[NodeIdx], ChildLayerIdx, ChildIdx);
+				while (ChildIterator != ChildEnd && (*ChildIterator).first < ChildMC) ++ChildIterator;
+				if(ChildIterator == ChildEnd || (*ChildIterator).first != ChildMC)
+				{
+					Children &= Node::Children::MasksInverse[ChildIdx];
+					continue;
+				}
+
+				const uint32 ChildArrayIdx = AddChild(ChildMC, (*ChildIterator).second);
+				if(bFirst)
+				{
+					FirstChild = ChildArrayIdx;
+					bFirst = false;
+				}
+				++ChildIterator;
+			}
+
+			Nodes[NodeIdx].Children = Children;
+			Nodes[NodeIdx].FirstChild = FirstChild;
+		}
+	}
+};
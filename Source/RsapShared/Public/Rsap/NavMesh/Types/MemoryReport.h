@@ -0,0 +1,171 @@
+﻿// Copyright Melvin Brink 2023. All Rights Reserved.
+
+#pragma once
+#include "Rsap/Definitions.h"
+#include "Rsap/Containers/Arena.h"
+#include "Misc/FileHelper.h"
+
+using namespace Rsap::NavMesh;
+
+
+
+namespace Rsap::Memory
+{
+	/**
+	 * Returns the bytes allocated by a container, excluding the container object itself.
+	 * This is an estimate for the node-based containers, which add a few pointers of overhead to every element.
+	 */
+	template<typename ContainerType>
+	size_t GetAllocatedSize(const ContainerType& Container)
+	{
+		if constexpr (requires { Container.values().capacity(); Container.bucket_count(); })
+		{
+			// Flat-map: array of values, and an array of buckets.
+			return Container.values().capacity() * sizeof(typename ContainerType::value_type) + Container.bucket_count() * sizeof(typename ContainerType::bucket_type);
+		}
+		else if constexpr (requires { Container.keys(); })
+		{
+			// Sorted-map: array of keys, and an array of values.
+			return Container.keys().capacity() * sizeof(typename ContainerType::key_type) + Container.values().capacity() * sizeof(typename ContainerType::mapped_type);
+		}
+		else if constexpr (requires { Container.bucket_count(); })
+		{
+			// Unordered std containers: a singly linked node per element, and an array of bucket pointers.
+			return Container.size() * (sizeof(typename ContainerType::value_type) + 2 * sizeof(void*)) + Container.bucket_count() * sizeof(void*);
+		}
+		else
+		{
+			// Ordered std containers: a red-black tree node per element.
+			return Container.size() * (sizeof(typename ContainerType::value_type) + 4 * sizeof(void*));
+		}
+	}
+}
+
+/**
+ * Breakdown of the memory used by a navmesh, created with TRsapNavMeshBase::GetMemoryReport.
+ * The container sizes are estimates of what they have allocated, while the allocator stats are exact.
+ */
+struct FRsapMemoryReport
+{
+	// Index within the layers for the leaf-nodes.
+	static inline constexpr layer_idx LeafLayerIdx = Layer::NodeDepth;
+
+	struct FChunk
+	{
+		chunk_morton ChunkMC = 0;
+		size_t NodeCount = 0;
+		size_t Bytes = 0;
+	};
+
+	struct FLayer
+	{
+		size_t NodeCount = 0;
+		size_t Bytes = 0;
+	};
+
+	// Bytes per container type.
+	struct FContainers
+	{
+		size_t DenseLayers = 0;		// Occupancy-bitsets and node-arrays of the shallow layers.
+		size_t SparseLayers = 0;	// Layer-maps of the deeper layers.
+		size_t LeafLayers = 0;
+		size_t ActorEntries = 0;
+		size_t Octrees = 0;			// The octree and layer objects themselves.
+		size_t LinearOctrees = 0;	// The linear-octrees the chunks keep of their static octree.
+		size_t Chunks = 0;			// The chunk-map and the chunk objects.
+		size_t Other = 0;			// Anything the nodes own themselves, like the components on a dirty-node.
+
+		FORCEINLINE size_t GetTotal() const
+		{
+			return DenseLayers + SparseLayers + LeafLayers + ActorEntries + Octrees + LinearOctrees + Chunks + Other;
+		}
+	};
+
+	std::vector<FChunk> Chunks;
+	std::array<FLayer, LeafLayerIdx+1> Layers;
+	FContainers Containers;
+	FRsapArenaStats Arena;
+
+	FORCEINLINE size_t GetTotalBytes() const { return Containers.GetTotal(); }
+
+	// Memory that is reserved by the arena, but not used by any container. Includes the free slots within the pools.
+	FORCEINLINE size_t GetAllocatorOverhead() const
+	{
+		return Arena.BytesReserved > Arena.BytesInUse ? Arena.BytesReserved - Arena.BytesInUse : 0;
+	}
+
+	FORCEINLINE void AddLayer(const layer_idx LayerIdx, const size_t NodeCount, const size_t Bytes, FChunk& Chunk)
+	{
+		Layers[LayerIdx].NodeCount += NodeCount;
+		Layers[LayerIdx].Bytes += Bytes;
+		Chunk.NodeCount += NodeCount;
+		Chunk.Bytes += Bytes;
+	}
+
+	void Log(const TCHAR* Name) const
+	{
+		UE_LOG(LogRsap, Log, TEXT("%s memory: %llu KB in %llu chunks, %llu KB reserved by the arena (%llu KB overhead, %.1f%% fragmentation)."),
+			Name, ToKB(GetTotalBytes()), static_cast<uint64>(Chunks.size()), ToKB(Arena.BytesReserved), ToKB(GetAllocatorOverhead()), Arena.GetFragmentation() * 100.0)
+
+		for (layer_idx LayerIdx = 0; LayerIdx < Layers.size(); ++LayerIdx)
+		{
+			if(!Layers[LayerIdx].NodeCount) continue;
+			UE_LOG(LogRsap, Log, TEXT("- %s %i: %llu nodes, %llu KB"), LayerIdx == LeafLayerIdx ? TEXT("Leaf-layer") : TEXT("Layer"), LayerIdx, static_cast<uint64>(Layers[LayerIdx].NodeCount), ToKB(Layers[LayerIdx].Bytes))
+		}
+
+		ForEachContainer([&](const TCHAR* ContainerName, const size_t Bytes)
+		{
+			UE_LOG(LogRsap, Log, TEXT("- %s: %llu KB"), ContainerName, ToKB(Bytes))
+		});
+
+		if(Chunks.empty()) return;
+		const FChunk& Largest = *std::ranges::max_element(Chunks, {}, &FChunk::Bytes);
+		UE_LOG(LogRsap, Log, TEXT("- Chunks: %llu KB on average, largest is '%llu-%llu' with %llu KB"),
+			ToKB(GetTotalBytes() / Chunks.size()), Largest.ChunkMC >> 6, Largest.ChunkMC & 0b111111, ToKB(Largest.Bytes))
+	}
+
+	// Rows of 'Section,Key,Nodes,Bytes'.
+	FString ToCSV() const
+	{
+		FStringBuilderBase Builder;
+		Builder << TEXT("Section,Key,Nodes,Bytes\n");
+
+		for (const FChunk& Chunk : Chunks)
+		{
+			Builder << TEXT("Chunk,") << Chunk.ChunkMC << TEXT(",") << static_cast<uint64>(Chunk.NodeCount) << TEXT(",") << static_cast<uint64>(Chunk.Bytes) << TEXT("\n");
+		}
+		for (layer_idx LayerIdx = 0; LayerIdx < Layers.size(); ++LayerIdx)
+		{
+			Builder << TEXT("Layer,") << (LayerIdx == LeafLayerIdx ? TEXT("Leaf") : *FString::FromInt(LayerIdx)) << TEXT(",") << static_cast<uint64>(Layers[LayerIdx].NodeCount) << TEXT(",") << static_cast<uint64>(Layers[LayerIdx].Bytes) << TEXT("\n");
+		}
+		ForEachContainer([&](const TCHAR* ContainerName, const size_t Bytes)
+		{
+			Builder << TEXT("Container,") << ContainerName << TEXT(",,") << static_cast<uint64>(Bytes) << TEXT("\n");
+		});
+		Builder << TEXT("Allocator,Reserved,,") << static_cast<uint64>(Arena.BytesReserved) << TEXT("\n");
+		Builder << TEXT("Allocator,InUse,,") << static_cast<uint64>(Arena.BytesInUse) << TEXT("\n");
+		Builder << TEXT("Allocator,Overhead,,") << static_cast<uint64>(GetAllocatorOverhead()) << TEXT("\n");
+		return Builder.ToString();
+	}
+
+	FORCEINLINE bool SaveCSV(const FString& FilePath) const
+	{
+		return FFileHelper::SaveStringToFile(ToCSV(), *FilePath);
+	}
+
+private:
+	FORCEINLINE static uint64 ToKB(const size_t Bytes) { return static_cast<uint64>(Bytes >> 10); }
+
+	template<typename Func>
+	void ForEachContainer(Func&& Callback) const
+	{
+		Callback(TEXT("DenseLayers"),	Containers.DenseLayers);
+		Callback(TEXT("SparseLayers"),	Containers.SparseLayers);
+		Callback(TEXT("LeafLayers"),	Containers.LeafLayers);
+		Callback(TEXT("ActorEntries"),	Containers.ActorEntries);
+		Callback(TEXT("Octrees"),		Containers.Octrees);
+		Callback(TEXT("LinearOctrees"),	Containers.LinearOctrees);
+		Callback(TEXT("Chunks"),		Containers.Chunks);
+		Callback(TEXT("Other"),			Containers.Other);
+	}
+};
@@ -8,6 +8,7 @@
 #include "Rsap/Math/Vectors.h"
 #include "Rsap/Math/Overlap.h"
 #include "Rsap/Math/Bounds.h"
+#include "Rsap/NavMesh/Types/MemoryReport.h"
 
 using namespace Rsap::NavMesh;
 
@@ -133,6 +134,15 @@ struct RSAPSHARED_API FRsapNode : IRsapNodeBase
 	{
 		return FRsapOverlap::Component(Component, NodeLocation, LayerIdx, bComplex);
 	}
+	// Uses the triangles of the component when they are the collision that is tested, which does not need the physics-scene.
+	// These are the complex-collision, so a simple test only uses them when they are also the simple-collision of the mesh.
+	// Falls back to a physics-query otherwise, which should then run within 'FPhysicsCommand::ExecuteRead', see FRsapCollisionComponent::NeedsPhysicsScene.
+	FORCEINLINE static bool HasComponentOverlap(const FRsapCollisionComponent& Component, const FRsapVector32& NodeLocation, const layer_idx LayerIdx, const bool bComplex)
+	{
+		const FRsapTriangleBVH* TriangleBVH = Component.GetTriangleBVH();
+		if(TriangleBVH && (bComplex || TriangleBVH->IsSimpleCollision())) return FRsapOverlap::Triangles(*TriangleBVH, Component.GetTransform(), NodeLocation, LayerIdx);
+		return FRsapOverlap::Component(*Component, NodeLocation, LayerIdx, bComplex);
+	}
 	FORCEINLINE static bool HasAABBOverlap(const FRsapBounds& AABB, const FRsapVector32& NodeLocation, const layer_idx LayerIdx)
 	{
 		const FRsapBounds NodeBounds(NodeLocation, NodeLocation + Node::Sizes[LayerIdx]);
@@ -163,9 +173,18 @@ struct RSAPSHARED_API FRsapNode : IRsapNodeBase
 	}
 };
 
+/**
+ * Stores the handles of the components that have made this node dirty.
+ * The first few are stored inline, and any beyond that are stored by the dirty-chunk, see FRsapDirtyChunk::AddComponent.
+ */
 struct RSAPSHARED_API FRsapDirtyNode : IRsapNodeBase
 {
-	std::unordered_set<std::shared_ptr<FRsapCollisionComponent>> Components;
+	static inline constexpr uint8 InlineComponents = 5;
+
+	uint16 ComponentCount = 0; // Includes the ones stored by the dirty-chunk.
+	std::array<FRsapCollisionComponentHandle, InlineComponents> Components;
+
+	FORCEINLINE bool HasOverflowingComponents() const { return ComponentCount > InlineComponents; }
 };
 
 struct RSAPSHARED_API FRsapLeaf
@@ -179,6 +198,6 @@ struct RSAPSHARED_API FRsapLeaf
 	}
 };
 
-// todo: switch to flat map for in-game for static
-typedef Rsap::Map::ordered_map<node_morton, FRsapNode> FRsapLayer;
-typedef Rsap::Map::ordered_map<node_morton, FRsapLeaf> FRsapLeafLayer;
\ No newline at end of file
+// Sorted flat arrays in-game, see Rsap::Map::layer_map.
+typedef Rsap::Map::layer_map<node_morton, FRsapNode> FRsapLayer;
+typedef Rsap::Map::layer_map<node_morton, FRsapLeaf> FRsapLeafLayer;
\ No newline at end of file
@@ -0,0 +1,313 @@
+﻿// Copyright Melvin Brink 2023. All Rights Reserved.
+
+#pragma once
+#include "Rsap/Definitions.h"
+#include "Rsap/Math/Morton.h"
+#include "Rsap/NavMesh/Types/MemoryReport.h"
+
+using namespace Rsap::NavMesh;
+
+
+
+/**
+ * A single layer of a sparse-octree, which stores its nodes either densely or sparsely.
+ *
+ * The shallow layers can only hold a few nodes ( 8^LayerIdx ), and they are the ones that are checked the most while walking up the octree.
+ * These are stored densely: an occupancy-bitset plus a node-array, both indexed directly by the morton-code shifted down to this layer's resolution.
+ * Checking if a node exists is a single bit-test, and finding it is an array-index.
+ * The node-array is allocated when the first node is added, and stays allocated until the layer is destroyed.
+ *
+ * The deeper layers are sparse, and use the layer-map like before.
+ *
+ * Has the same interface as the maps, and iterates in ascending morton-order for both modes.
+ */
+template<typename NodeType>
+class TRsapOctreeLayer
+{
+public:
+	typedef Rsap::Map::layer_map<node_morton, NodeType> FSparseMap;
+	using size_type = size_t;
+
+private:
+	static inline constexpr size_t NoIndex = ~static_cast<size_t>(0);
+
+	// Dense
+	bool bDense;
+	uint8 Shift = 0;			// Shifts the morton-code to the index within the dense arrays.
+	size_t DenseCapacity = 0;	// 8^LayerIdx
+	size_t DenseCount = 0;
+	std::pmr::vector<uint64> Occupancy;
+	std::pmr::vector<NodeType> Nodes;
+
+	// Sparse
+	FSparseMap Sparse;
+
+	// The node-based map inserts in constant time when it is given the position to insert at.
+	// When nodes are added in morton-order, that is right after the previous one, see ERsapNodeOrder::Morton.
+	static inline constexpr bool bHintedInsert = requires(FSparseMap& Map, const node_morton Key) { Map.try_emplace(Map.end(), Key); };
+	typename FSparseMap::iterator LastInserted{};
+	bool bHasLastInserted = false;
+
+	template<bool bConst>
+	class iterator_base
+	{
+		friend class TRsapOctreeLayer;
+		template<bool> friend class iterator_base;
+		using layer_type = std::conditional_t<bConst, const TRsapOctreeLayer, TRsapOctreeLayer>;
+		using sparse_iterator = std::conditional_t<bConst, typename FSparseMap::const_iterator, typename FSparseMap::iterator>;
+		using value_reference = std::conditional_t<bConst, const NodeType&, NodeType&>;
+
+		layer_type* Layer = nullptr;
+		size_t DenseIdx = NoIndex;
+		sparse_iterator SparseIterator{};
+
+		iterator_base(layer_type* InLayer, const size_t InDenseIdx) : Layer(InLayer), DenseIdx(InDenseIdx) {}
+		iterator_base(layer_type* InLayer, const sparse_iterator InSparseIterator) : Layer(InLayer), SparseIterator(InSparseIterator) {}
+
+	public:
+		using reference = std::pair<const node_morton, value_reference>;
+
+		// Allows 'Iterator->second' on the pair that is created on dereference.
+		struct arrow_proxy
+		{
+			reference Pair;
+			const reference* operator->() const { return &Pair; }
+		};
+
+		iterator_base() = default;
+
+		// Non-const to const conversion.
+		template<bool bOtherConst, typename = std::enable_if_t<bConst && !bOtherConst>>
+		iterator_base(const iterator_base<bOtherConst>& Other) : Layer(Other.Layer), DenseIdx(Other.DenseIdx), SparseIterator(Other.SparseIterator) {}
+
+		FORCEINLINE reference operator*() const
+		{
+			if(Layer->bDense) return reference(static_cast<node_morton>(DenseIdx << Layer->Shift), Layer->Nodes[DenseIdx]);
+			return reference((*SparseIterator).first, (*SparseIterator).second);
+		}
+		FORCEINLINE arrow_proxy operator->() const { return arrow_proxy{**this}; }
+
+		FORCEINLINE iterator_base& operator++()
+		{
+			if(Layer->bDense) DenseIdx = Layer->FindNextDenseIndex(DenseIdx + 1);
+			else ++SparseIterator;
+			return *this;
+		}
+		FORCEINLINE iterator_base operator++(int) { iterator_base Temp = *this; ++*this; return Temp; }
+
+		FORCEINLINE bool operator==(const iterator_base& Other) const
+		{
+			return Layer->bDense ? DenseIdx == Other.DenseIdx : SparseIterator == Other.SparseIterator;
+		}
+		FORCEINLINE bool operator!=(const iterator_base& Other) const { return !(*this == Other); }
+	};
+
+public:
+	using iterator = iterator_base<false>;
+	using const_iterator = iterator_base<true>;
+
+	TRsapOctreeLayer(const layer_idx LayerIdx, const bool bInDense, std::pmr::memory_resource* Resource = std::pmr::get_default_resource())
+		: bDense(bInDense), Occupancy(Resource), Nodes(Resource), Sparse(Resource)
+	{
+		if(!bDense) return;
+		Shift = 30 - LayerIdx * 3;
+		DenseCapacity = static_cast<size_t>(1) << (LayerIdx * 3);
+	}
+
+	FORCEINLINE bool IsDense() const { return bDense; }
+
+	// Single bit-test for dense layers.
+	FORCEINLINE bool contains(const node_morton NodeMC) const
+	{
+		if(bDense) return IsDenseIndexSet(NodeMC >> Shift);
+		return Sparse.contains(NodeMC);
+	}
+
+	FORCEINLINE iterator find(const node_morton NodeMC)
+	{
+		if(bDense)
+		{
+			const size_t Index = NodeMC >> Shift;
+			return IsDenseIndexSet(Index) ? iterator(this, Index) : end();
+		}
+		return iterator(this, Sparse.find(NodeMC));
+	}
+	FORCEINLINE const_iterator find(const node_morton NodeMC) const
+	{
+		if(bDense)
+		{
+			const size_t Index = NodeMC >> Shift;
+			return IsDenseIndexSet(Index) ? const_iterator(this, Index) : end();
+		}
+		return const_iterator(this, Sparse.find(NodeMC));
+	}
+
+	// First node with a morton-code that is not less than the given one.
+	FORCEINLINE iterator lower_bound(const node_morton NodeMC)
+	{
+		if(bDense) return iterator(this, FindNextDenseIndex(GetDenseIndexRoundedUp(NodeMC)));
+		return iterator(this, Sparse.lower_bound(NodeMC));
+	}
+	FORCEINLINE const_iterator lower_bound(const node_morton NodeMC) const
+	{
+		if(bDense) return const_iterator(this, FindNextDenseIndex(GetDenseIndexRoundedUp(NodeMC)));
+		return const_iterator(this, Sparse.lower_bound(NodeMC));
+	}
+
+	/**
+	 * Runs the callback for each node within the box spanned by the min and max morton-codes, which are both inclusive.
+	 * Only the stored nodes are visited: when the next node is outside of the box, it jumps to the next morton-code that is inside of it using BIGMIN.
+	 * The cost scales with the nodes that are in, or close to, the box instead of the volume of the box.
+	 *
+	 * Callback receives the node_morton and the node.
+	 */
+	template<typename Func>
+	void ForEachInBox(const node_morton MinMC, const node_morton MaxMC, Func Callback)
+	{
+		ForEachInBoxImpl(*this, MinMC, MaxMC, Callback);
+	}
+	template<typename Func>
+	void ForEachInBox(const node_morton MinMC, const node_morton MaxMC, Func Callback) const
+	{
+		ForEachInBoxImpl(*this, MinMC, MaxMC, Callback);
+	}
+
+	template<typename... TArgs>
+	FORCEINLINE std::pair<iterator, bool> try_emplace(const node_morton NodeMC, TArgs&&... Args)
+	{
+		if(!bDense)
+		{
+			if constexpr (bHintedInsert)
+			{
+				const size_t PrevSize = Sparse.size();
+				LastInserted = Sparse.try_emplace(bHasLastInserted ? std::next(LastInserted) : Sparse.end(), NodeMC, std::forward<TArgs>(Args)...);
+				bHasLastInserted = true;
+				return { iterator(this, LastInserted), Sparse.size() != PrevSize };
+			}
+			else
+			{
+				const auto [SparseIterator, bInserted] = Sparse.try_emplace(NodeMC, std::forward<TArgs>(Args)...);
+				return { iterator(this, SparseIterator), bInserted };
+			}
+		}
+
+		const size_t Index = NodeMC >> Shift;
+		if(IsDenseIndexSet(Index)) return { iterator(this, Index), false };
+		if(Nodes.empty())
+		{
+			Occupancy.resize((DenseCapacity + 63) / 64);
+			Nodes.resize(DenseCapacity);
+		}
+
+		Occupancy[Index >> 6] |= 1ull << (Index & 63);
+		Nodes[Index] = NodeType(std::forward<TArgs>(Args)...);
+		++DenseCount;
+		return { iterator(this, Index), true };
+	}
+	template<typename... TArgs>
+	FORCEINLINE std::pair<iterator, bool> emplace(const node_morton NodeMC, TArgs&&... Args)
+	{
+		return try_emplace(NodeMC, std::forward<TArgs>(Args)...);
+	}
+
+	size_type erase(const node_morton NodeMC)
+	{
+		if(!bDense)
+		{
+			if(bHasLastInserted && LastInserted->first == NodeMC) bHasLastInserted = false;
+			return Sparse.erase(NodeMC);
+		}
+
+		const size_t Index = NodeMC >> Shift;
+		if(!IsDenseIndexSet(Index)) return 0;
+		Occupancy[Index >> 6] &= ~(1ull << (Index & 63));
+		Nodes[Index] = NodeType();
+		--DenseCount;
+		return 1;
+	}
+
+	// Keeps the dense arrays allocated so that the layer can be reused.
+	void clear()
+	{
+		if(!bDense)
+		{
+			bHasLastInserted = false;
+			return Sparse.clear();
+		}
+		std::fill(Occupancy.begin(), Occupancy.end(), 0);
+		std::fill(Nodes.begin(), Nodes.end(), NodeType());
+		DenseCount = 0;
+	}
+
+	// Reserves room for the given amount of nodes, if the sparse map supports it. Used before appending nodes in morton-order.
+	void reserve(const size_type Count)
+	{
+		if constexpr (requires { Sparse.reserve(Count); }) if(!bDense) Sparse.reserve(Count);
+	}
+
+	// Releases any excess capacity of the sparse map, if it supports it.
+	void shrink_to_fit()
+	{
+		if constexpr (requires { Sparse.shrink_to_fit(); }) if(!bDense) Sparse.shrink_to_fit();
+	}
+
+	// Bytes allocated by this layer, excluding the layer itself.
+	size_t GetAllocatedSize() const
+	{
+		if(bDense) return Occupancy.capacity() * sizeof(uint64) + Nodes.capacity() * sizeof(NodeType);
+		return Rsap::Memory::GetAllocatedSize(Sparse);
+	}
+
+	FORCEINLINE size_type size() const { return bDense ? DenseCount : Sparse.size(); }
+	FORCEINLINE bool empty() const { return size() == 0; }
+
+	FORCEINLINE iterator begin() { return bDense ? iterator(this, FindNextDenseIndex(0)) : iterator(this, Sparse.begin()); }
+	FORCEINLINE iterator end() { return bDense ? iterator(this, DenseCapacity) : iterator(this, Sparse.end()); }
+	FORCEINLINE const_iterator begin() const { return bDense ? const_iterator(this, FindNextDenseIndex(0)) : const_iterator(this, Sparse.begin()); }
+	FORCEINLINE const_iterator end() const { return bDense ? const_iterator(this, DenseCapacity) : const_iterator(this, Sparse.end()); }
+
+private:
+	template<typename LayerType, typename Func>
+	static void ForEachInBoxImpl(LayerType& Layer, const node_morton MinMC, const node_morton MaxMC, Func& Callback)
+	{
+		static_assert(std::is_invocable_v<Func, node_morton, decltype((*Layer.begin()).second)>, "'::ForEachInBox' callback must be invocable with 'node_morton, NodeType&'");
+
+		const auto End = Layer.end();
+		auto Iterator = Layer.lower_bound(MinMC);
+		while (Iterator != End)
+		{
+			const auto [NodeMC, Node] = *Iterator;
+			if(NodeMC > MaxMC) return;
+			if(FMortonUtils::Node::IsInBox(NodeMC, MinMC, MaxMC))
+			{
+				Callback(NodeMC, Node);
+				++Iterator;
+				continue;
+			}
+			Iterator = Layer.lower_bound(FMortonUtils::Node::GetBigMin(NodeMC, MinMC, MaxMC));
+		}
+	}
+
+	// Rounded up, so that a morton-code in-between two nodes of this layer gives the index of the next one.
+	FORCEINLINE size_t GetDenseIndexRoundedUp(const node_morton NodeMC) const
+	{
+		return (static_cast<uint64>(NodeMC) + (1ull << Shift) - 1) >> Shift;
+	}
+
+	FORCEINLINE bool IsDenseIndexSet(const size_t Index) const
+	{
+		return !Occupancy.empty() && (Occupancy[Index >> 6] >> (Index & 63)) & 1;
+	}
+
+	// Returns the first index, starting from the given one, that has a node. Returns the capacity if there is none.
+	FORCEINLINE size_t FindNextDenseIndex(size_t Index) const
+	{
+		while (Index < DenseCapacity && Index < Occupancy.size() * 64)
+		{
+			const uint64 Word = Occupancy[Index >> 6] >> (Index & 63);
+			if(Word) return Index + FMath::CountTrailingZeros64(Word);
+			Index = (Index | 63) + 1;
+		}
+		return DenseCapacity;
+	}
+};
@@ -2,44 +2,178 @@
 
 #pragma once
 #include "Navmesh.h"
+#include "Containers/Ticker.h"
+#include "HAL/CriticalSection.h"
+#include "HAL/Thread.h"
+#include <atomic>
+#include <vector>
+
+class IRsapWorld;
+class FEvent;
 
 
 
 /**
- * Responsible for updating the navmesh asynchronously.
- * Stores a reference to the navmesh you would like to be updated.
+ * Responsible for updating the navmesh asynchronously, for the collision-components that have changed.
+ *
+ * A changed component is held back until it has settled, which is when it has not changed for the settle-delay, or has kept changing for the max-settle-delay.
+ * So a component that is dragged around is staged once, from where it was last rasterized to where it has ended up, instead of for every step in-between.
+ * Deleted components are staged right away.
+ *
+ * The game-thread stages the settled components, which only copies what the thread needs into an inbox, so it never waits on the thread.
+ * The inbox is double-buffered: the game-thread appends to one buffer while the thread drains the other, and the buffers are only swapped under the lock.
+ *
+ * The thread marks the dirty-nodes on the dirty-navmesh, and rebuilds each chunk with any dirty-node from a snapshot of the components that occlude it.
+ * A chunk is rebuilt as a whole, since publishing replaces the whole chunk in the navmesh, which keeps the navmesh from being changed on the thread.
+ * So the thread keeps track of the components that occlude each chunk itself, which the game-thread only stages once when the navmesh is started on, or swapped in.
+ * Staging a changed component then only copies that component, and the thread stages it on the chunks it occluded before, to rebuild these without it.
+ * Only the components that can be rasterized from their triangles alone are rasterized on the thread, see FRsapCollisionComponent::NeedsPhysicsScene.
+ * The others are tested against the physics-scene, which is only safe on the game-thread, so these are rasterized into the chunk when it is published.
+ * The navmesh itself is only changed on the game-thread, where the rebuilt chunks are published within a budget on each tick.
+ * So the navmesh can be used freely on the game-thread, and OnUpdateComplete is broadcast there once everything that has been staged is published.
  *
- * The updater will run after calling ::Start
- * You can pause the updater by calling ::Pause which will finish the current node being processed.
+ * Given a focus, like the camera or the listener, the chunks nearest to it are rebuilt and published first.
+ * The chunks within the immediate-radius are published on the first tick after they are rebuilt regardless of the budget, and the rest trickles in within the budget.
  *
- * Pause the updater when you want to use the navmesh to avoid race conditions.
+ * ::Start		- To run the updater, which will continuously process the staged components.
+ * ::Stop		- To stop the thread, which discards any staged component that has not been published yet.
+ * ::Pause		- To stop publishing into the navmesh, g.e. while it is being regenerated. ::Resume to continue.
+ * ::IsUpdating	- To know whether there is any staged component that has not been published yet.
  */
 class RSAPSHARED_API FRsapNavmeshUpdater
 {
-	FRsapNavmesh& Navmesh;
-	FRsapDirtyNavmesh DirtyNavmesh;
-	
-	std::unordered_set<std::shared_ptr<FRsapCollisionComponent>> StagedComponents;
+	DECLARE_MULTICAST_DELEGATE(FOnUpdateComplete);
 
 public:
-	explicit FRsapNavmeshUpdater(FRsapNavmesh& InNavmesh) : Navmesh(InNavmesh){}
+	FOnUpdateComplete OnUpdateComplete;
+	float PublishBudgetMs = 2.f; // Time that can be spent on publishing the rebuilt chunks on each tick.
+	float ImmediateRadius = Chunk::Size; // Distance from the focus to the center of a chunk, within which it is published without a budget.
+	float SettleDelayMs = 100.f; // Time a component has to stop changing before it is staged.
+	float MaxSettleDelayMs = 500.f; // Time after which a component that keeps changing is staged anyway.
+
+	explicit FRsapNavmeshUpdater(FRsapNavmesh& InNavmesh);
+	~FRsapNavmeshUpdater();
+
+	FRsapNavmeshUpdater(const FRsapNavmeshUpdater&) = delete;
+	FRsapNavmeshUpdater& operator=(const FRsapNavmeshUpdater&) = delete;
+
+	void Start(const IRsapWorld* InRsapWorld);
+	void Stop();
+	void Pause() { bPaused = true; }
+	void Resume();
+	FORCEINLINE bool IsRunning() const { return Thread.IsJoinable(); }
+	bool IsUpdating() const;
+
+	// The navmesh to publish into, which can be changed at any time, g.e. when a regenerated navmesh is swapped in. Only call from the game-thread.
+	void SetNavmesh(FRsapNavmesh& InNavmesh);
+
+	// Processes the chunks nearest to this location first. Only call from the game-thread.
+	void SetFocus(const FVector& Location);
+
+	// Stages the change of the component to be processed on the thread once it has settled. Only call from the game-thread.
+	void StageComponent(const FRsapCollisionComponentChangedResult& ChangedResult);
+
+private:
+	// A component that has changed, but has not settled yet.
+	struct FPendingComponent
+	{
+		actor_key ActorKey;
+		double FirstChangeTime;
+		double LastChangeTime;
+		bool bIsDeleted = false;
+	};
+
+	// A snapshot of a component, which is used on the thread instead of the component itself.
+	struct FSnapshot
+	{
+		actor_key ActorKey;
+		FRsapCollisionComponent Component;
+	};
+	typedef Rsap::Map::flat_map<FRsapCollisionComponentHandle, FSnapshot, FRsapCollisionComponentHandle::FHash> FSnapshotMap;
+	typedef Rsap::Map::flat_map<chunk_morton, std::vector<FRsapCollisionComponentHandle>> FChunkComponentMap;
+
+	struct FStagedNode
+	{
+		chunk_morton ChunkMC;
+		node_morton NodeMC;
+		layer_idx LayerIdx;
+		FRsapCollisionComponentHandle Component;
+	};
+
+	struct FInbox
+	{
+		FSnapshotMap Snapshots; // The latest snapshot of each staged component.
+		std::vector<FStagedNode> Nodes;
+
+		// The components that occlude each chunk of the navmesh, which replace the ones the thread keeps track of when set.
+		bool bHasOccluders = false;
+		FSnapshotMap OccluderSnapshots;
+		FChunkComponentMap ChunkComponents;
 
-	void StageComponent(const std::shared_ptr<FRsapCollisionComponent>& Component)
+		FORCEINLINE bool IsEmpty() const { return Nodes.empty() && Snapshots.empty() && !bHasOccluders; }
+	};
+
+	// A component that needs the physics-scene and intersects a rebuilt chunk, which is rasterized on the game-thread.
+	struct FPhysicsComponent
+	{
+		actor_key ActorKey;
+		FRsapCollisionComponent Component;
+		FRsapBounds Intersection;
+	};
+
+	// A chunk that has been rebuilt on the thread, which replaces the chunk in the navmesh when it is published.
+	struct FRebuiltChunk
 	{
-		// todo: mutex?
-		StagedComponents.insert(Component);
-		std::weak_ptr ComponentPtr = Component;
-
-		Component->ForEachDirtyNode([&DirtyNavmesh = DirtyNavmesh, &ComponentPtr = ComponentPtr](const chunk_morton ChunkMC, const node_morton NodeMC, const layer_idx LayerIdx)
-		{
-			FRsapDirtyChunk* DirtyChunk = DirtyNavmesh.FindChunk(ChunkMC);
-			if(!DirtyChunk) DirtyChunk = &DirtyNavmesh.InitChunk(ChunkMC);
-
-			bool bWasInserted;
-			FRsapDirtyNode& DirtyNode = DirtyChunk->TryInitNode(bWasInserted, NodeMC, LayerIdx);
-			if(bWasInserted) DirtyChunk->InitNodeParents(NodeMC, LayerIdx);
-
-			DirtyNode.Components.insert(ComponentPtr);
-		});
-	}
+		chunk_morton ChunkMC;
+		FRsapOctreeBuilder Builder;
+		std::vector<actor_key> OccludingActors;
+		std::vector<FPhysicsComponent> PhysicsComponents;
+	};
+
+	FRsapNavmesh* Navmesh;
+	const IRsapWorld* RsapWorld = nullptr;
+
+	FThread Thread;
+	FEvent* WorkEvent;
+	std::atomic<bool> bStopping = false;
+	std::atomic<bool> bPaused = false;
+	std::atomic<bool> bIsProcessing = false;
+
+	// Game-thread appends to Inboxes[InboxIdx], the thread drains the other one.
+	// The focus is passed along with it, which the thread copies when swapping.
+	mutable FCriticalSection InboxLock;
+	FInbox Inboxes[2];
+	uint8 InboxIdx = 0;
+	bool bHasFocus = false;
+	FVector Focus = FVector::ZeroVector;
+
+	// Only used on the thread.
+	FRsapDirtyNavmesh DirtyNavmesh;
+	FSnapshotMap Snapshots; // Of the staged components, and the components that occlude any chunk.
+	FChunkComponentMap ChunkComponents; // The components that occlude each chunk, as it was last rebuilt, or as it was in the navmesh.
+	Rsap::Map::flat_map<FRsapCollisionComponentHandle, std::vector<chunk_morton>, FRsapCollisionComponentHandle::FHash> ComponentChunks; // The reverse of ChunkComponents.
+	bool bThreadHasFocus = false;
+	FVector ThreadFocus = FVector::ZeroVector;
+
+	mutable FCriticalSection OutboxLock;
+	std::vector<FRebuiltChunk> Outbox;
+
+	// Only used on the game-thread. Holds the latest rebuild of each chunk, which replaces any earlier one that is not published yet.
+	FTSTicker::FDelegateHandle TickerHandle;
+	std::vector<FRebuiltChunk> PublishQueue;
+	bool bHasPublished = false;
+
+	// Only used on the game-thread.
+	Rsap::Map::flat_map<FRsapCollisionComponentHandle, FPendingComponent, FRsapCollisionComponentHandle::FHash> PendingComponents;
+
+	void StageSettledComponents();
+	void StagePendingComponent(FRsapCollisionComponentHandle Handle, const FPendingComponent& PendingComponent);
+	void StageOccluders();
+	void Run();
+	void DrainInbox(FInbox& Inbox);
+	void SetChunkComponents(chunk_morton ChunkMC, std::vector<FRsapCollisionComponentHandle>&& Handles);
+	FRsapDirtyNavmesh::FChunkMap::iterator FindNearestDirtyChunk();
+	void RebuildChunk(chunk_morton ChunkMC, const FRsapDirtyChunk& DirtyChunk);
+	bool Tick(float DeltaTime);
+	void PublishChunk(FRebuiltChunk& RebuiltChunk) const;
 };
\ No newline at end of file